@@ -24,6 +24,16 @@ public class Sora : IDisposable
     {
         OPUS,
     }
+    // Plane written by RenderTrackPlaneToTexture.
+    // Y, U and V are 1 byte per pixel (e.g. TextureFormat.R8), UV is interleaved NV12 chroma
+    // with 2 bytes per pixel (e.g. TextureFormat.RG16). YUV to RGB conversion is done in a shader.
+    public enum TexturePlane
+    {
+        Y = 0,
+        U = 1,
+        V = 2,
+        UV = 3,
+    }
     public class Config
     {
         public string SignalingUrl = "";
@@ -49,6 +59,7 @@ public class Sora : IDisposable
     }
 
     IntPtr p;
+    System.Collections.Generic.Dictionary<uint, long> renderedFrameCounters = new System.Collections.Generic.Dictionary<uint, long>();
     GCHandle onAddTrackHandle;
     GCHandle onRemoveTrackHandle;
     GCHandle onNotifyHandle;
@@ -146,6 +157,59 @@ public class Sora : IDisposable
         commandBuffer.Clear();
     }
 
+    // Write one plane of the video received by trackId to texture.
+    // The texture size decides the output size; the plane is scaled if it differs.
+    // Update the Y plane first in each frame, the other planes follow the frame latched by Y.
+    public void RenderTrackPlaneToTexture(uint trackId, TexturePlane plane, UnityEngine.Texture texture)
+    {
+        commandBuffer.IssuePluginCustomTextureUpdateV2(sora_get_texture_update_callback_plane((int)plane), texture, trackId);
+        UnityEngine.Graphics.ExecuteCommandBuffer(commandBuffer);
+        commandBuffer.Clear();
+    }
+
+    // Render the video received by trackId to texture only when a new frame has arrived
+    // since the last call for this track. Returns false if the texture update was skipped.
+    public bool RenderTrackToTextureIfUpdated(uint trackId, UnityEngine.Texture texture)
+    {
+        long counter = GetTrackFrameCounter(trackId);
+        long rendered;
+        if (renderedFrameCounters.TryGetValue(trackId, out rendered) && rendered == counter)
+        {
+            return false;
+        }
+        renderedFrameCounters[trackId] = counter;
+        RenderTrackToTexture(trackId, texture);
+        return true;
+    }
+
+    // Number of frames received for trackId so far
+    public static long GetTrackFrameCounter(uint trackId)
+    {
+        return sora_get_track_frame_counter(trackId);
+    }
+
+    // Tell the size (in pixels) and frame rate at which trackId is drawn on screen.
+    // Received frames larger than this are downscaled and frames above maxFps are dropped
+    // before any conversion. Pass 0 for width/height or maxFps to remove the limit.
+    // Has no effect on local tracks. Applied asynchronously on the signaling thread.
+    public void SetTrackViewport(uint trackId, int width, int height, int maxFps = 0)
+    {
+        sora_set_track_viewport(p, trackId, width, height, maxFps);
+    }
+
+    // Total bytes copied or scaled while writing planes for trackId.
+    // Planes whose size and stride match the texture are passed without copying.
+    public static long GetTrackPlaneBytesCopied(uint trackId)
+    {
+        return sora_get_track_plane_bytes_copied(trackId);
+    }
+
+    // Average time in microseconds the render thread spends preparing the texture for trackId
+    public static int GetTextureUpdateTimeUs(uint trackId)
+    {
+        return sora_get_texture_update_time_us(trackId);
+    }
+
     private delegate void TrackCallbackDelegate(uint track_id, IntPtr userdata);
 
     [AOT.MonoPInvokeCallback(typeof(TrackCallbackDelegate))]
@@ -210,11 +274,203 @@ public class Sora : IDisposable
         sora_dispatch_events(p);
     }
 
+    // Dispatches events until budgetMicroseconds is used up.
+    // Returns the number of events carried over to the next call.
+    public int DispatchEvents(int budgetMicroseconds)
+    {
+        return sora_dispatch_events_with_budget(p, budgetMicroseconds);
+    }
+
+    // When enabled, notifications that only carry the latest state and have not
+    // been dispatched yet are merged, and only the latest is delivered:
+    // - signalingReconnecting, signalingReconnected and signalingClosed
+    // - roomMembershipChanged, per room. "added" and "removed" of a merged
+    //   notification only cover its own change, so use "streams" for the membership.
+    // - streamStateChanged, per streamId
+    // Data channel messages are never merged.
+    public bool EventCoalescing
+    {
+        set { sora_set_event_coalescing(p, value ? 1 : 0); }
+    }
+
+    // Number of events waiting to be dispatched on the Unity thread
+    public int EventQueueDepth
+    {
+        get { return sora_get_event_queue_depth(p); }
+    }
+
+    // Number of notifications dropped because the event queue was full.
+    // Track and stats events are never dropped.
+    public long DroppedEventCount
+    {
+        get { return sora_get_dropped_event_count(p); }
+    }
+
+    // Number of events merged by event coalescing
+    public long CoalescedEventCount
+    {
+        get { return sora_get_coalesced_event_count(p); }
+    }
+
     public void ProcessAudio(float[] data, int offset, int samples)
     {
         sora_process_audio(p, data, offset, samples);
     }
 
+    // Send interleaved audio with the given channel count and sample rate (e.g. AudioSettings.outputSampleRate).
+    // samples is the number of samples per channel. The sample rate must be a multiple of 100.
+    // Only the first two channels are sent when channels is greater than 2.
+    public void ProcessAudio(float[] data, int offset, int samples, int channels, int sampleRate)
+    {
+        sora_process_audio_ex(p, data, offset, samples, channels, sampleRate);
+    }
+
+    // Fill data with received audio. Call this from OnAudioFilterRead, e.g.
+    //   sora.PullAudio(data, 0, data.Length / channels, channels, AudioSettings.outputSampleRate);
+    // Once called, the playout thread paces itself by how much Unity has consumed instead of
+    // its own timer. Missing samples are filled with silence and counted as underruns in the
+    // "sora-audio-playout" entry of GetStats. The sample rate must be a multiple of 100.
+    public void PullAudio(float[] data, int offset, int samples, int channels, int sampleRate)
+    {
+        sora_pull_audio(p, data, offset, samples, channels, sampleRate);
+    }
+
+    // Deliver each remote stream's decoded audio separately instead of only the mixed output.
+    // Must be set before Connect.
+    public bool StreamAudioEnabled
+    {
+        set { sora_set_stream_audio_enabled(p, value ? 1 : 0); }
+    }
+
+    private delegate void AudioStreamEnumCallbackDelegate(string stream_id, IntPtr userdata);
+
+    [AOT.MonoPInvokeCallback(typeof(AudioStreamEnumCallbackDelegate))]
+    static private void AudioStreamEnumCallback(string streamId, IntPtr userdata)
+    {
+        var callback = GCHandle.FromIntPtr(userdata).Target as Action<string>;
+        callback(streamId);
+    }
+
+    // Stream ids whose audio can be pulled with PullStreamAudio
+    public string[] GetAudioStreams()
+    {
+        var list = new System.Collections.Generic.List<string>();
+        Action<string> f = (streamId) => list.Add(streamId);
+
+        GCHandle handle = GCHandle.Alloc(f);
+        sora_enum_audio_streams(p, AudioStreamEnumCallback, GCHandle.ToIntPtr(handle));
+        handle.Free();
+
+        return list.ToArray();
+    }
+
+    // Fill data with the audio received for streamId, e.g. from OnAudioFilterRead of the
+    // AudioSource placed for that participant. samples is the number of samples per channel.
+    // The received audio is resampled to sampleRate (usually AudioSettings.outputSampleRate),
+    // which must be a multiple of 100 and at most 96000.
+    // Returns the number of samples per channel filled; the rest is silence.
+    public int PullStreamAudio(string streamId, float[] data, int offset, int samples, int channels, int sampleRate)
+    {
+        return sora_pull_stream_audio(p, streamId, data, offset, samples, channels, sampleRate);
+    }
+
+    // Sample rate of the audio received for streamId before resampling, or 0 if nothing has arrived yet
+    public int GetStreamAudioSampleRate(string streamId)
+    {
+        return sora_get_stream_audio_sample_rate(p, streamId);
+    }
+
+    // Set how streamId is placed in the mix returned by PullSpatialAudio.
+    // gain is linear volume, pan is -1 (left) to 1 (right) with equal-power panning,
+    // and distance attenuates the stream in inverse proportion beyond 1 unit.
+    // Changes are ramped over the next pulled buffer.
+    public void SetStreamAudioSpatial(string streamId, float gain, float pan, float distance)
+    {
+        sora_set_stream_audio_spatial(p, streamId, gain, pan, distance);
+    }
+
+    // Fill data with all remote streams mixed natively according to SetStreamAudioSpatial.
+    // Each stream is resampled to sampleRate as in PullStreamAudio.
+    // Do not use PullStreamAudio together with this for the same Sora object.
+    public void PullSpatialAudio(float[] data, int offset, int samples, int channels, int sampleRate)
+    {
+        sora_pull_spatial_audio(p, data, offset, samples, channels, sampleRate);
+    }
+
+    [StructLayout(LayoutKind.Sequential, CharSet = CharSet.Ansi)]
+    public struct AudioLevel
+    {
+        // Empty for the audio sent from Unity (ProcessAudio)
+        [MarshalAs(UnmanagedType.ByValTStr, SizeConst = 64)]
+        public string StreamId;
+        // 0 to 1
+        public float Rms;
+        public float Peak;
+        int voiceActive;
+        public bool VoiceActive { get { return voiceActive != 0; } }
+    }
+
+    // Current audio levels and voice activity of the audio sent from Unity and of each
+    // remote stream (when StreamAudioEnabled). Cheap enough to poll every frame.
+    // Returns the number of entries written to levels.
+    public int GetAudioLevels(AudioLevel[] levels)
+    {
+        return sora_get_audio_levels(p, levels, levels.Length);
+    }
+
+    [StructLayout(LayoutKind.Sequential, CharSet = CharSet.Ansi)]
+    public struct StreamStats
+    {
+        [MarshalAs(UnmanagedType.ByValTStr, SizeConst = 64)]
+        public string StreamId;
+        // "audio" or "video"
+        [MarshalAs(UnmanagedType.ByValTStr, SizeConst = 8)]
+        public string Kind;
+        int inbound;
+        public long TimestampUs;
+        public double BitrateBps;
+        public double FramesPerSecond;
+        public double RttMs;
+        // JitterMs, PacketsLost and FramesDropped are only set for inbound streams
+        public double JitterMs;
+        public long PacketsLost;
+        public long FramesDropped;
+        // Frames decoded (inbound) or encoded (outbound)
+        public long Frames;
+        // Average decode (inbound) or encode (outbound) time per frame
+        public double FrameTimeMs;
+        // Change since the previous sample
+        public long PacketsLostDelta;
+        public long FramesDroppedDelta;
+        public bool Inbound { get { return inbound != 0; } }
+    }
+
+    // Fill stats with one entry per RTP stream of every connection and return the number written.
+    // The values are those collected since the previous call, so without SetStatsSampling
+    // they are one poll old: a call starts the next collection in the background, at most
+    // every 250 ms and only once the previous collection has finished, so polling every
+    // frame is cheap. Unlike GetStats, no JSON is built and nothing is sent over the
+    // signaling connection.
+    public int GetStreamStats(StreamStats[] stats)
+    {
+        return sora_get_stream_stats(p, stats, stats.Length);
+    }
+
+    // Collect stream stats every intervalMs milliseconds in the background and keep the last
+    // historySize samples per stream, so graphs can be drawn without polling GetStreamStats.
+    // History is preallocated per stream; changing historySize discards it.
+    // intervalMs <= 0 stops the periodic collection.
+    public void SetStatsSampling(int intervalMs, int historySize)
+    {
+        sora_set_stats_sampling(p, intervalMs, historySize);
+    }
+
+    // Fill stats with the kept samples of one stream, oldest first, and return the number written.
+    public int GetStreamStatsHistory(string streamId, string kind, bool inbound, StreamStats[] stats)
+    {
+        return sora_get_stream_stats_history(p, streamId, kind, inbound ? 1 : 0, stats, stats.Length);
+    }
+
     private delegate void HandleAudioCallbackDelegate(IntPtr buf, int samples, int channels, IntPtr userdata);
 
     [AOT.MonoPInvokeCallback(typeof(HandleAudioCallbackDelegate))]
@@ -257,6 +513,55 @@ public class Sora : IDisposable
         sora_get_stats(p, StatsCallback, GCHandle.ToIntPtr(handle));
     }
 
+    // Intervals of the signaling ping and, for sendrecv, the getRoomInfo room refresh.
+    // Both are sent natively on timers, so the connection stays alive without polling GetStats.
+    // While there is no pong or the room does not change, the interval backs off up to 8 times.
+    // 0 disables. Can be called before or after Connect; the default is 5000 ms for both.
+    public void SetKeepalive(int keepaliveIntervalMs, int roomRefreshIntervalMs)
+    {
+        sora_set_keepalive(p, keepaliveIntervalMs, roomRefreshIntervalMs);
+    }
+
+    // Automatic reconnect of the signaling websocket. Call before Connect.
+    // The delay starts at baseDelayMs and doubles on every attempt up to maxDelayMs.
+    // PeerConnections that are still connected are kept; publish, play and joinRoom are
+    // re-sent only for the streams that need them. Progress is reported through OnNotify
+    // as signalingReconnecting, signalingReconnected and signalingClosed notifications.
+    // maxAttempts 0 disables reconnecting. Defaults: 10 attempts, 500 ms, 30000 ms.
+    public void SetReconnect(int maxAttempts, int baseDelayMs, int maxDelayMs)
+    {
+        sora_set_reconnect(p, maxAttempts, baseDelayMs, maxDelayMs);
+    }
+
+    // Hold the offer/answer of each stream for up to windowMs and send it once ICE
+    // candidate gathering completes, with the candidates in the SDP, instead of one
+    // takeCandidate message per candidate. If gathering takes longer, the SDP and the
+    // candidates found so far are sent when the window ends and the rest as they are
+    // found. 0 sends everything right away (the default). Call before Connect.
+    public void SetCandidateBatching(int windowMs)
+    {
+        sora_set_candidate_batching(p, windowMs);
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct SignalingStats
+    {
+        // Totals since Connect
+        public long MessagesSent;
+        public long BytesSent;
+        public long MessagesReceived;
+        public long BytesReceived;
+        public long CandidatesSent;
+    }
+
+    // Message and byte counters of the signaling connection, e.g. to measure the cost of a join.
+    public SignalingStats GetSignalingStats()
+    {
+        SignalingStats stats;
+        sora_get_signaling_stats(p, out stats);
+        return stats;
+    }
+
     public void SendDataChannelMessage(string str)
     {
         sora_send_data_channel_message(p, str);
@@ -388,6 +693,36 @@ public class Sora : IDisposable
     [DllImport("__Internal")]
 #else
     [DllImport("SoraUnitySdk")]
+#endif
+    private static extern int sora_get_event_queue_depth(IntPtr p);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern long sora_get_dropped_event_count(IntPtr p);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern int sora_dispatch_events_with_budget(IntPtr p, int budget_us);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern void sora_set_event_coalescing(IntPtr p, int enabled);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern long sora_get_coalesced_event_count(IntPtr p);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
 #endif
     private static extern int sora_connect(
         IntPtr p,
@@ -421,6 +756,36 @@ public class Sora : IDisposable
     [DllImport("__Internal")]
 #else
     [DllImport("SoraUnitySdk")]
+#endif
+    private static extern IntPtr sora_get_texture_update_callback_plane(int plane);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern int sora_get_texture_update_time_us(uint track_id);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern long sora_get_track_frame_counter(uint track_id);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern long sora_get_track_plane_bytes_copied(uint track_id);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern void sora_set_track_viewport(IntPtr p, uint track_id, int width, int height, int max_fps);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
 #endif
     private static extern void sora_destroy(IntPtr p);
 #if UNITY_IOS && !UNITY_EDITOR
@@ -445,6 +810,78 @@ public class Sora : IDisposable
     [DllImport("__Internal")]
 #else
     [DllImport("SoraUnitySdk")]
+#endif
+    private static extern void sora_process_audio_ex(IntPtr p, [In] float[] data, int offset, int samples, int channels, int sample_rate);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern void sora_pull_audio(IntPtr p, [Out] float[] data, int offset, int samples, int channels, int sample_rate);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern void sora_set_stream_audio_enabled(IntPtr p, int enabled);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern void sora_enum_audio_streams(IntPtr p, AudioStreamEnumCallbackDelegate f, IntPtr userdata);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern int sora_pull_stream_audio(IntPtr p, string stream_id, [Out] float[] data, int offset, int samples, int channels, int sample_rate);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern int sora_get_stream_audio_sample_rate(IntPtr p, string stream_id);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern void sora_set_stream_audio_spatial(IntPtr p, string stream_id, float gain, float pan, float distance);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern void sora_pull_spatial_audio(IntPtr p, [Out] float[] data, int offset, int samples, int channels, int sample_rate);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern int sora_get_audio_levels(IntPtr p, [In, Out] AudioLevel[] levels, int max_levels);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern int sora_get_stream_stats(IntPtr p, [In, Out] StreamStats[] stats, int max_stats);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern void sora_set_stats_sampling(IntPtr p, int interval_ms, int history_size);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern int sora_get_stream_stats_history(IntPtr p, string stream_id, string kind, int inbound, [In, Out] StreamStats[] stats, int max_stats);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
 #endif
     private static extern void sora_set_on_handle_audio(IntPtr p, HandleAudioCallbackDelegate on_handle_audio, IntPtr userdata);
 #if UNITY_IOS && !UNITY_EDITOR
@@ -457,6 +894,30 @@ public class Sora : IDisposable
     [DllImport("__Internal")]
 #else
     [DllImport("SoraUnitySdk")]
+#endif
+    private static extern void sora_set_keepalive(IntPtr p, int keepalive_interval_ms, int room_refresh_interval_ms);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern void sora_set_reconnect(IntPtr p, int max_attempts, int base_delay_ms, int max_delay_ms);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern void sora_set_candidate_batching(IntPtr p, int window_ms);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
+#endif
+    private static extern void sora_get_signaling_stats(IntPtr p, out SignalingStats stats);
+#if UNITY_IOS && !UNITY_EDITOR
+    [DllImport("__Internal")]
+#else
+    [DllImport("SoraUnitySdk")]
 #endif
     private static extern int sora_device_enum_video_capturer(DeviceEnumCallbackDelegate f, IntPtr userdata);
 #if UNITY_IOS && !UNITY_EDITOR
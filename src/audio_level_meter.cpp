@@ -0,0 +1,67 @@
+#include "audio_level_meter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace sora {
+
+// ノイズレベルよりこれだけ大きければ発話とみなす（約 +10dB）
+static const float kVoiceToNoiseRatio = 3.0f;
+// 発話とみなす最小の RMS（約 -50dBFS）
+static const float kMinVoiceLevel = 0.003f;
+// 発話が途切れてからも発話中として扱う時間
+static const int kHangoverMs = 300;
+// ノイズレベルがレベルの上昇に追従する速さ（1 回の Process あたり）。
+// 10 ミリ秒ずつなら時定数は 20 秒程度になるので、話し続けても発話を見失わない。
+static const float kNoiseFloorRise = 0.0005f;
+
+void AudioLevelMeter::Process(const int16_t* data,
+                              size_t frames,
+                              int channels,
+                              int sample_rate) {
+  size_t size = frames * channels;
+  if (size == 0) {
+    return;
+  }
+  // 分岐の無いループにして、コンパイラにベクトル化させる
+  int64_t sum = 0;
+  int max = 0;
+  for (size_t i = 0; i < size; i++) {
+    int v = data[i];
+    sum += v * v;
+    max = std::max(max, std::abs(v));
+  }
+  float rms = std::sqrt((float)sum / size) / 32768.0f;
+  float peak = max / 32768.0f;
+
+  // ノイズレベルは下がる時はすぐに、上がる時はゆっくり追従させる
+  if (rms < noise_floor_) {
+    noise_floor_ = rms;
+  } else {
+    noise_floor_ += (rms - noise_floor_) * kNoiseFloorRise;
+  }
+  bool voice = rms > kMinVoiceLevel && rms > noise_floor_ * kVoiceToNoiseRatio;
+  if (voice) {
+    hangover_frames_ = (int64_t)sample_rate * kHangoverMs / 1000;
+  } else if (hangover_frames_ > 0) {
+    hangover_frames_ -= frames;
+    voice = true;
+  }
+
+  uint32_t q_rms = (uint32_t)(std::min(rms, 1.0f) * 0x7fff);
+  uint32_t q_peak = (uint32_t)(std::min(peak, 1.0f) * 0x7fff);
+  snapshot_.store(q_rms | (q_peak << 15) | ((voice ? 1u : 0u) << 31),
+                  std::memory_order_relaxed);
+}
+
+AudioLevelMeter::Level AudioLevelMeter::GetLevel() const {
+  uint32_t snapshot = snapshot_.load(std::memory_order_relaxed);
+  Level level;
+  level.rms = (snapshot & 0x7fff) / (float)0x7fff;
+  level.peak = ((snapshot >> 15) & 0x7fff) / (float)0x7fff;
+  level.voice_active = (snapshot >> 31) != 0;
+  return level;
+}
+
+}  // namespace sora
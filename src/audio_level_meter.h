@@ -0,0 +1,44 @@
+#ifndef SORA_AUDIO_LEVEL_METER_H_INCLUDED
+#define SORA_AUDIO_LEVEL_METER_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+namespace sora {
+
+// 音声の RMS・ピークと、エネルギーによる簡易的な発話検出（VAD）
+//
+// Process は音声のスレッドから 10 ミリ秒程度ずつ呼び出し、
+// GetLevel は任意のスレッドから呼び出して良い。
+// 結果は 1 つの atomic にまとめて保存するので、ロックは取らない。
+class AudioLevelMeter {
+ public:
+  struct Level {
+    // 0.0 〜 1.0
+    float rms;
+    float peak;
+    bool voice_active;
+  };
+
+  // data はインターリーブされた frames * channels サンプル
+  void Process(const int16_t* data,
+               size_t frames,
+               int channels,
+               int sample_rate);
+  Level GetLevel() const;
+
+ private:
+  // 以下は Process からのみ触る
+  // 無音時のレベルの推定値
+  float noise_floor_ = 0.001f;
+  // 発話が途切れてから、発話中として扱い続ける残りサンプル数
+  int64_t hangover_frames_ = 0;
+
+  // 下位 15 ビットが RMS、次の 15 ビットがピーク、最上位ビットが VAD
+  std::atomic<uint32_t> snapshot_ = {0};
+};
+
+}  // namespace sora
+
+#endif  // SORA_AUDIO_LEVEL_METER_H_INCLUDED
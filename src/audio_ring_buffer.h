@@ -0,0 +1,114 @@
+#ifndef SORA_AUDIO_RING_BUFFER_H_INCLUDED
+#define SORA_AUDIO_RING_BUFFER_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace sora {
+
+// 固定長の lock-free single-producer/single-consumer リングバッファ
+//
+// 書き込み側と読み込み側はそれぞれ単一のスレッドから呼び出すこと。
+// 領域は Reset でのみ確保するので、Write/Read でメモリ確保が発生することは無い。
+// WriteRegion/ReadRegion を使うと、リング上のメモリに直接読み書きできる。
+// 容量を読み込み単位の倍数にしておけば、その単位の読み込みは常に連続した領域になる。
+class AudioRingBuffer {
+ public:
+  AudioRingBuffer() = default;
+  AudioRingBuffer(const AudioRingBuffer&) = delete;
+  AudioRingBuffer& operator=(const AudioRingBuffer&) = delete;
+
+  // capacity サンプル分の領域を確保して空にする。
+  // 読み書きしているスレッドが無い時に呼ぶこと。
+  void Reset(size_t capacity) {
+    if (capacity != capacity_) {
+      buffer_.reset(new int16_t[capacity]);
+      capacity_ = capacity;
+    }
+    write_pos_ = 0;
+    read_pos_ = 0;
+  }
+
+  size_t Capacity() const { return capacity_; }
+  // 読み込み可能なサンプル数
+  size_t Size() const {
+    return write_pos_.load(std::memory_order_acquire) -
+           read_pos_.load(std::memory_order_acquire);
+  }
+
+  // 書き込み側: 連続して書き込める領域を返す
+  int16_t* WriteRegion(size_t* size) {
+    size_t write_pos = write_pos_.load(std::memory_order_relaxed);
+    size_t read_pos = read_pos_.load(std::memory_order_acquire);
+    size_t offset = write_pos % capacity_;
+    *size = std::min(capacity_ - (write_pos - read_pos), capacity_ - offset);
+    return buffer_.get() + offset;
+  }
+  // 書き込み側: WriteRegion で返した領域に書き込んだサンプル数を確定する
+  void Commit(size_t size) {
+    write_pos_.store(write_pos_.load(std::memory_order_relaxed) + size,
+                     std::memory_order_release);
+  }
+  // 書き込み側: 入り切らなかった分は書き込まずに、書き込んだサンプル数を返す
+  size_t Write(const int16_t* data, size_t size) {
+    size_t written = 0;
+    while (written < size) {
+      size_t n;
+      int16_t* dst = WriteRegion(&n);
+      n = std::min(n, size - written);
+      if (n == 0) {
+        break;
+      }
+      std::copy(data + written, data + written + n, dst);
+      Commit(n);
+      written += n;
+    }
+    return written;
+  }
+
+  // 読み込み側: 連続して読み込める領域を返す
+  const int16_t* ReadRegion(size_t* size) const {
+    size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+    size_t write_pos = write_pos_.load(std::memory_order_acquire);
+    size_t offset = read_pos % capacity_;
+    *size = std::min(write_pos - read_pos, capacity_ - offset);
+    return buffer_.get() + offset;
+  }
+  // 読み込み側: ReadRegion で返した領域から読み込んだサンプル数を確定する
+  void Consume(size_t size) {
+    read_pos_.store(read_pos_.load(std::memory_order_relaxed) + size,
+                    std::memory_order_release);
+  }
+  // 読み込み側: 足りない分は読み込まずに、読み込んだサンプル数を返す
+  size_t Read(int16_t* data, size_t size) {
+    size_t read = 0;
+    while (read < size) {
+      size_t n;
+      const int16_t* src = ReadRegion(&n);
+      n = std::min(n, size - read);
+      if (n == 0) {
+        break;
+      }
+      std::copy(src, src + n, data + read);
+      Consume(n);
+      read += n;
+    }
+    return read;
+  }
+
+ private:
+  std::unique_ptr<int16_t[]> buffer_;
+  size_t capacity_ = 0;
+  // 書き込み・読み込みの通算位置。容量で割った余りがリング上の位置になる
+  char pad0_[64];
+  std::atomic<size_t> write_pos_ = {0};
+  char pad1_[64];
+  std::atomic<size_t> read_pos_ = {0};
+};
+
+}  // namespace sora
+
+#endif  // SORA_AUDIO_RING_BUFFER_H_INCLUDED
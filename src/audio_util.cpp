@@ -0,0 +1,130 @@
+#include "audio_util.h"
+
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SORA_AUDIO_UTIL_SSE2
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SORA_AUDIO_UTIL_NEON
+#endif
+
+namespace sora {
+
+// この距離までは減衰させない
+static const float kReferenceDistance = 1.0f;
+// 距離による減衰の強さ（1.0 で距離に反比例）
+static const float kRolloffFactor = 1.0f;
+
+// SIMD 版と結果を揃えるため、NaN は 0 にして、丸めは最近接偶数にする。
+// _mm_cvtps_epi32 と vcvtnq_s32_f32 も既定では最近接偶数で丸める。
+static inline int16_t FloatToS16Scalar(float v) {
+  // 先に範囲を制限しておけば int への変換で溢れることは無い。
+  v = v > 1.0f ? 1.0f : (v < -1.0f ? -1.0f : (v == v ? v : 0.0f));
+  long n = lrintf(v * 32768.0f);
+  return (int16_t)(n > 32767 ? 32767 : n);
+}
+
+void FloatToS16(const float* src, size_t size, int16_t* dst) {
+  size_t i = 0;
+#if defined(SORA_AUDIO_UTIL_SSE2)
+  const __m128 max = _mm_set1_ps(1.0f);
+  const __m128 min = _mm_set1_ps(-1.0f);
+  const __m128 scale = _mm_set1_ps(32768.0f);
+  for (; i + 8 <= size; i += 8) {
+    __m128 a = _mm_loadu_ps(src + i);
+    __m128 b = _mm_loadu_ps(src + i + 4);
+    // NaN はそのままだと min/max で 1.0 になるので、先に 0 にしておく
+    a = _mm_and_ps(a, _mm_cmpord_ps(a, a));
+    b = _mm_and_ps(b, _mm_cmpord_ps(b, b));
+    a = _mm_mul_ps(_mm_max_ps(_mm_min_ps(a, max), min), scale);
+    b = _mm_mul_ps(_mm_max_ps(_mm_min_ps(b, max), min), scale);
+    // 32768 は packs で 32767 に飽和する
+    __m128i s = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+    _mm_storeu_si128((__m128i*)(dst + i), s);
+  }
+#elif defined(SORA_AUDIO_UTIL_NEON)
+  const float32x4_t max = vdupq_n_f32(1.0f);
+  const float32x4_t min = vdupq_n_f32(-1.0f);
+  for (; i + 8 <= size; i += 8) {
+    float32x4_t a = vld1q_f32(src + i);
+    float32x4_t b = vld1q_f32(src + i + 4);
+    // NaN は 0 にしておく
+    a = vreinterpretq_f32_u32(
+        vandq_u32(vreinterpretq_u32_f32(a), vceqq_f32(a, a)));
+    b = vreinterpretq_f32_u32(
+        vandq_u32(vreinterpretq_u32_f32(b), vceqq_f32(b, b)));
+    a = vmulq_n_f32(vmaxq_f32(vminq_f32(a, max), min), 32768.0f);
+    b = vmulq_n_f32(vmaxq_f32(vminq_f32(b, max), min), 32768.0f);
+    int16x8_t s = vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)),
+                               vqmovn_s32(vcvtnq_s32_f32(b)));
+    vst1q_s16(dst + i, s);
+  }
+#endif
+  for (; i < size; i++) {
+    dst[i] = FloatToS16Scalar(src[i]);
+  }
+}
+
+void S16ToFloat(const int16_t* src,
+                size_t frames,
+                int src_channels,
+                float* dst,
+                int dst_channels) {
+  const float scale = 1.0f / 32768.0f;
+  if (src_channels == dst_channels) {
+    // ループを単純にしておけば、コンパイラがベクトル化してくれる
+    size_t size = frames * dst_channels;
+    for (size_t i = 0; i < size; i++) {
+      dst[i] = src[i] * scale;
+    }
+    return;
+  }
+  for (size_t i = 0; i < frames; i++) {
+    const int16_t* s = src + i * src_channels;
+    float* d = dst + i * dst_channels;
+    for (int c = 0; c < dst_channels; c++) {
+      int sc = src_channels == 1 ? 0 : c;
+      d[c] = sc < src_channels ? s[sc] * scale : 0.0f;
+    }
+  }
+}
+
+void MixS16Stereo(const int16_t* src,
+                  size_t frames,
+                  float left_gain,
+                  float right_gain,
+                  float left_step,
+                  float right_step,
+                  float* dst) {
+  const float scale = 1.0f / 32768.0f;
+  left_gain *= scale;
+  right_gain *= scale;
+  left_step *= scale;
+  right_step *= scale;
+  // 分岐の無いループにして、コンパイラにベクトル化させる
+  for (size_t i = 0; i < frames; i++) {
+    dst[i * 2] += src[i * 2] * (left_gain + left_step * i);
+    dst[i * 2 + 1] += src[i * 2 + 1] * (right_gain + right_step * i);
+  }
+}
+
+void SpatialGains(float gain,
+                  float pan,
+                  float distance,
+                  float* left_gain,
+                  float* right_gain) {
+  distance = distance > kReferenceDistance ? distance : kReferenceDistance;
+  float attenuation =
+      kReferenceDistance /
+      (kReferenceDistance + kRolloffFactor * (distance - kReferenceDistance));
+  pan = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan);
+  float angle = (pan + 1.0f) * 0.25f * 3.14159265f;
+  gain = (gain > 0.0f ? gain : 0.0f) * attenuation;
+  *left_gain = gain * cosf(angle);
+  *right_gain = gain * sinf(angle);
+}
+
+}  // namespace sora
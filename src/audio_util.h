@@ -0,0 +1,45 @@
+#ifndef SORA_AUDIO_UTIL_H_INCLUDED
+#define SORA_AUDIO_UTIL_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sora {
+
+// [-1.0, 1.0] の float サンプルを int16 に変換する。
+// 範囲外の値は飽和させ、NaN は 0 にして、最近接偶数に丸める。
+// SSE2/NEON が使える環境では 8 サンプルずつまとめて変換するが、結果は同じになる。
+void FloatToS16(const float* src, size_t size, int16_t* dst);
+
+// インターリーブされた int16 の音声を、チャンネル数を合わせながら float に変換する。
+// frames は 1 チャンネルあたりのサンプル数。
+// モノラルは全チャンネルに出し、それ以外は同じ番号のチャンネルに出す。
+// 対応するチャンネルが無い場合は無音にする。
+void S16ToFloat(const int16_t* src,
+                size_t frames,
+                int src_channels,
+                float* dst,
+                int dst_channels);
+
+// ステレオの int16 の音声に左右別々のゲインを掛けて、dst に足し込む。
+// ゲインは 1 サンプル毎に left_step, right_step ずつ変化させる。
+void MixS16Stereo(const int16_t* src,
+                  size_t frames,
+                  float left_gain,
+                  float right_gain,
+                  float left_step,
+                  float right_step,
+                  float* dst);
+
+// 音量、パン、聞き手からの距離から、MixS16Stereo に渡す左右のゲインを計算する。
+// pan は -1.0（左）〜 1.0（右）で、等パワーのパンニングにする（中央では左右とも -3dB）。
+// 距離による減衰は OpenAL の AL_INVERSE_DISTANCE_CLAMPED と同じ。
+void SpatialGains(float gain,
+                  float pan,
+                  float distance,
+                  float* left_gain,
+                  float* right_gain);
+
+}  // namespace sora
+
+#endif  // SORA_AUDIO_UTIL_H_INCLUDED
@@ -0,0 +1,124 @@
+#include "candidate_batcher.h"
+
+#include <boost/beast/core/bind_handler.hpp>
+
+#include "rtc_base/logging.h"
+
+namespace sora {
+
+std::shared_ptr<CandidateBatcher> CandidateBatcher::Create(strand_t strand,
+                                                           int window_ms,
+                                                           Handler handler) {
+  return std::shared_ptr<CandidateBatcher>(
+      new CandidateBatcher(strand, window_ms, std::move(handler)));
+}
+
+CandidateBatcher::CandidateBatcher(strand_t strand,
+                                   int window_ms,
+                                   Handler handler)
+    : strand_(strand), window_ms_(window_ms), handler_(std::move(handler)) {}
+
+void CandidateBatcher::OnDescription(const std::string& stream_id,
+                                     const std::string& type,
+                                     const std::string& sdp) {
+  if (window_ms_ <= 0) {
+    handler_.send_description(stream_id, type, sdp);
+    return;
+  }
+  // A description created again for the same stream replaces the held one,
+  // together with its candidates, which belong to the old ICE session.
+  Held& held = held_[stream_id];
+  held.type = type;
+  held.sdp = sdp;
+  held.candidates.clear();
+  held.seq = ++next_seq_;
+  if (held.timer == nullptr) {
+    held.timer.reset(new boost::asio::steady_timer(strand_));
+  }
+  held.timer->expires_after(std::chrono::milliseconds(window_ms_));
+  held.timer->async_wait(boost::beast::bind_front_handler(
+      &CandidateBatcher::OnTimer, shared_from_this(), stream_id, held.seq));
+}
+
+void CandidateBatcher::OnCandidate(const std::string& stream_id,
+                                   Candidate candidate) {
+  auto it = held_.find(stream_id);
+  if (it == held_.end()) {
+    handler_.send_candidate(stream_id, candidate);
+    return;
+  }
+  it->second.candidates.push_back(std::move(candidate));
+}
+
+/*
+End of candidates: the local description now carries every candidate as an
+a=candidate line, so it replaces the held description and all the
+takeCandidate messages.
+*/
+void CandidateBatcher::OnGatheringComplete(const std::string& stream_id,
+                                           const std::string& sdp) {
+  auto it = held_.find(stream_id);
+  if (it == held_.end()) {
+    return;
+  }
+  it->second.timer->cancel();
+  if (sdp.empty()) {
+    // The description could not be serialized; send what was held instead.
+    Flush(it);
+    return;
+  }
+  std::string type = std::move(it->second.type);
+  RTC_LOG(LS_INFO) << "Send " << type << " with candidates: stream_id="
+                   << stream_id
+                   << " candidates=" << it->second.candidates.size();
+  held_.erase(it);
+  handler_.send_description(stream_id, type, sdp);
+}
+
+/*
+The window ran out before gathering completed. Falls back to trickle ICE: the
+description as created, then the candidates found so far, back to back. Later
+candidates are sent as they are found.
+*/
+void CandidateBatcher::OnTimer(std::string stream_id,
+                               uint64_t seq,
+                               boost::system::error_code ec) {
+  if (ec == boost::asio::error::operation_aborted) {
+    return;
+  }
+  auto it = held_.find(stream_id);
+  if (it == held_.end() || it->second.seq != seq) {
+    return;
+  }
+  RTC_LOG(LS_INFO) << "Candidate window expired: stream_id=" << stream_id
+                   << " candidates=" << it->second.candidates.size();
+  Flush(it);
+}
+
+void CandidateBatcher::Flush(std::map<std::string, Held>::iterator it) {
+  std::string stream_id = it->first;
+  Held held = std::move(it->second);
+  held_.erase(it);
+  handler_.send_description(stream_id, held.type, held.sdp);
+  for (const auto& c : held.candidates) {
+    handler_.send_candidate(stream_id, c);
+  }
+}
+
+void CandidateBatcher::Remove(const std::string& stream_id) {
+  auto it = held_.find(stream_id);
+  if (it == held_.end()) {
+    return;
+  }
+  it->second.timer->cancel();
+  held_.erase(it);
+}
+
+void CandidateBatcher::Clear() {
+  for (auto& it : held_) {
+    it.second.timer->cancel();
+  }
+  held_.clear();
+}
+
+}  // namespace sora
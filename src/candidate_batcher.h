@@ -0,0 +1,96 @@
+#ifndef SORA_CANDIDATE_BATCHER_H_INCLUDED
+#define SORA_CANDIDATE_BATCHER_H_INCLUDED
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+
+namespace sora {
+
+// ローカルの ICE 候補を offer/answer の SDP にまとめて送る
+//
+// シグナリングサーバは takeCandidate 1 つにつき候補を 1 つしか受け取らないので、
+// メッセージを減らすには候補を SDP に含めて送るしかない。
+// 作った SDP をストリーム毎に最大 window_ms 保留し、その間に候補の収集が終われば
+// (end-of-candidates) 全ての候補を含む SDP を 1 つだけ送る。
+// 収集が終わる前に window_ms が経ったら、作った時の SDP と溜めた候補を続けて送り、
+// 以降の候補は見つかり次第 takeCandidate で送る。
+// Create 以外は strand 上で呼ぶこと。Handler のコールバックも strand 上で呼ばれる。
+class CandidateBatcher : public std::enable_shared_from_this<CandidateBatcher> {
+ public:
+  typedef boost::asio::strand<boost::asio::io_context::executor_type> strand_t;
+
+  struct Candidate {
+    std::string sdp_mid;
+    int sdp_mlineindex;
+    std::string sdp;
+  };
+
+  struct Handler {
+    // takeConfiguration を送る
+    std::function<void(const std::string& stream_id,
+                       const std::string& type,
+                       const std::string& sdp)>
+        send_description;
+    // takeCandidate を送る
+    std::function<void(const std::string& stream_id,
+                       const Candidate& candidate)>
+        send_candidate;
+  };
+
+  // window_ms が 0 なら保留せず、SDP も候補も直ちに送る
+  static std::shared_ptr<CandidateBatcher> Create(strand_t strand,
+                                                  int window_ms,
+                                                  Handler handler);
+
+  // ローカルの SDP を作った
+  void OnDescription(const std::string& stream_id,
+                     const std::string& type,
+                     const std::string& sdp);
+  // ローカルの ICE 候補が見つかった。SDP を保留している間は溜めておく
+  void OnCandidate(const std::string& stream_id, Candidate candidate);
+  // 候補の収集が終わった。sdp は集まった全ての候補を含むローカルの SDP で、
+  // 保留していればこれを送り、溜めた候補は送らない
+  void OnGatheringComplete(const std::string& stream_id,
+                           const std::string& sdp);
+  // ストリームを破棄した。保留していた SDP と候補は送らない
+  void Remove(const std::string& stream_id);
+  void Clear();
+
+  // SDP を保留しているストリームの数
+  size_t HeldCount() const { return held_.size(); }
+
+ private:
+  CandidateBatcher(strand_t strand, int window_ms, Handler handler);
+  void OnTimer(std::string stream_id,
+               uint64_t seq,
+               boost::system::error_code ec);
+
+  struct Held {
+    std::string type;
+    std::string sdp;
+    std::vector<Candidate> candidates;
+    // 同じストリームの SDP を作り直した場合に、前のタイマーを無視するため
+    uint64_t seq;
+    std::unique_ptr<boost::asio::steady_timer> timer;
+  };
+  // 作った時の SDP と溜めた候補を続けて送る
+  void Flush(std::map<std::string, Held>::iterator it);
+
+  strand_t strand_;
+  int window_ms_;
+  Handler handler_;
+  std::map<std::string, Held> held_;
+  uint64_t next_seq_ = 0;
+};
+
+}  // namespace sora
+
+#endif  // SORA_CANDIDATE_BATCHER_H_INCLUDED
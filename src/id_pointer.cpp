@@ -1,27 +1,121 @@
 #include "id_pointer.h"
 
+#include <thread>
+
+#include "rtc_base/logging.h"
+
 namespace sora {
 
+// IdPointer::Pinned
+
+IdPointer::Pinned::Pinned(std::atomic<uint32_t>* pins, void* pointer)
+    : pins_(pins), pointer_(pointer) {}
+IdPointer::Pinned::Pinned(Pinned&& other)
+    : pins_(other.pins_), pointer_(other.pointer_) {
+  other.pins_ = nullptr;
+  other.pointer_ = nullptr;
+}
+IdPointer::Pinned& IdPointer::Pinned::operator=(Pinned&& other) {
+  if (this != &other) {
+    Reset();
+    pins_ = other.pins_;
+    pointer_ = other.pointer_;
+    other.pins_ = nullptr;
+    other.pointer_ = nullptr;
+  }
+  return *this;
+}
+IdPointer::Pinned::~Pinned() {
+  Reset();
+}
+void IdPointer::Pinned::Reset() {
+  if (pins_ != nullptr) {
+    pins_->fetch_sub(1, std::memory_order_release);
+  }
+  pins_ = nullptr;
+  pointer_ = nullptr;
+}
+
+// IdPointer
+
+IdPointer::IdPointer() {
+  // 小さいスロット番号から使う
+  for (uint32_t i = 1; i < kCapacity; i++) {
+    free_indices_[free_count_++] = i;
+  }
+}
+
 IdPointer& IdPointer::Instance() {
   static IdPointer ip;
   return ip;
 }
 ptrid_t IdPointer::Register(void* p) {
   std::lock_guard<std::mutex> guard(mutex_);
-  map_[counter_] = p;
-  return counter_++;
+  if (free_count_ == 0) {
+    RTC_LOG(LS_ERROR) << "IdPointer: no free slot";
+    return 0;
+  }
+  uint32_t index = free_indices_[free_head_];
+  free_head_ = (free_head_ + 1) % kCapacity;
+  free_count_--;
+  Slot& slot = slots_[index];
+  slot.pointer.store(p, std::memory_order_release);
+  uint32_t generation = slot.generation.load(std::memory_order_relaxed);
+  return (generation << kIndexBits) | index;
 }
 void IdPointer::Unregister(ptrid_t id) {
+  uint32_t index = id & kIndexMask;
+  uint32_t generation = id >> kIndexBits;
+  if (index == 0) {
+    return;
+  }
+  Slot& slot = slots_[index];
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (slot.generation.load(std::memory_order_relaxed) != generation) {
+      return;
+    }
+    // 先にポインタを消してから世代を進める。
+    // Lookup は世代を読む → ピン留めする → 世代を読み直す ので、
+    // ここより後に Lookup したスレッドは必ず失敗する
+    slot.pointer.store(nullptr, std::memory_order_seq_cst);
+    slot.generation.store((generation + 1) & kGenerationMask,
+                          std::memory_order_seq_cst);
+  }
+
+  // 世代を進める前にピン留めしたスレッドが使い終わるまで待つ
+  while (slot.pins.load(std::memory_order_seq_cst) != 0) {
+    std::this_thread::yield();
+  }
+
   std::lock_guard<std::mutex> guard(mutex_);
-  map_.erase(id);
+  if (generation == kGenerationMask) {
+    // 次に使うと世代番号が一周して古い ID と同じになるので、このスロットは二度と使わない
+    RTC_LOG(LS_WARNING) << "IdPointer: slot " << index << " retired";
+    return;
+  }
+  free_indices_[(free_head_ + free_count_) % kCapacity] = index;
+  free_count_++;
 }
-void* IdPointer::Lookup(ptrid_t id) {
-  std::lock_guard<std::mutex> guard(mutex_);
-  auto it = map_.find(id);
-  if (it == map_.end()) {
-    return nullptr;
+IdPointer::Pinned IdPointer::Lookup(ptrid_t id) {
+  uint32_t index = id & kIndexMask;
+  uint32_t generation = id >> kIndexBits;
+  if (index == 0) {
+    return Pinned();
+  }
+  Slot& slot = slots_[index];
+  if (slot.generation.load(std::memory_order_acquire) != generation) {
+    return Pinned();
+  }
+  slot.pins.fetch_add(1, std::memory_order_seq_cst);
+  // ピン留めした後で世代が変わっていなければ、Unregister はピン留めが外れるのを待つ
+  void* p = slot.pointer.load(std::memory_order_seq_cst);
+  if (slot.generation.load(std::memory_order_seq_cst) != generation ||
+      p == nullptr) {
+    slot.pins.fetch_sub(1, std::memory_order_release);
+    return Pinned();
   }
-  return it->second;
+  return Pinned(&slot.pins, p);
 }
 
 }  // namespace sora
@@ -1,7 +1,8 @@
 #ifndef SORA_ID_POINTER_H_INCLUDED
 #define SORA_ID_POINTER_H_INCLUDED
 
-#include <map>
+#include <stdint.h>
+#include <atomic>
 #include <mutex>
 
 #include "unity.h"
@@ -10,16 +11,76 @@ namespace sora {
 
 // TextureUpdateCallback のユーザデータが 32bit 整数しか扱えないので、
 // ID からポインタに変換する仕組みを用意する
+//
+// ID は下位 kIndexBits ビットがスロット番号、その上が世代番号になっていて、
+// Unregister するとスロットの世代番号が進むので、古い ID で Lookup しても
+// 再利用されたスロットのポインタを返すことは無い。
+// 世代番号が一周するスロットは二度と使わないので、同じ ID が別のポインタを指すことも無い。
+// 空きスロットは古く空いたものから順に使うので、一周するのは
+// 全スロット合わせて 20 億回程度 Register した後になる。
+//
+// Lookup はロックを取らずに、スロットをピン留めした Pinned を返す。
+// Unregister はピン留めが全て外れるまで待つので、Pinned を持っている間は
+// ポインタの指す先は破棄されない。
+// そのため Unregister は、登録したオブジェクトのデストラクタの最初で呼ぶこと。
+// また Pinned を持ったまま Unregister を呼ぶスレッドを待つとデッドロックするので、
+// Pinned はコールバックの中など、短い間だけ持つこと。
 class IdPointer {
+  static const int kIndexBits = 12;
+  // Unity のイベント ID は int なので、ID が負にならないように 31 ビットに収める
+  static const int kGenerationBits = 31 - kIndexBits;
+  static const uint32_t kIndexMask = (1u << kIndexBits) - 1;
+  static const uint32_t kGenerationMask = (1u << kGenerationBits) - 1;
+  // 0 番目のスロットは使わないので、ID が 0 になることは無い
+  static const int kCapacity = 1 << kIndexBits;
+
+  // 別のスレッドが隣のスロットをピン留めしても、キャッシュラインを取り合わないようにする
+  struct alignas(64) Slot {
+    std::atomic<uint32_t> generation = {0};
+    std::atomic<void*> pointer = {nullptr};
+    // Lookup でピン留めしている数
+    std::atomic<uint32_t> pins = {0};
+  };
+
   std::mutex mutex_;
-  ptrid_t counter_ = 1;
-  std::map<ptrid_t, void*> map_;
+  // 空きスロットの FIFO
+  uint32_t free_indices_[kCapacity];
+  int free_head_ = 0;
+  int free_count_ = 0;
+  Slot slots_[kCapacity];
+
+  IdPointer();
 
  public:
+  // Lookup の結果。生きている間はポインタの指す先が Unregister されない
+  class Pinned {
+   public:
+    Pinned() = default;
+    Pinned(Pinned&& other);
+    Pinned& operator=(Pinned&& other);
+    Pinned(const Pinned&) = delete;
+    Pinned& operator=(const Pinned&) = delete;
+    ~Pinned();
+
+    void* get() const { return pointer_; }
+    explicit operator bool() const { return pointer_ != nullptr; }
+
+   private:
+    friend class IdPointer;
+    Pinned(std::atomic<uint32_t>* pins, void* pointer);
+    void Reset();
+
+    std::atomic<uint32_t>* pins_ = nullptr;
+    void* pointer_ = nullptr;
+  };
+
   static IdPointer& Instance();
+  // 空きスロットが無い場合は 0 を返す
   ptrid_t Register(void* p);
+  // 以降の Lookup は失敗するようになり、ピン留めが全て外れるまで待ってから戻る
   void Unregister(ptrid_t id);
-  void* Lookup(ptrid_t id);
+  // 登録されていない、または Unregister された ID なら空の Pinned を返す
+  Pinned Lookup(ptrid_t id);
 };
 
 }  // namespace sora
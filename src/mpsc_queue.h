@@ -0,0 +1,99 @@
+#ifndef SORA_MPSC_QUEUE_H_INCLUDED
+#define SORA_MPSC_QUEUE_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+namespace sora {
+
+// 固定長の lock-free multi-producer/single-consumer キュー
+//
+// 各セルにシーケンス番号を持たせた bounded queue で、Push は任意のスレッドから、
+// Pop は単一のスレッド（Unity スレッド）からのみ呼び出すこと。
+// セルは構築時に確保しておくので、Push/Pop でキュー自体がメモリを確保することは無い。
+// キューが一杯の場合、Push は v を変更せずに false を返す。捨てるかどうかは呼び出し側で決める。
+template <class T>
+class MpscQueue {
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+ public:
+  // capacity は 2 の累乗に切り上げられる
+  explicit MpscQueue(size_t capacity) {
+    size_t n = 2;
+    while (n < capacity) {
+      n <<= 1;
+    }
+    mask_ = n - 1;
+    cells_.reset(new Cell[n]);
+    for (size_t i = 0; i < n; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  bool Push(T&& v) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                               std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->data = std::move(v);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  // consumer スレッドからのみ呼ぶこと
+  bool Pop(T& v) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    Cell* cell = &cells_[pos & mask_];
+    size_t seq = cell->sequence.load(std::memory_order_acquire);
+    if ((intptr_t)seq - (intptr_t)(pos + 1) < 0) {
+      return false;
+    }
+    v = std::move(cell->data);
+    cell->data = T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // 現在キューに積まれている（積まれようとしている）要素数のおおよその値
+  size_t Size() const {
+    size_t enq = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t deq = dequeue_pos_.load(std::memory_order_relaxed);
+    return enq > deq ? enq - deq : 0;
+  }
+  size_t Capacity() const { return mask_ + 1; }
+
+ private:
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+  // producer と consumer が同じキャッシュラインを取り合わないようにする
+  char pad0_[64];
+  std::atomic<size_t> enqueue_pos_ = {0};
+  char pad1_[64];
+  std::atomic<size_t> dequeue_pos_ = {0};
+};
+
+}  // namespace sora
+
+#endif  // SORA_MPSC_QUEUE_H_INCLUDED
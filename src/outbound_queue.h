@@ -0,0 +1,71 @@
+#ifndef SORA_OUTBOUND_QUEUE_H_INCLUDED
+#define SORA_OUTBOUND_QUEUE_H_INCLUDED
+
+#include <stddef.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace sora {
+
+// 送信待ちのメッセージのリングバッファ
+//
+// 各スロットの文字列は送信後も容量を残したまま再利用するので、
+// Prepare/Commit でスロットに直接メッセージを書き込めばメモリ確保は発生しない。
+// Push で渡された文字列はスロットの文字列と交換するだけでコピーはしない。
+// 一杯になった場合は容量を倍にする。
+// 単一のスレッドからのみ触ること。
+class OutboundQueue {
+ public:
+  explicit OutboundQueue(size_t capacity = 16) : slots_(capacity) {}
+
+  // 末尾のスロットを空にして返す。書き込んだら Commit を呼ぶこと
+  std::string& Prepare() {
+    if (size_ == slots_.size()) {
+      Grow();
+    }
+    std::string& slot = slots_[(head_ + size_) % slots_.size()];
+    slot.clear();
+    return slot;
+  }
+  void Commit() { size_++; }
+
+  void Push(std::string&& text) {
+    Prepare().swap(text);
+    Commit();
+  }
+
+  bool Empty() const { return size_ == 0; }
+  size_t Size() const { return size_; }
+  // 先頭から i 番目のメッセージ
+  const std::string& At(size_t i) const {
+    return slots_[(head_ + i) % slots_.size()];
+  }
+  const std::string& Front() const { return At(0); }
+  void Pop() {
+    head_ = (head_ + 1) % slots_.size();
+    size_--;
+  }
+  void Clear() {
+    head_ = 0;
+    size_ = 0;
+  }
+
+ private:
+  void Grow() {
+    std::vector<std::string> slots(slots_.size() * 2);
+    for (size_t i = 0; i < size_; i++) {
+      slots[i].swap(slots_[(head_ + i) % slots_.size()]);
+    }
+    slots_.swap(slots);
+    head_ = 0;
+  }
+
+  std::vector<std::string> slots_;
+  size_t head_ = 0;
+  size_t size_ = 0;
+};
+
+}  // namespace sora
+
+#endif  // SORA_OUTBOUND_QUEUE_H_INCLUDED
@@ -0,0 +1,91 @@
+#include "plane_extractor.h"
+
+#include <string.h>
+
+namespace sora {
+
+namespace {
+
+void InterleaveUV(const uint8_t* u, const uint8_t* v, int width, uint8_t* dst) {
+  for (int x = 0; x < width; x++) {
+    dst[x * 2] = u[x];
+    dst[x * 2 + 1] = v[x];
+  }
+}
+
+}  // namespace
+
+void PlaneExtractor::CopyPlane(const PlaneView& src, uint8_t* dst) {
+  for (int y = 0; y < src.height; y++) {
+    memcpy(dst + (size_t)y * src.width, src.data + (size_t)y * src.stride,
+           src.width);
+  }
+}
+
+const uint8_t* PlaneExtractor::Extract(const PlaneView& y,
+                                       const PlaneView& u,
+                                       const PlaneView& v,
+                                       TexturePlane plane,
+                                       int dst_width,
+                                       int dst_height,
+                                       size_t* bytes_copied) {
+  std::vector<uint8_t>& buf = plane_bufs_[(int)plane];
+  *bytes_copied = 0;
+
+  if (plane == TexturePlane::UV) {
+    size_t size = (size_t)dst_width * dst_height * 2;
+    if (buf.size() < size) {
+      buf.resize(size);
+    }
+    const bool same_size = u.width == dst_width && u.height == dst_height;
+    if (!same_size) {
+      chroma_scaler_.Configure(u.width, u.height, dst_width, dst_height);
+      if (row_buf_.size() < (size_t)dst_width * 2) {
+        row_buf_.resize((size_t)dst_width * 2);
+      }
+    }
+    // U, V の行を（必要ならスケーリングして）すぐに交互に並べる
+    for (int row = 0; row < dst_height; row++) {
+      const uint8_t* u_row = u.data + (size_t)row * u.stride;
+      const uint8_t* v_row = v.data + (size_t)row * v.stride;
+      if (!same_size) {
+        uint8_t* scaled_u = row_buf_.data();
+        uint8_t* scaled_v = scaled_u + dst_width;
+        chroma_scaler_.ScaleRow(u.data, u.stride, row, scaled_u);
+        chroma_scaler_.ScaleRow(v.data, v.stride, row, scaled_v);
+        u_row = scaled_u;
+        v_row = scaled_v;
+      }
+      InterleaveUV(u_row, v_row, dst_width,
+                   buf.data() + (size_t)row * dst_width * 2);
+    }
+    *bytes_copied = size;
+    return buf.data();
+  }
+
+  const PlaneView& src = plane == TexturePlane::Y   ? y
+                         : plane == TexturePlane::U ? u
+                                                    : v;
+
+  // 同じサイズで隙間も無ければ、そのまま渡せる
+  if (src.width == dst_width && src.height == dst_height &&
+      src.stride == src.width) {
+    return src.data;
+  }
+
+  size_t size = (size_t)dst_width * dst_height;
+  if (buf.size() < size) {
+    buf.resize(size);
+  }
+  if (src.width == dst_width && src.height == dst_height) {
+    CopyPlane(src, buf.data());
+  } else {
+    PlaneScaler& scaler = plane == TexturePlane::Y ? y_scaler_ : chroma_scaler_;
+    scaler.Configure(src.width, src.height, dst_width, dst_height);
+    scaler.Scale(src.data, src.stride, buf.data(), dst_width);
+  }
+  *bytes_copied = size;
+  return buf.data();
+}
+
+}  // namespace sora
@@ -0,0 +1,59 @@
+#ifndef SORA_PLANE_EXTRACTOR_H_INCLUDED
+#define SORA_PLANE_EXTRACTOR_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "plane_scaler.h"
+
+namespace sora {
+
+// プレーン毎にテクスチャを更新する場合の対象プレーン。
+// 色変換は Unity 側のシェーダで行う。
+enum class TexturePlane {
+  Y = 0,   // 輝度（1 バイト/ピクセル）
+  U = 1,   // 色差 U（1 バイト/ピクセル）
+  V = 2,   // 色差 V（1 バイト/ピクセル）
+  UV = 3,  // NV12 の色差（U, V の順に 2 バイト/ピクセル）
+};
+static const int kTexturePlaneCount = 4;
+
+// I420 の 1 枚のプレーン
+struct PlaneView {
+  const uint8_t* data;
+  int stride;
+  int width;
+  int height;
+};
+
+// I420 のフレームから、テクスチャに渡すプレーンを取り出す。
+// WebRTC に依存しないので、単体でテストできる。
+class PlaneExtractor {
+ public:
+  // plane を dst_width x dst_height の詰めた（stride == 幅）画像にして返す。
+  // UV の場合は U, V を交互に並べるので、1 行は dst_width * 2 バイトになる。
+  // スケーリングもコピーも不要な場合は元のプレーンのメモリをそのまま返すので、
+  // 返したポインタは元のフレームが生きている間だけ有効。
+  // bytes_copied には書き込んだバイト数が入る。
+  const uint8_t* Extract(const PlaneView& y,
+                         const PlaneView& u,
+                         const PlaneView& v,
+                         TexturePlane plane,
+                         int dst_width,
+                         int dst_height,
+                         size_t* bytes_copied);
+
+ private:
+  static void CopyPlane(const PlaneView& src, uint8_t* dst);
+
+  PlaneScaler y_scaler_;
+  // U と V は同じサイズなので 1 つを使い回す
+  PlaneScaler chroma_scaler_;
+  std::vector<uint8_t> row_buf_;
+  std::vector<uint8_t> plane_bufs_[kTexturePlaneCount];
+};
+
+}  // namespace sora
+
+#endif  // SORA_PLANE_EXTRACTOR_H_INCLUDED
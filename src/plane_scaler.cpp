@@ -0,0 +1,217 @@
+#include "plane_scaler.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+namespace sora {
+
+void PlaneScaler::Configure(int src_width,
+                            int src_height,
+                            int dst_width,
+                            int dst_height) {
+  if (src_width == src_width_ && src_height == src_height_ &&
+      dst_width == dst_width_ && dst_height == dst_height_) {
+    return;
+  }
+  src_width_ = src_width;
+  src_height_ = src_height;
+  dst_width_ = dst_width;
+  dst_height_ = dst_height;
+  BuildFilter(src_width, dst_width, &horizontal_);
+  BuildFilter(src_height, dst_height, &vertical_);
+  row_acc_.resize(src_width);
+  row_.resize(src_width);
+}
+
+void PlaneScaler::BuildFilter(int src_size, int dst_size, Filter* filter) {
+  const int kOne = 1 << kWeightBits;
+  filter->identity = src_size == dst_size;
+  filter->start.assign(dst_size, 0);
+  filter->count.assign(dst_size, 0);
+
+  const double scale = (double)src_size / dst_size;
+  if (src_size > dst_size) {
+    // 縮小: 出力 i は入力の [i * scale, (i + 1) * scale) を覆うので、
+    // 覆っている幅に比例した重みで平均する
+    // 範囲の両端が画素の途中にある場合と、浮動小数点の誤差の分で 2 つ余分に取っておく
+    filter->max_taps = (int)ceil(scale) + 2;
+  } else {
+    // 拡大: 画素の中心を合わせて、隣り合う 2 つの入力を線形補間する
+    filter->max_taps = 2;
+  }
+  filter->max_taps = std::min(filter->max_taps, src_size);
+  filter->weights.assign((size_t)dst_size * filter->max_taps, 0);
+
+  for (int i = 0; i < dst_size; i++) {
+    uint16_t* w = &filter->weights[(size_t)i * filter->max_taps];
+    int start;
+    int count;
+    if (src_size > dst_size) {
+      double lo = i * scale;
+      double hi = std::min((i + 1) * scale, (double)src_size);
+      start = (int)floor(lo);
+      int end = std::min((int)ceil(hi), src_size);
+      count = std::min(end - start, filter->max_taps);
+      for (int k = 0; k < count; k++) {
+        double overlap = std::min(hi, (double)(start + k + 1)) -
+                         std::max(lo, (double)(start + k));
+        w[k] = (uint16_t)lrint(overlap / (hi - lo) * kOne);
+      }
+    } else {
+      double x = (i + 0.5) * scale - 0.5;
+      x = std::max(0.0, std::min(x, (double)(src_size - 1)));
+      start = (int)floor(x);
+      int frac = (int)lrint((x - start) * kOne);
+      if (frac == 0 || start + 1 >= src_size) {
+        count = 1;
+        w[0] = kOne;
+      } else if (frac == kOne) {
+        start++;
+        count = 1;
+        w[0] = kOne;
+      } else {
+        count = 2;
+        w[0] = (uint16_t)(kOne - frac);
+        w[1] = (uint16_t)frac;
+      }
+    }
+    // 丸め誤差は一番重い係数に寄せて、係数の和をちょうど kOne にする
+    int sum = 0;
+    int heaviest = 0;
+    for (int k = 0; k < count; k++) {
+      sum += w[k];
+      if (w[k] > w[heaviest]) {
+        heaviest = k;
+      }
+    }
+    w[heaviest] = (uint16_t)(w[heaviest] + kOne - sum);
+    // 横方向は全ての出力を max_taps 個の係数で計算するので、
+    // 入力の範囲をはみ出さないように開始位置を前にずらして、係数を 0 で埋める
+    int shift = std::max(0, start + filter->max_taps - src_size);
+    if (shift > 0) {
+      for (int k = count - 1; k >= 0; k--) {
+        w[k + shift] = w[k];
+      }
+      for (int k = 0; k < shift; k++) {
+        w[k] = 0;
+      }
+      start -= shift;
+      count += shift;
+    }
+    filter->start[i] = start;
+    filter->count[i] = count;
+  }
+}
+
+namespace {
+
+// 横方向の補間。係数の数を固定すると、内側のループが展開される
+template <int kTaps>
+void ScaleCols(const uint16_t* row,
+               const int* start,
+               const uint16_t* weights,
+               int taps,
+               int dst_width,
+               int shift,
+               uint8_t* dst) {
+  const uint32_t round = 1u << (shift - 1);
+  const int n = kTaps > 0 ? kTaps : taps;
+  for (int i = 0; i < dst_width; i++) {
+    const uint16_t* w = weights + (size_t)i * n;
+    const uint16_t* p = row + start[i];
+    uint32_t sum = 0;
+    for (int k = 0; k < n; k++) {
+      sum += (uint32_t)w[k] * p[k];
+    }
+    dst[i] = (uint8_t)((sum + round) >> shift);
+  }
+}
+
+}  // namespace
+
+void PlaneScaler::ScaleRow(const uint8_t* src,
+                           int src_stride,
+                           int y,
+                           uint8_t* dst_row) {
+  const int width = src_width_;
+
+  // 縦方向: 入力の行を重み付けして足し、小数部 8 bit の row_ にする
+  const int row_start = vertical_.start[y];
+  const int row_count = vertical_.count[y];
+  const uint16_t* vw = &vertical_.weights[(size_t)y * vertical_.max_taps];
+  if (row_count == 1) {
+    const uint8_t* s = src + (size_t)row_start * src_stride;
+    if (horizontal_.identity) {
+      memcpy(dst_row, s, width);
+      return;
+    }
+    uint16_t* r = row_.data();
+    for (int x = 0; x < width; x++) {
+      r[x] = (uint16_t)(s[x] << 8);
+    }
+  } else {
+    uint32_t* acc = row_acc_.data();
+    const uint8_t* s = src + (size_t)row_start * src_stride;
+    const uint32_t w0 = vw[0];
+    for (int x = 0; x < width; x++) {
+      acc[x] = w0 * s[x];
+    }
+    for (int k = 1; k < row_count; k++) {
+      s = src + (size_t)(row_start + k) * src_stride;
+      const uint32_t w = vw[k];
+      for (int x = 0; x < width; x++) {
+        acc[x] += w * s[x];
+      }
+    }
+    uint16_t* r = row_.data();
+    const int shift = kWeightBits - 8;
+    const uint32_t round = 1 << (shift - 1);
+    if (horizontal_.identity) {
+      const uint32_t round8 = 1 << (kWeightBits - 1);
+      for (int x = 0; x < width; x++) {
+        dst_row[x] = (uint8_t)((acc[x] + round8) >> kWeightBits);
+      }
+      return;
+    }
+    for (int x = 0; x < width; x++) {
+      r[x] = (uint16_t)((acc[x] + round) >> shift);
+    }
+  }
+
+  // 横方向: 縦に補間した行を重み付けして足す。
+  // 8 bit * 2^8 * 2^kWeightBits は 32 bit に収まる
+  const uint16_t* r = row_.data();
+  const int* start = horizontal_.start.data();
+  const uint16_t* hw = horizontal_.weights.data();
+  const int taps = horizontal_.max_taps;
+  const int shift = kWeightBits + 8;
+  switch (taps) {
+    case 1:
+      ScaleCols<1>(r, start, hw, taps, dst_width_, shift, dst_row);
+      break;
+    case 2:
+      ScaleCols<2>(r, start, hw, taps, dst_width_, shift, dst_row);
+      break;
+    case 3:
+      ScaleCols<3>(r, start, hw, taps, dst_width_, shift, dst_row);
+      break;
+    case 4:
+      ScaleCols<4>(r, start, hw, taps, dst_width_, shift, dst_row);
+      break;
+    default:
+      ScaleCols<0>(r, start, hw, taps, dst_width_, shift, dst_row);
+      break;
+  }
+}
+
+void PlaneScaler::Scale(const uint8_t* src,
+                        int src_stride,
+                        uint8_t* dst,
+                        int dst_stride) {
+  for (int y = 0; y < dst_height_; y++) {
+    ScaleRow(src, src_stride, y, dst + (size_t)y * dst_stride);
+  }
+}
+
+}  // namespace sora
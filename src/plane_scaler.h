@@ -0,0 +1,64 @@
+#ifndef SORA_PLANE_SCALER_H_INCLUDED
+#define SORA_PLANE_SCALER_H_INCLUDED
+
+#include <stdint.h>
+#include <vector>
+
+namespace sora {
+
+// 8 bit のプレーン（Y, U, V の 1 枚）を 1 行ずつスケーリングする。
+//
+// 縮小は box フィルタ（出力の 1 ピクセルが覆う範囲の面積平均）で、
+// 大きく縮小しても折り返しが出にくい。拡大はバイリニアで補間する。
+// 縦横それぞれの係数は Configure でサイズが変わった時にだけ作り直し、
+// 作業用の行バッファも持ち続けるので、ScaleRow でメモリ確保は発生しない。
+//
+// 出力の行を 1 行ずつ作れるので、中間フレームを確保せずに
+// スケーリングした行をそのまま色変換に渡せる。
+class PlaneScaler {
+ public:
+  void Configure(int src_width, int src_height, int dst_width, int dst_height);
+
+  // 出力の y 行目を dst_row に dst_width バイト書き込む
+  void ScaleRow(const uint8_t* src, int src_stride, int y, uint8_t* dst_row);
+  // プレーン全体をスケーリングする
+  void Scale(const uint8_t* src,
+             int src_stride,
+             uint8_t* dst,
+             int dst_stride);
+
+  int src_width() const { return src_width_; }
+  int src_height() const { return src_height_; }
+  int dst_width() const { return dst_width_; }
+  int dst_height() const { return dst_height_; }
+
+  // 係数の小数部のビット数。1 つの出力に掛かる係数の和は 1 << kWeightBits になる
+  static const int kWeightBits = 14;
+
+ private:
+  // 1 軸分のフィルタ。
+  // 出力 i は入力 start[i] から count[i] 個を weights[i * max_taps + k] で重み付けして足す
+  struct Filter {
+    std::vector<int> start;
+    std::vector<int> count;
+    std::vector<uint16_t> weights;
+    int max_taps = 0;
+    // 拡大縮小せずにそのまま使える
+    bool identity = false;
+  };
+  static void BuildFilter(int src_size, int dst_size, Filter* filter);
+
+  int src_width_ = 0;
+  int src_height_ = 0;
+  int dst_width_ = 0;
+  int dst_height_ = 0;
+  Filter horizontal_;
+  Filter vertical_;
+  std::vector<uint32_t> row_acc_;
+  // 縦方向に補間した行。小数部を 8 bit 持つ
+  std::vector<uint16_t> row_;
+};
+
+}  // namespace sora
+
+#endif  // SORA_PLANE_SCALER_H_INCLUDED
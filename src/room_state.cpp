@@ -0,0 +1,43 @@
+#include "room_state.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace sora {
+
+void RoomState::Update(std::vector<std::string> streams, Diff* diff) {
+  std::sort(streams.begin(), streams.end());
+  streams.erase(std::unique(streams.begin(), streams.end()), streams.end());
+
+  diff->added.clear();
+  diff->removed.clear();
+  std::set_difference(streams.begin(), streams.end(), members_.begin(),
+                      members_.end(), std::back_inserter(diff->added));
+  std::set_difference(members_.begin(), members_.end(), streams.begin(),
+                      streams.end(), std::back_inserter(diff->removed));
+  members_ = std::move(streams);
+}
+
+bool RoomState::Add(const std::string& stream_id) {
+  auto it = std::lower_bound(members_.begin(), members_.end(), stream_id);
+  if (it != members_.end() && *it == stream_id) {
+    return false;
+  }
+  members_.insert(it, stream_id);
+  return true;
+}
+
+bool RoomState::Remove(const std::string& stream_id) {
+  auto it = std::lower_bound(members_.begin(), members_.end(), stream_id);
+  if (it == members_.end() || *it != stream_id) {
+    return false;
+  }
+  members_.erase(it);
+  return true;
+}
+
+bool RoomState::Contains(const std::string& stream_id) const {
+  return std::binary_search(members_.begin(), members_.end(), stream_id);
+}
+
+}  // namespace sora
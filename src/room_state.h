@@ -0,0 +1,39 @@
+#ifndef SORA_ROOM_STATE_H_INCLUDED
+#define SORA_ROOM_STATE_H_INCLUDED
+
+#include <string>
+#include <vector>
+
+namespace sora {
+
+// 部屋の参加者（再生しているストリーム）の一覧
+//
+// roomInformation 等で受け取った一覧を丸ごと作り直すのではなく、
+// ソート済みの一覧との差分（追加・削除）だけを求めて返す。
+// シグナリングのスレッドからのみ触ること。
+class RoomState {
+ public:
+  struct Diff {
+    std::vector<std::string> added;
+    std::vector<std::string> removed;
+    bool empty() const { return added.empty() && removed.empty(); }
+  };
+
+  // 一覧を streams に置き換えて、前回からの差分を diff に入れる
+  void Update(std::vector<std::string> streams, Diff* diff);
+  // 1 つのストリームを追加・削除する。変化があった場合は true を返す
+  bool Add(const std::string& stream_id);
+  bool Remove(const std::string& stream_id);
+  bool Contains(const std::string& stream_id) const;
+  void Clear() { members_.clear(); }
+
+  const std::vector<std::string>& Members() const { return members_; }
+
+ private:
+  // ソート済みで重複は無い
+  std::vector<std::string> members_;
+};
+
+}  // namespace sora
+
+#endif  // SORA_ROOM_STATE_H_INCLUDED
@@ -0,0 +1,15 @@
+#ifndef SORA_AUDIO_TRACK_RECEIVER_H_
+#define SORA_AUDIO_TRACK_RECEIVER_H_
+
+#include <string>
+
+#include "api/media_stream_interface.h"
+
+class AudioTrackReceiver {
+ public:
+  virtual void AddTrack(const std::string& stream_id,
+                        webrtc::AudioTrackInterface* track) = 0;
+  virtual void RemoveTrack(webrtc::AudioTrackInterface* track) = 0;
+};
+
+#endif  // SORA_AUDIO_TRACK_RECEIVER_H_
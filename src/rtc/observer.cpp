@@ -2,16 +2,23 @@
 #include "rtc_base/logging.h"
 
 #include "observer.h"
-#include <nlohmann/json.hpp>
-using json = nlohmann::json;
 namespace sora {
     
 void PeerConnectionObserver::OnTrack(
     rtc::scoped_refptr<webrtc::RtpTransceiverInterface> transceiver) {
+  auto track = transceiver->receiver()->track();
+  if (track->kind() == webrtc::MediaStreamTrackInterface::kAudioKind) {
+    if (audio_receiver_ == nullptr) {
+      return;
+    }
+    auto audio_track = static_cast<webrtc::AudioTrackInterface*>(track.get());
+    audio_receiver_->AddTrack(streamId, audio_track);
+    audio_tracks_.push_back(audio_track);
+    return;
+  }
   if (receiver_ == nullptr) {
     return;
   }
-  auto track = transceiver->receiver()->track();
   if (track->kind() != webrtc::MediaStreamTrackInterface::kVideoKind) {
     return;
   }
@@ -22,10 +29,22 @@ void PeerConnectionObserver::OnTrack(
 
 void PeerConnectionObserver::OnRemoveTrack(
     rtc::scoped_refptr<webrtc::RtpReceiverInterface> receiver) {
+  auto track = receiver->track();
+  if (track->kind() == webrtc::MediaStreamTrackInterface::kAudioKind) {
+    if (audio_receiver_ == nullptr) {
+      return;
+    }
+    webrtc::AudioTrackInterface* audio_track =
+        static_cast<webrtc::AudioTrackInterface*>(track.get());
+    audio_tracks_.erase(
+        std::remove(audio_tracks_.begin(), audio_tracks_.end(), audio_track),
+        audio_tracks_.end());
+    audio_receiver_->RemoveTrack(audio_track);
+    return;
+  }
   if (receiver_ == nullptr) {
     return;
   }
-  auto track = receiver->track();
   if (track->kind() == webrtc::MediaStreamTrackInterface::kVideoKind) {
     webrtc::VideoTrackInterface* video_track =
         static_cast<webrtc::VideoTrackInterface*>(track.get());
@@ -44,11 +63,32 @@ void PeerConnectionObserver::ClearAllRegisteredTracks() {
     receiver_->RemoveTrack(video_track);
   }
   video_tracks_.clear();
+  for (webrtc::AudioTrackInterface* audio_track : audio_tracks_) {
+    audio_receiver_->RemoveTrack(audio_track);
+  }
+  audio_tracks_.clear();
 }
 
 void PeerConnectionObserver::OnIceConnectionChange(
     webrtc::PeerConnectionInterface::IceConnectionState new_state) {
-  sender_->onIceConnectionStateChange(new_state);
+  sender_->onIceConnectionStateChange(streamId, new_state);
+}
+
+void PeerConnectionObserver::OnIceGatheringChange(
+    webrtc::PeerConnectionInterface::IceGatheringState new_state) {
+  if (new_state != webrtc::PeerConnectionInterface::kIceGatheringComplete ||
+      sender_ == nullptr || connection_ == nullptr) {
+    return;
+  }
+  // シグナリングスレッド上なので、ローカルの SDP をそのまま読める
+  std::string sdp;
+  const webrtc::SessionDescriptionInterface* desc =
+      connection_->local_description();
+  if (desc == nullptr || !desc->ToString(&sdp)) {
+    RTC_LOG(LS_ERROR) << "Failed to serialize local description";
+    sdp.clear();
+  }
+  sender_->onIceGatheringComplete(streamId, sdp);
 }
 
 void PeerConnectionObserver::OnIceCandidate(
@@ -56,16 +96,8 @@ void PeerConnectionObserver::OnIceCandidate(
   std::string sdp;
   if (candidate->ToString(&sdp)) {
     if (sender_ != nullptr) {
-      sender_->onIceCandidate(candidate->sdp_mid(),
+      sender_->onIceCandidate(streamId, candidate->sdp_mid(),
                               candidate->sdp_mline_index(), sdp);
-      json json_message = {
-      {"command", "takeCandidate"},
-      {"streamId",
-       streamId},
-      {"label", candidate->sdp_mline_index()},
-      {"id", candidate->sdp_mid()},
-      {"candidate",sdp}}; 
-  sender_->sendText(json_message.dump());
     }
   } else {
     RTC_LOG(LS_ERROR) << "Failed to serialize candidate";
@@ -77,16 +109,12 @@ void CreateSessionDescriptionObserver::OnSuccess(
   std::string sdp;
   desc->ToString(&sdp);
   RTC_LOG(LS_INFO) << "Created session description : " << sdp;
+  // desc は SetLocalDescription に渡した後は触らない
+  webrtc::SdpType type = desc->GetType();
   _connection->SetLocalDescription(
-      SetSessionDescriptionObserver::Create(desc->GetType(), sender_), desc);
+      SetSessionDescriptionObserver::Create(type, sender_), desc);
   if (sender_ != nullptr) {
-    sender_->onCreateDescription(desc->GetType(), sdp);
-    json json_message = {{"command", "takeConfiguration"},
-                         {"streamId", streamId},
-                         {"type", desc->GetType() == webrtc::SdpType::kAnswer?"answer":"offer"},
-                         {"sdp", sdp}};
-   
-    sender_->sendText(json_message.dump());
+    sender_->onCreateDescription(streamId, type, sdp);
   }
 }
 
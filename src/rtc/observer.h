@@ -6,6 +6,7 @@
 #include "api/video/video_frame.h"
 #include "api/video/video_sink_interface.h"
 
+#include "audio_track_receiver.h"
 #include "rtc_message_sender.h"
 #include "video_track_receiver.h"
 
@@ -13,9 +14,19 @@ namespace sora {
 
 class PeerConnectionObserver : public webrtc::PeerConnectionObserver {
  public:
-  PeerConnectionObserver(RTCMessageSender* sender, VideoTrackReceiver* receiver,std::string streamName)
-      : sender_(sender), receiver_(receiver), streamId(streamName) {}
+  PeerConnectionObserver(RTCMessageSender* sender,
+                         VideoTrackReceiver* receiver,
+                         AudioTrackReceiver* audio_receiver,
+                         std::string streamName)
+      : sender_(sender),
+        receiver_(receiver),
+        audio_receiver_(audio_receiver),
+        streamId(streamName) {}
   ~PeerConnectionObserver() { ClearAllRegisteredTracks(); }
+  // 候補の収集が終わった時にローカルの SDP を読むため、作った PeerConnection を渡す
+  void SetConnection(webrtc::PeerConnectionInterface* connection) {
+    connection_ = connection;
+  }
 
  protected:
   void OnSignalingChange(
@@ -30,7 +41,7 @@ class PeerConnectionObserver : public webrtc::PeerConnectionObserver {
   void OnIceConnectionChange(
       webrtc::PeerConnectionInterface::IceConnectionState new_state) override;
   void OnIceGatheringChange(
-      webrtc::PeerConnectionInterface::IceGatheringState new_state) override{};
+      webrtc::PeerConnectionInterface::IceGatheringState new_state) override;
   void OnIceCandidate(const webrtc::IceCandidateInterface* candidate) override;
   void OnIceConnectionReceivingChange(bool receiving) override {}
   void OnTrack(
@@ -43,8 +54,11 @@ class PeerConnectionObserver : public webrtc::PeerConnectionObserver {
 
   RTCMessageSender* sender_;
   VideoTrackReceiver* receiver_;
+  AudioTrackReceiver* audio_receiver_;
   std::vector<webrtc::VideoTrackInterface*> video_tracks_;
+  std::vector<webrtc::AudioTrackInterface*> audio_tracks_;
   std::string streamId;
+  webrtc::PeerConnectionInterface* connection_ = nullptr;
 };
 
 class CreateSessionDescriptionObserver
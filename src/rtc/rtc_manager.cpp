@@ -51,12 +51,13 @@ std::unique_ptr<RTCManager> RTCManager::Create(
     RTCManagerConfig config,
     rtc::scoped_refptr<rtc::AdaptedVideoTrackSource> video_track_source,
     VideoTrackReceiver* receiver,
+    AudioTrackReceiver* audio_receiver,
     rtc::scoped_refptr<webrtc::AudioDeviceModule> adm,
     std::unique_ptr<webrtc::TaskQueueFactory> task_queue_factory,
     std::unique_ptr<rtc::Thread> signaling_thread,
     std::unique_ptr<rtc::Thread> worker_thread) {
   std::unique_ptr<RTCManager> p(new RTCManager());
-  if (!p->Init(config, video_track_source, receiver, adm,
+  if (!p->Init(config, video_track_source, receiver, audio_receiver, adm,
                std::move(task_queue_factory), std::move(signaling_thread),
                std::move(worker_thread))) {
     return nullptr;
@@ -70,12 +71,14 @@ bool RTCManager::Init(
     RTCManagerConfig config,
     rtc::scoped_refptr<rtc::AdaptedVideoTrackSource> video_track_source,
     VideoTrackReceiver* receiver,
+    AudioTrackReceiver* audio_receiver,
     rtc::scoped_refptr<webrtc::AudioDeviceModule> adm,
     std::unique_ptr<webrtc::TaskQueueFactory> task_queue_factory,
     std::unique_ptr<rtc::Thread> signaling_thread,
     std::unique_ptr<rtc::Thread> worker_thread) {
   config_ = config;
   receiver_ = receiver;
+  audio_receiver_ = audio_receiver;
 
   rtc::InitializeSSL();
 
@@ -288,7 +291,8 @@ std::shared_ptr<RTCConnection> RTCManager::createConnection(
   rtc_config.enable_dtls_srtp = true;
   rtc_config.sdp_semantics = webrtc::SdpSemantics::kUnifiedPlan;
   std::unique_ptr<PeerConnectionObserver> observer(
-      new PeerConnectionObserver(sender, receiver_,streamName));
+      new PeerConnectionObserver(sender, receiver_, audio_receiver_,
+                                 streamName));
   rtc::scoped_refptr<webrtc::PeerConnectionInterface> connection =
       factory_->CreatePeerConnection(rtc_config, nullptr, nullptr,
                                      observer.get());
@@ -296,6 +300,7 @@ std::shared_ptr<RTCConnection> RTCManager::createConnection(
     RTC_LOG(LS_ERROR) << __FUNCTION__ << ": CreatePeerConnection failed";
     return nullptr;
   }
+  observer->SetConnection(connection.get());
 
   std::string stream_id = generateRandomChars();
 
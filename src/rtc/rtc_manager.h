@@ -5,6 +5,7 @@
 #include "api/video/video_frame.h"
 #include "pc/video_track_source.h"
 
+#include "audio_track_receiver.h"
 #include "rtc_connection.h"
 #include "scalable_track_source.h"
 #include "video_track_receiver.h"
@@ -38,6 +39,7 @@ class RTCManager {
       RTCManagerConfig config,
       rtc::scoped_refptr<rtc::AdaptedVideoTrackSource> video_track_source,
       VideoTrackReceiver* receiver,
+      AudioTrackReceiver* audio_receiver,
       rtc::scoped_refptr<webrtc::AudioDeviceModule> adm,
       std::unique_ptr<webrtc::TaskQueueFactory> task_queue_factory,
       std::unique_ptr<rtc::Thread> signaling_thread,
@@ -48,6 +50,7 @@ class RTCManager {
   bool Init(RTCManagerConfig config,
             rtc::scoped_refptr<rtc::AdaptedVideoTrackSource> video_track_source,
             VideoTrackReceiver* receiver,
+            AudioTrackReceiver* audio_receiver,
             rtc::scoped_refptr<webrtc::AudioDeviceModule> adm,
             std::unique_ptr<webrtc::TaskQueueFactory> task_queue_factory,
             std::unique_ptr<rtc::Thread> signaling_thread,
@@ -55,6 +58,7 @@ class RTCManager {
 
  public:
   ~RTCManager();
+  rtc::Thread* signalingThread() const { return signaling_thread_.get(); }
   std::shared_ptr<RTCConnection> createConnection(
       webrtc::PeerConnectionInterface::RTCConfiguration rtc_config,
       RTCMessageSender* sender,
@@ -72,6 +76,7 @@ class RTCManager {
   rtc::scoped_refptr<webrtc::AudioTrackInterface> audio_track_;
   rtc::scoped_refptr<webrtc::VideoTrackInterface> video_track_;
   VideoTrackReceiver* receiver_;
+  AudioTrackReceiver* audio_receiver_;
   std::unique_ptr<rtc::Thread> network_thread_;
   std::unique_ptr<rtc::Thread> worker_thread_;
   std::unique_ptr<rtc::Thread> signaling_thread_;
@@ -9,12 +9,20 @@ namespace sora {
 class RTCMessageSender {
  public:
   virtual void onIceConnectionStateChange(
+      const std::string streamId,
       webrtc::PeerConnectionInterface::IceConnectionState new_state) = 0;
-  virtual void onIceCandidate(const std::string sdp_mid,
+  // takeCandidate の送信は sender に任せる
+  virtual void onIceCandidate(const std::string streamId,
+                              const std::string sdp_mid,
                               const int sdp_mlineindex,
                               const std::string sdp) = 0;
-  virtual void onCreateDescription(webrtc::SdpType type,
+  // takeConfiguration の送信も sender に任せる
+  virtual void onCreateDescription(const std::string streamId,
+                                   webrtc::SdpType type,
                                    const std::string sdp) = 0;
+  // ICE 候補の収集が終わった。sdp は集まった全ての候補を含むローカルの SDP
+  virtual void onIceGatheringComplete(const std::string streamId,
+                                      const std::string sdp) = 0;
   virtual void onSetDescription(webrtc::SdpType type) = 0;
   virtual void sendText(std::string text) = 0;
   virtual void onDataChannel(
@@ -0,0 +1,226 @@
+#include "stats_collector.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "api/stats/rtcstats_objects.h"
+
+namespace sora {
+
+template <class T>
+static T ValueOr(const webrtc::RTCStatsMember<T>& member, T value) {
+  return member.is_defined() ? *member : value;
+}
+
+static void CopyString(char* dst, size_t size, const std::string& src) {
+  size_t n = std::min(src.size(), size - 1);
+  memcpy(dst, src.data(), n);
+  dst[n] = '\0';
+}
+
+StatsCollector::Entry& StatsCollector::GetEntry(const std::string& stream_id,
+                                                const std::string& rtp_id) {
+  for (auto& entry : entries_) {
+    if (entry.stream_id == stream_id && entry.rtp_id == rtp_id) {
+      return entry;
+    }
+  }
+  entries_.push_back(Entry());
+  Entry& entry = entries_.back();
+  entry.stream_id = stream_id;
+  entry.rtp_id = rtp_id;
+  memset(&entry.stats, 0, sizeof(entry.stats));
+  CopyString(entry.stats.stream_id, sizeof(entry.stats.stream_id), stream_id);
+  entry.timestamp_us = 0;
+  entry.bytes = 0;
+  entry.frames = 0;
+  entry.total_frame_time = 0;
+  entry.packets_lost = 0;
+  entry.frames_dropped = 0;
+  entry.history.resize(history_size_);
+  entry.history_head = 0;
+  entry.history_count = 0;
+  return entry;
+}
+
+void StatsCollector::PushHistory(Entry& entry) {
+  size_t capacity = entry.history.size();
+  if (capacity == 0) {
+    return;
+  }
+  entry.history[(entry.history_head + entry.history_count) % capacity] =
+      entry.stats;
+  if (entry.history_count < capacity) {
+    entry.history_count++;
+  } else {
+    entry.history_head = (entry.history_head + 1) % capacity;
+  }
+}
+
+void StatsCollector::OnReport(
+    const std::string& stream_id,
+    const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report) {
+  int64_t timestamp_us = report->timestamp_us();
+
+  // 選択されている候補ペアの RTT をコネクション全体の RTT とする
+  double rtt_ms = 0;
+  for (auto pair : report->GetStatsOfType<webrtc::RTCIceCandidatePairStats>()) {
+    if (ValueOr(pair->nominated, false) &&
+        ValueOr(pair->state, std::string()) == "succeeded" &&
+        pair->current_round_trip_time.is_defined()) {
+      rtt_ms = *pair->current_round_trip_time * 1000;
+    }
+  }
+
+  // 前回のレポートとの差分からビットレート等を計算する
+  auto update = [timestamp_us, rtt_ms](Entry& entry, const std::string& kind,
+                                       bool inbound, uint64_t bytes,
+                                       uint64_t frames,
+                                       double total_frame_time) {
+    sora_stream_stats_t& stats = entry.stats;
+    CopyString(stats.kind, sizeof(stats.kind), kind);
+    stats.inbound = inbound;
+    stats.rtt_ms = rtt_ms;
+    stats.frames = (int64_t)frames;
+    int64_t elapsed_us = timestamp_us - entry.timestamp_us;
+    if (entry.timestamp_us != 0 && elapsed_us > 0 && bytes >= entry.bytes &&
+        frames >= entry.frames) {
+      stats.bitrate_bps = (bytes - entry.bytes) * 8 * 1e6 / elapsed_us;
+      uint64_t delta_frames = frames - entry.frames;
+      if (delta_frames > 0) {
+        stats.frame_time_ms =
+            (total_frame_time - entry.total_frame_time) * 1000 / delta_frames;
+      }
+    }
+    stats.timestamp_us = timestamp_us;
+    entry.timestamp_us = timestamp_us;
+    entry.bytes = bytes;
+    entry.frames = frames;
+    entry.total_frame_time = total_frame_time;
+  };
+
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (pending_reports_ > 0 && --pending_reports_ == 0) {
+    requesting_ = false;
+  }
+
+  for (auto s : report->GetStatsOfType<webrtc::RTCInboundRTPStreamStats>()) {
+    Entry& entry = GetEntry(stream_id, s->id());
+    std::string kind = ValueOr(s->kind, std::string());
+    update(entry, kind, true, ValueOr(s->bytes_received, (uint64_t)0),
+           ValueOr(s->frames_decoded, (uint32_t)0),
+           ValueOr(s->total_decode_time, 0.0));
+    sora_stream_stats_t& stats = entry.stats;
+    stats.frames_per_second = ValueOr(s->frames_per_second, 0.0);
+    stats.jitter_ms = ValueOr(s->jitter, 0.0) * 1000;
+    stats.packets_lost = ValueOr(s->packets_lost, 0);
+    stats.packets_lost_delta = stats.packets_lost - entry.packets_lost;
+    entry.packets_lost = stats.packets_lost;
+    // 破棄されたフレーム数はトラックの統計情報にしか無い
+    stats.frames_dropped = 0;
+    if (s->track_id.is_defined()) {
+      auto track = report->Get(*s->track_id);
+      if (track != nullptr &&
+          track->type() == webrtc::RTCMediaStreamTrackStats::kType) {
+        stats.frames_dropped = ValueOr(
+            track->cast_to<webrtc::RTCMediaStreamTrackStats>().frames_dropped,
+            (uint32_t)0);
+      }
+    }
+    stats.frames_dropped_delta = stats.frames_dropped - entry.frames_dropped;
+    entry.frames_dropped = stats.frames_dropped;
+    PushHistory(entry);
+  }
+  for (auto s : report->GetStatsOfType<webrtc::RTCOutboundRTPStreamStats>()) {
+    Entry& entry = GetEntry(stream_id, s->id());
+    std::string kind = ValueOr(s->kind, std::string());
+    update(entry, kind, false, ValueOr(s->bytes_sent, (uint64_t)0),
+           ValueOr(s->frames_encoded, (uint32_t)0),
+           ValueOr(s->total_encode_time, 0.0));
+    sora_stream_stats_t& stats = entry.stats;
+    stats.frames_per_second = ValueOr(s->frames_per_second, 0.0);
+    PushHistory(entry);
+  }
+}
+
+void StatsCollector::Retain(const std::vector<std::string>& stream_ids) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                [&stream_ids](const Entry& entry) {
+                                  return std::find(stream_ids.begin(),
+                                                   stream_ids.end(),
+                                                   entry.stream_id) ==
+                                         stream_ids.end();
+                                }),
+                 entries_.end());
+}
+
+bool StatsCollector::TryBeginRequest(int64_t now_ms,
+                                     int min_interval_ms,
+                                     int timeout_ms) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  int64_t elapsed_ms = now_ms - requested_at_ms_;
+  if (elapsed_ms < min_interval_ms || (requesting_ && elapsed_ms < timeout_ms)) {
+    return false;
+  }
+  requesting_ = true;
+  requested_at_ms_ = now_ms;
+  return true;
+}
+
+void StatsCollector::ExpectReports(int reports) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  pending_reports_ = reports;
+  if (reports == 0) {
+    requesting_ = false;
+  }
+}
+
+void StatsCollector::SetHistorySize(int history_size) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  history_size = std::max(history_size, 0);
+  if (history_size == history_size_) {
+    return;
+  }
+  history_size_ = history_size;
+  // サイズが変わった場合は履歴を捨てる
+  for (auto& entry : entries_) {
+    entry.history.assign(history_size, sora_stream_stats_t());
+    entry.history_head = 0;
+    entry.history_count = 0;
+  }
+}
+
+int StatsCollector::GetHistory(const std::string& stream_id,
+                               const std::string& kind,
+                               bool inbound,
+                               sora_stream_stats_t* stats,
+                               int max_stats) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (const auto& entry : entries_) {
+    if (entry.stream_id != stream_id || kind != entry.stats.kind ||
+        (entry.stats.inbound != 0) != inbound) {
+      continue;
+    }
+    size_t capacity = entry.history.size();
+    size_t count =
+        std::min(entry.history_count, (size_t)std::max(max_stats, 0));
+    size_t skip = entry.history_count - count;
+    for (size_t i = 0; i < count; i++) {
+      stats[i] = entry.history[(entry.history_head + skip + i) % capacity];
+    }
+    return (int)count;
+  }
+  return 0;
+}
+
+int StatsCollector::GetStats(sora_stream_stats_t* stats, int max_stats) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  int count = std::min((int)entries_.size(), max_stats);
+  for (int i = 0; i < count; i++) {
+    stats[i] = entries_[i].stats;
+  }
+  return count;
+}
+
+}  // namespace sora
@@ -0,0 +1,78 @@
+#ifndef SORA_STATS_COLLECTOR_H_
+#define SORA_STATS_COLLECTOR_H_
+
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "api/stats/rtc_stats_report.h"
+
+#include "unity.h"
+
+namespace sora {
+
+// RTCStatsReport から必要な値だけを取り出して、ストリーム毎の固定長の構造体にまとめる。
+//
+// JSON を経由せずに RTCStats の型付きのメンバを直接読み、
+// ビットレートやフレームあたりのデコード時間は前回のレポートとの差分から計算する。
+// SetHistorySize を設定すると、ストリーム毎に直近の統計情報をリングバッファに残す。
+// リングバッファはストリームが現れた時に確保するので、レポート毎のメモリ確保は無い。
+class StatsCollector {
+ public:
+  // stream_id のコネクションの report を取り込む。任意のスレッドから呼んで良い
+  void OnReport(const std::string& stream_id,
+                const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report);
+  // stream_ids に含まれないストリームの統計情報を捨てる
+  void Retain(const std::vector<std::string>& stream_ids);
+
+  // 必要な時だけ取得する場合に、取得を始めて良ければ true を返して取得中にする。
+  // 前回の取得を始めてから min_interval_ms 経っていないか、前回のレポートが
+  // 揃っていなければ false を返す。レポートが返ってこない場合に備えて、
+  // timeout_ms 経ったら揃っていなくても始める。
+  bool TryBeginRequest(int64_t now_ms, int min_interval_ms, int timeout_ms);
+  // 取得を始めたコネクションの数を設定する。その数の OnReport が揃ったら取得中でなくなる
+  void ExpectReports(int reports);
+  // 最新の統計情報を stats に書き込んで、書き込んだ数を返す
+  int GetStats(sora_stream_stats_t* stats, int max_stats);
+  // ストリーム毎に残す統計情報の数。0 なら残さない
+  void SetHistorySize(int history_size);
+  // 残している統計情報を古い順に最大 max_stats 個（新しい方から）書き込んで、書き込んだ数を返す
+  int GetHistory(const std::string& stream_id,
+                 const std::string& kind,
+                 bool inbound,
+                 sora_stream_stats_t* stats,
+                 int max_stats);
+
+ private:
+  struct Entry {
+    std::string stream_id;
+    // RTP の統計情報の ID
+    std::string rtp_id;
+    sora_stream_stats_t stats;
+    // 前回のレポートの値
+    int64_t timestamp_us;
+    uint64_t bytes;
+    uint64_t frames;
+    double total_frame_time;
+    int64_t packets_lost;
+    int64_t frames_dropped;
+    // 統計情報の履歴（リングバッファ）
+    std::vector<sora_stream_stats_t> history;
+    size_t history_head;
+    size_t history_count;
+  };
+  void PushHistory(Entry& entry);
+  Entry& GetEntry(const std::string& stream_id, const std::string& rtp_id);
+
+  std::mutex mutex_;
+  std::vector<Entry> entries_;
+  int history_size_ = 0;
+  // TryBeginRequest で始めた取得の状態
+  bool requesting_ = false;
+  int64_t requested_at_ms_ = 0;
+  int pending_reports_ = 0;
+};
+
+}  // namespace sora
+
+#endif  // SORA_STATS_COLLECTOR_H_
@@ -0,0 +1,201 @@
+#include "signaling_message.h"
+
+#include <string.h>
+
+#include <nlohmann/json.hpp>
+
+namespace sora {
+
+namespace {
+
+struct CommandName {
+  const char* name;
+  SignalingMessage::Command command;
+};
+const CommandName kCommands[] = {
+    {"start", SignalingMessage::Command::Start},
+    {"takeConfiguration", SignalingMessage::Command::TakeConfiguration},
+    {"takeCandidate", SignalingMessage::Command::TakeCandidate},
+    {"pong", SignalingMessage::Command::Pong},
+    {"notification", SignalingMessage::Command::Notification},
+    {"roomInformation", SignalingMessage::Command::RoomInformation},
+    {"error", SignalingMessage::Command::Error},
+};
+
+struct DefinitionName {
+  const char* name;
+  SignalingMessage::Definition definition;
+};
+const DefinitionName kDefinitions[] = {
+    {"joinedTheRoom", SignalingMessage::Definition::JoinedTheRoom},
+    {"play_finished", SignalingMessage::Definition::PlayFinished},
+    {"bitrateMeasurement", SignalingMessage::Definition::BitrateMeasurement},
+    {"publishTimeoutError", SignalingMessage::Definition::PublishTimeoutError},
+    {"no_stream_exist", SignalingMessage::Definition::NoStreamExist},
+};
+
+// トップレベルのオブジェクトのフィールドだけを見る SAX ハンドラ
+class SaxHandler : public nlohmann::json_sax<nlohmann::json> {
+ public:
+  explicit SaxHandler(SignalingMessage* message) : message_(message) {}
+
+  bool null() override { return true; }
+  bool boolean(bool) override { return true; }
+  bool number_integer(number_integer_t val) override {
+    return SetNumber((int64_t)val);
+  }
+  bool number_unsigned(number_unsigned_t val) override {
+    return SetNumber((int64_t)val);
+  }
+  bool number_float(number_float_t val, const string_t&) override {
+    return SetNumber((int64_t)val);
+  }
+  bool binary(binary_t&) override { return true; }
+
+  bool string(string_t& val) override {
+    if (depth_ == 2 && field_ == Field::Streams) {
+      message_->streams.push_back(val);
+      return true;
+    }
+    if (depth_ != 1) {
+      return true;
+    }
+    switch (field_) {
+      case Field::Command:
+        for (const auto& c : kCommands) {
+          if (val == c.name) {
+            message_->command = c.command;
+            break;
+          }
+        }
+        break;
+      case Field::Definition:
+        for (const auto& d : kDefinitions) {
+          if (val == d.name) {
+            message_->definition = d.definition;
+            break;
+          }
+        }
+        break;
+      // 大きくなり得る文字列はバッファを交換してコピーを避ける
+      case Field::StreamId:
+        message_->stream_id.swap(val);
+        break;
+      case Field::Type:
+        message_->type.swap(val);
+        break;
+      case Field::Sdp:
+        message_->sdp.swap(val);
+        break;
+      case Field::Id:
+        message_->id.swap(val);
+        break;
+      case Field::Candidate:
+        message_->candidate.swap(val);
+        break;
+      default:
+        break;
+    }
+    return true;
+  }
+
+  bool start_object(std::size_t) override {
+    depth_++;
+    return true;
+  }
+  bool end_object() override {
+    depth_--;
+    return true;
+  }
+  bool start_array(std::size_t) override {
+    depth_++;
+    return true;
+  }
+  bool end_array() override {
+    depth_--;
+    return true;
+  }
+
+  bool key(string_t& val) override {
+    if (depth_ != 1) {
+      return true;
+    }
+    field_ = ToField(val);
+    return true;
+  }
+
+  bool parse_error(std::size_t,
+                   const std::string&,
+                   const nlohmann::detail::exception&) override {
+    return false;
+  }
+
+ private:
+  enum class Field {
+    Other,
+    Command,
+    Definition,
+    StreamId,
+    Type,
+    Sdp,
+    Id,
+    Label,
+    Candidate,
+    Streams,
+  };
+
+  static Field ToField(const string_t& key) {
+    struct FieldName {
+      const char* name;
+      Field field;
+    };
+    static const FieldName kFields[] = {
+        {"command", Field::Command}, {"definition", Field::Definition},
+        {"streamId", Field::StreamId}, {"type", Field::Type},
+        {"sdp", Field::Sdp},           {"id", Field::Id},
+        {"label", Field::Label},       {"candidate", Field::Candidate},
+        {"streams", Field::Streams},
+    };
+    for (const auto& f : kFields) {
+      if (key == f.name) {
+        return f.field;
+      }
+    }
+    return Field::Other;
+  }
+
+  bool SetNumber(int64_t val) {
+    if (depth_ == 1 && field_ == Field::Label) {
+      message_->label = (int)val;
+    }
+    return true;
+  }
+
+  SignalingMessage* message_;
+  int depth_ = 0;
+  Field field_ = Field::Other;
+};
+
+}  // namespace
+
+void SignalingMessage::Clear() {
+  command = Command::Unknown;
+  definition = Definition::Unknown;
+  stream_id.clear();
+  type.clear();
+  sdp.clear();
+  id.clear();
+  label = 0;
+  candidate.clear();
+  streams.clear();
+}
+
+bool ParseSignalingMessage(const char* data,
+                           size_t size,
+                           SignalingMessage* message) {
+  message->Clear();
+  SaxHandler handler(message);
+  return nlohmann::json::sax_parse(data, data + size, &handler);
+}
+
+}  // namespace sora
@@ -0,0 +1,62 @@
+#ifndef SORA_SIGNALING_MESSAGE_H_INCLUDED
+#define SORA_SIGNALING_MESSAGE_H_INCLUDED
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace sora {
+
+// シグナリングサーバから受信したメッセージ
+//
+// JSON の DOM は作らず、SAX でトップレベルの必要なフィールドだけを直接取り出す。
+// 同じオブジェクトを使い回せば、フィールドの文字列のバッファも使い回される。
+// nlohmann/json の字句解析器がパース毎に作業用のバッファを確保し直すので、
+// メモリ確保は無くならない（test/signaling_message_bench で DOM の 4 割程度）。
+struct SignalingMessage {
+  enum class Command {
+    Unknown,
+    Start,
+    TakeConfiguration,
+    TakeCandidate,
+    Pong,
+    Notification,
+    RoomInformation,
+    Error,
+  };
+  // notification と error の definition
+  enum class Definition {
+    Unknown,
+    JoinedTheRoom,
+    PlayFinished,
+    BitrateMeasurement,
+    PublishTimeoutError,
+    NoStreamExist,
+  };
+
+  Command command = Command::Unknown;
+  Definition definition = Definition::Unknown;
+  std::string stream_id;
+  // takeConfiguration
+  std::string type;
+  std::string sdp;
+  // takeCandidate
+  std::string id;
+  int label = 0;
+  std::string candidate;
+  // joinedTheRoom, roomInformation
+  std::vector<std::string> streams;
+
+  // 中身を空にする。確保済みのバッファは解放しない
+  void Clear();
+};
+
+// data から size バイトの JSON をパースして message に入れる。
+// JSON として不正な場合は false を返す。
+bool ParseSignalingMessage(const char* data,
+                           size_t size,
+                           SignalingMessage* message);
+
+}  // namespace sora
+
+#endif  // SORA_SIGNALING_MESSAGE_H_INCLUDED
@@ -0,0 +1,355 @@
+#include "signaling_transport.h"
+
+#include <algorithm>
+
+#include <boost/asio/connect.hpp>
+#include <boost/beast/core/bind_handler.hpp>
+
+#include "rtc_base/logging.h"
+
+namespace sora {
+
+std::shared_ptr<SignalingTransport> SignalingTransport::Create(
+    strand_t strand,
+    SignalingTransportConfig config,
+    Handler handler) {
+  auto p = std::shared_ptr<SignalingTransport>(
+      new SignalingTransport(strand, std::move(config), std::move(handler)));
+  if (!p->Init()) {
+    return nullptr;
+  }
+  return p;
+}
+
+SignalingTransport::SignalingTransport(strand_t strand,
+                                       SignalingTransportConfig config,
+                                       Handler handler)
+    : strand_(strand),
+      resolver_(strand_),
+      ssl_ctx_(boost::asio::ssl::context::tlsv12),
+      reconnect_timer_(strand_),
+      jitter_rng_(std::random_device()()),
+      config_(std::move(config)),
+      handler_(std::move(handler)) {}
+
+bool SignalingTransport::Init() {
+  ssl_ctx_.set_default_verify_paths();
+  ssl_ctx_.set_options(boost::asio::ssl::context::default_workarounds |
+                       boost::asio::ssl::context::no_sslv2 |
+                       boost::asio::ssl::context::no_sslv3 |
+                       boost::asio::ssl::context::single_dh_use);
+  return CreateWebsocket();
+}
+
+/*
+Creates a fresh websocket. Also used for every reconnect attempt, since a
+websocket stream cannot be reused once it failed.
+*/
+bool SignalingTransport::CreateWebsocket() {
+  generation_++;
+  wss_.reset(new ssl_websocket_t(strand_, ssl_ctx_));
+  wss_->write_buffer_bytes(8192);
+  // Unsent messages are dropped; the handler re-issues what is needed when
+  // it is connected again.
+  write_queue_.Clear();
+  writing_ = false;
+  read_buffer_.consume(read_buffer_.size());
+
+  // SNI
+  if (!SSL_set_tlsext_host_name(wss_->next_layer().native_handle(),
+                                config_.host.c_str())) {
+    boost::system::error_code ec{static_cast<int>(::ERR_get_error()),
+                                 boost::asio::error::get_ssl_category()};
+    RTC_LOG(LS_ERROR) << "Failed SSL_set_tlsext_host_name: ec=" << ec;
+    return false;
+  }
+  return true;
+}
+
+bool SignalingTransport::Connect() {
+  if (state_ != State::Idle) {
+    return false;
+  }
+  DoConnect();
+  return true;
+}
+
+void SignalingTransport::DoConnect() {
+  state_ = State::Connecting;
+
+  RTC_LOG(LS_INFO) << "Start to resolve DNS: host=" << config_.host
+                   << " port=" << config_.port;
+
+  resolver_.async_resolve(
+      config_.host, config_.port,
+      boost::beast::bind_front_handler(&SignalingTransport::OnResolve,
+                                       shared_from_this(), generation_));
+}
+
+void SignalingTransport::OnResolve(
+    uint64_t generation,
+    boost::system::error_code ec,
+    boost::asio::ip::tcp::resolver::results_type results) {
+  if (generation != generation_ || state_ != State::Connecting) {
+    return;
+  }
+  if (ec) {
+    Reconnect("Failed to resolve DNS", ec);
+    return;
+  }
+  boost::asio::async_connect(
+      wss_->next_layer().next_layer(), results.begin(), results.end(),
+      std::bind(&SignalingTransport::OnSSLConnect, shared_from_this(),
+                generation, std::placeholders::_1));
+}
+
+void SignalingTransport::OnSSLConnect(uint64_t generation,
+                                      boost::system::error_code ec) {
+  if (generation != generation_ || state_ != State::Connecting) {
+    return;
+  }
+  if (ec) {
+    Reconnect("Failed to connect", ec);
+    return;
+  }
+  wss_->next_layer().async_handshake(
+      boost::asio::ssl::stream_base::client,
+      boost::beast::bind_front_handler(&SignalingTransport::OnSSLHandshake,
+                                       shared_from_this(), generation));
+}
+
+void SignalingTransport::OnSSLHandshake(uint64_t generation,
+                                        boost::system::error_code ec) {
+  if (generation != generation_ || state_ != State::Connecting) {
+    return;
+  }
+  if (ec) {
+    Reconnect("Failed SSL handshake", ec);
+    return;
+  }
+  wss_->async_handshake(
+      config_.host, config_.path,
+      boost::beast::bind_front_handler(&SignalingTransport::OnHandshake,
+                                       shared_from_this(), generation));
+}
+
+void SignalingTransport::OnHandshake(uint64_t generation,
+                                     boost::system::error_code ec) {
+  if (generation != generation_ || state_ != State::Connecting) {
+    return;
+  }
+  if (ec) {
+    Reconnect("Failed Websocket handshake", ec);
+    return;
+  }
+
+  state_ = State::Connected;
+  bool resumed = resuming_;
+  int attempts = reconnect_attempts_;
+  resuming_ = true;
+  reconnect_attempts_ = 0;
+  RTC_LOG(LS_INFO) << "Signaling Websocket is connected: resumed=" << resumed
+                   << " attempts=" << attempts;
+
+  DoRead();
+  if (handler_.on_connected) {
+    handler_.on_connected(resumed, attempts);
+  }
+}
+
+/*
+Reconnect state machine. Called whenever connecting fails or the connection
+drops. Closes the socket, waits with exponential backoff and connects again
+with a fresh websocket.
+*/
+void SignalingTransport::Reconnect(const char* reason,
+                                   boost::system::error_code ec) {
+  RTC_LOG(LS_ERROR) << reason << ": ec=" << ec;
+
+  // Already waiting, or closed by the user.
+  if (state_ == State::Waiting || state_ == State::Closed ||
+      state_ == State::Idle) {
+    return;
+  }
+  // Pending operations of the old websocket complete with an error before
+  // the timer fires; the generation check drops them.
+  boost::system::error_code close_ec;
+  wss_->next_layer().next_layer().close(close_ec);
+
+  if (reconnect_attempts_ >= config_.reconnect_max_attempts) {
+    RTC_LOG(LS_ERROR) << "Give up reconnecting: attempts="
+                      << reconnect_attempts_;
+    state_ = State::Closed;
+    if (handler_.on_closed) {
+      handler_.on_closed(reconnect_attempts_);
+    }
+    return;
+  }
+
+  int delay_ms = config_.reconnect_base_delay_ms;
+  for (int i = 0;
+       i < reconnect_attempts_ && delay_ms < config_.reconnect_max_delay_ms;
+       i++) {
+    delay_ms *= 2;
+  }
+  delay_ms = std::min(delay_ms, config_.reconnect_max_delay_ms);
+  reconnect_attempts_++;
+  state_ = State::Waiting;
+
+  RTC_LOG(LS_INFO) << "Reconnect signaling: attempt=" << reconnect_attempts_
+                   << " delay_ms=" << delay_ms;
+  if (handler_.on_reconnecting) {
+    handler_.on_reconnecting(reconnect_attempts_, delay_ms);
+  }
+
+  reconnect_timer_.expires_after(WithJitter(delay_ms));
+  reconnect_timer_.async_wait(boost::beast::bind_front_handler(
+      &SignalingTransport::OnReconnectTimer, shared_from_this()));
+}
+
+void SignalingTransport::OnReconnectTimer(boost::system::error_code ec) {
+  if (ec == boost::asio::error::operation_aborted ||
+      state_ != State::Waiting) {
+    return;
+  }
+  if (!CreateWebsocket()) {
+    state_ = State::Connecting;
+    Reconnect("Failed to create websocket", ec);
+    return;
+  }
+  DoConnect();
+}
+
+void SignalingTransport::Close() {
+  State state = state_;
+  state_ = State::Closed;
+  reconnect_timer_.cancel();
+  if (state == State::Connected) {
+    wss_->async_close(
+        boost::beast::websocket::close_code::normal,
+        boost::beast::bind_front_handler(&SignalingTransport::OnClose,
+                                         shared_from_this()));
+  } else {
+    boost::system::error_code close_ec;
+    wss_->next_layer().next_layer().close(close_ec);
+  }
+}
+
+void SignalingTransport::OnClose(boost::system::error_code ec) {
+  if (ec) {
+    RTC_LOG(LS_ERROR) << "Failed to close: ec=" << ec;
+  }
+}
+
+void SignalingTransport::DoRead() {
+  wss_->async_read(
+      read_buffer_,
+      boost::beast::bind_front_handler(&SignalingTransport::OnRead,
+                                       shared_from_this(), generation_));
+}
+
+void SignalingTransport::OnRead(uint64_t generation,
+                                boost::system::error_code ec,
+                                std::size_t bytes_transferred) {
+  boost::ignore_unused(bytes_transferred);
+
+  if (generation != generation_ || ec == boost::asio::error::operation_aborted ||
+      state_ != State::Connected) {
+    return;
+  }
+  if (ec) {
+    Reconnect("Failed to read", ec);
+    return;
+  }
+
+  // flat_buffer is contiguous, so the message can be parsed in place.
+  const char* data = static_cast<const char*>(read_buffer_.data().data());
+  const size_t size = read_buffer_.size();
+  messages_received_++;
+  bytes_received_ += size;
+  if (handler_.on_message) {
+    handler_.on_message(data, size);
+  }
+  read_buffer_.consume(read_buffer_.size());
+  // The handler may have closed or dropped the connection.
+  if (generation == generation_ && state_ == State::Connected) {
+    DoRead();
+  }
+}
+
+/*
+Returns the next slot of the write queue to build a message into, or nullptr
+while not connected. While reconnecting, messages are dropped; the handler
+re-issues what is needed from on_connected.
+*/
+std::string* SignalingTransport::BeginMessage() {
+  if (state_ != State::Connected) {
+    RTC_LOG(LS_WARNING) << "Signaling is not connected, message dropped";
+    return nullptr;
+  }
+  return &write_queue_.Prepare();
+}
+
+void SignalingTransport::EndMessage(std::string* text) {
+  RTC_LOG(LS_INFO) << "Send signaling message: " << *text;
+  messages_sent_++;
+  bytes_sent_ += text->size();
+  write_queue_.Commit();
+  // Messages queued while a write is in progress are written back to back by
+  // OnWrite. Each one is its own websocket message, as the signaling server
+  // expects one JSON document per message.
+  if (!writing_) {
+    DoWrite();
+  }
+}
+
+void SignalingTransport::DoWrite() {
+  writing_ = true;
+  const std::string& text = write_queue_.Front();
+
+  wss_->text(true);
+  wss_->async_write(
+      boost::asio::buffer(text),
+      boost::beast::bind_front_handler(&SignalingTransport::OnWrite,
+                                       shared_from_this(), generation_));
+}
+
+void SignalingTransport::OnWrite(uint64_t generation,
+                                 boost::system::error_code ec,
+                                 std::size_t bytes_transferred) {
+  boost::ignore_unused(bytes_transferred);
+
+  if (generation != generation_ || ec == boost::asio::error::operation_aborted) {
+    return;
+  }
+  if (ec) {
+    Reconnect("Failed to write", ec);
+    return;
+  }
+
+  // The slot keeps its capacity and is reused for a later message.
+  write_queue_.Pop();
+
+  if (!write_queue_.Empty()) {
+    DoWrite();
+  } else {
+    writing_ = false;
+  }
+}
+
+SignalingTransport::Stats SignalingTransport::GetStats() const {
+  Stats stats;
+  stats.messages_sent = messages_sent_;
+  stats.bytes_sent = bytes_sent_;
+  stats.messages_received = messages_received_;
+  stats.bytes_received = bytes_received_;
+  return stats;
+}
+
+std::chrono::milliseconds SignalingTransport::WithJitter(int interval_ms) {
+  int jitter = interval_ms / 10;
+  std::uniform_int_distribution<int> dist(-jitter, jitter);
+  return std::chrono::milliseconds(interval_ms + dist(jitter_rng_));
+}
+
+}  // namespace sora
@@ -0,0 +1,152 @@
+#ifndef SORA_SIGNALING_TRANSPORT_H_INCLUDED
+#define SORA_SIGNALING_TRANSPORT_H_INCLUDED
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/asio/ssl/stream.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/strand.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/websocket/ssl.hpp>
+#include <boost/beast/websocket/stream.hpp>
+
+#include "outbound_queue.h"
+
+namespace sora {
+
+struct SignalingTransportConfig {
+  std::string host;
+  std::string port;
+  std::string path;
+
+  // Websocket が切れた場合の再接続。試行毎に待ち時間を倍にしていく。
+  // reconnect_max_attempts が 0 なら再接続しない
+  int reconnect_max_attempts = 10;
+  int reconnect_base_delay_ms = 500;
+  int reconnect_max_delay_ms = 30000;
+};
+
+// シグナリングの Websocket (wss) の接続と送受信
+//
+// 接続に失敗した、または切れた場合は、待ち時間を倍にしながら新しい Websocket で
+// 接続し直す。接続し直した後に何を送り直すかは Handler::on_connected で決める。
+// 送信するメッセージは送信キューのスロットに直接書き込み、1 つずつ順に送る。
+// Create 以外は strand 上で呼ぶこと。Handler のコールバックも strand 上で呼ばれる。
+class SignalingTransport
+    : public std::enable_shared_from_this<SignalingTransport> {
+ public:
+  typedef boost::asio::strand<boost::asio::io_context::executor_type> strand_t;
+
+  struct Handler {
+    // 接続した。resumed なら再接続で、attempts はそれまでに試行した回数
+    std::function<void(bool resumed, int attempts)> on_connected;
+    // メッセージを受信した。data はコールバックから戻るまで有効
+    std::function<void(const char* data, size_t size)> on_message;
+    // 切れたので delay_ms 待ってから attempt 回目の再接続をする
+    std::function<void(int attempt, int delay_ms)> on_reconnecting;
+    // 再接続を諦めた
+    std::function<void(int attempts)> on_closed;
+  };
+
+  // 送受信したメッセージ数とバイト数
+  struct Stats {
+    int64_t messages_sent;
+    int64_t bytes_sent;
+    int64_t messages_received;
+    int64_t bytes_received;
+  };
+
+  static std::shared_ptr<SignalingTransport> Create(
+      strand_t strand,
+      SignalingTransportConfig config,
+      Handler handler);
+
+  // 接続を開始する。既に開始していれば false を返す
+  bool Connect();
+  // Websocket を閉じる。以降は再接続しない
+  void Close();
+  // 接続が使えなくなった（pong が返ってこない等）ので、切って接続し直す
+  void Reconnect(const char* reason, boost::system::error_code ec);
+  bool IsConnected() const { return state_ == State::Connected; }
+
+  // 送信キューの空きスロットを返す。メッセージを書き込んだら EndMessage を呼ぶこと。
+  // 接続していない間は nullptr を返し、メッセージは送らない
+  std::string* BeginMessage();
+  void EndMessage(std::string* text);
+
+  // 任意のスレッドから呼び出せる
+  Stats GetStats() const;
+
+ private:
+  SignalingTransport(strand_t strand,
+                     SignalingTransportConfig config,
+                     Handler handler);
+  bool Init();
+  bool CreateWebsocket();
+  void DoConnect();
+  void OnResolve(uint64_t generation,
+                 boost::system::error_code ec,
+                 boost::asio::ip::tcp::resolver::results_type results);
+  void OnSSLConnect(uint64_t generation, boost::system::error_code ec);
+  void OnSSLHandshake(uint64_t generation, boost::system::error_code ec);
+  void OnHandshake(uint64_t generation, boost::system::error_code ec);
+  void OnReconnectTimer(boost::system::error_code ec);
+  void DoRead();
+  void OnRead(uint64_t generation,
+              boost::system::error_code ec,
+              std::size_t bytes_transferred);
+  void DoWrite();
+  void OnWrite(uint64_t generation,
+               boost::system::error_code ec,
+               std::size_t bytes_transferred);
+  void OnClose(boost::system::error_code ec);
+  // 同じ間隔で一斉に再接続しないように ±10% ずらす
+  std::chrono::milliseconds WithJitter(int interval_ms);
+
+  strand_t strand_;
+  boost::asio::ip::tcp::resolver resolver_;
+
+  typedef boost::beast::websocket::stream<
+      boost::asio::ssl::stream<boost::asio::ip::tcp::socket>>
+      ssl_websocket_t;
+  boost::asio::ssl::context ssl_ctx_;
+  std::unique_ptr<ssl_websocket_t> wss_;
+  // 再接続の度に増やす。古い Websocket の完了ハンドラはこれが違うので無視する
+  uint64_t generation_ = 0;
+  // 受信したメッセージは連続したバッファに読み込む
+  boost::beast::flat_buffer read_buffer_;
+  // 送信待ちのメッセージ。送信中は先頭のメッセージを書き込んでいる
+  OutboundQueue write_queue_;
+  bool writing_ = false;
+
+  // Idle → Connecting → Connected
+  // Connecting/Connected で失敗 → Waiting（待ってから Connecting に戻る）
+  // Close、または再接続を諦めた → Closed
+  enum class State { Idle, Connecting, Connected, Waiting, Closed };
+  State state_ = State::Idle;
+  // 一度でも接続できたら、以降の接続は再接続
+  bool resuming_ = false;
+  int reconnect_attempts_ = 0;
+  boost::asio::steady_timer reconnect_timer_;
+  std::minstd_rand jitter_rng_;
+
+  SignalingTransportConfig config_;
+  Handler handler_;
+
+  std::atomic<int64_t> messages_sent_ = {0};
+  std::atomic<int64_t> bytes_sent_ = {0};
+  std::atomic<int64_t> messages_received_ = {0};
+  std::atomic<int64_t> bytes_received_ = {0};
+};
+
+}  // namespace sora
+
+#endif  // SORA_SIGNALING_TRANSPORT_H_INCLUDED
@@ -0,0 +1,129 @@
+#include "signaling_writer.h"
+
+namespace sora {
+namespace signaling_writer {
+
+namespace {
+
+template <size_t N>
+void AppendLiteral(std::string* out, const char (&s)[N]) {
+  out->append(s, N - 1);
+}
+
+}  // namespace
+
+void AppendString(std::string* out, const std::string& s) {
+  static const char kHex[] = "0123456789abcdef";
+  out->reserve(out->size() + s.size() + 2);
+  out->push_back('"');
+  // エスケープ不要な部分はまとめてコピーする
+  const char* p = s.data();
+  const char* end = p + s.size();
+  const char* run = p;
+  for (; p != end; ++p) {
+    unsigned char c = (unsigned char)*p;
+    if (c >= 0x20 && c != '"' && c != '\\') {
+      continue;
+    }
+    out->append(run, p - run);
+    run = p + 1;
+    switch (c) {
+      case '"':
+        AppendLiteral(out, "\\\"");
+        break;
+      case '\\':
+        AppendLiteral(out, "\\\\");
+        break;
+      case '\n':
+        AppendLiteral(out, "\\n");
+        break;
+      case '\r':
+        AppendLiteral(out, "\\r");
+        break;
+      case '\t':
+        AppendLiteral(out, "\\t");
+        break;
+      case '\b':
+        AppendLiteral(out, "\\b");
+        break;
+      case '\f':
+        AppendLiteral(out, "\\f");
+        break;
+      default: {
+        char u[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xf]};
+        out->append(u, sizeof(u));
+        break;
+      }
+    }
+  }
+  out->append(run, p - run);
+  out->push_back('"');
+}
+
+void Publish(std::string* out, const std::string& stream_id, bool video) {
+  AppendLiteral(out, "{\"command\":\"publish\",\"streamId\":");
+  AppendString(out, stream_id);
+  if (video) {
+    AppendLiteral(out, ",\"video\":true}");
+  } else {
+    AppendLiteral(out, ",\"video\":false}");
+  }
+}
+
+void Play(std::string* out, const std::string& stream_id) {
+  AppendLiteral(out, "{\"command\":\"play\",\"streamId\":");
+  AppendString(out, stream_id);
+  out->push_back('}');
+}
+
+void JoinRoom(std::string* out, const std::string& room) {
+  AppendLiteral(out, "{\"command\":\"joinRoom\",\"room\":");
+  AppendString(out, room);
+  out->push_back('}');
+}
+
+void GetRoomInfo(std::string* out,
+                 const std::string& room,
+                 const std::string& stream_id) {
+  AppendLiteral(out, "{\"command\":\"getRoomInfo\",\"room\":");
+  AppendString(out, room);
+  AppendLiteral(out, ",\"streamId\":");
+  AppendString(out, stream_id);
+  out->push_back('}');
+}
+
+void Ping(std::string* out) {
+  AppendLiteral(out, "{\"command\":\"ping\"}");
+}
+
+void TakeCandidate(std::string* out,
+                   const std::string& stream_id,
+                   int label,
+                   const std::string& id,
+                   const std::string& candidate) {
+  AppendLiteral(out, "{\"command\":\"takeCandidate\",\"streamId\":");
+  AppendString(out, stream_id);
+  AppendLiteral(out, ",\"label\":");
+  out->append(std::to_string(label));
+  AppendLiteral(out, ",\"id\":");
+  AppendString(out, id);
+  AppendLiteral(out, ",\"candidate\":");
+  AppendString(out, candidate);
+  out->push_back('}');
+}
+
+void TakeConfiguration(std::string* out,
+                       const std::string& stream_id,
+                       const std::string& type,
+                       const std::string& sdp) {
+  AppendLiteral(out, "{\"command\":\"takeConfiguration\",\"streamId\":");
+  AppendString(out, stream_id);
+  AppendLiteral(out, ",\"type\":");
+  AppendString(out, type);
+  AppendLiteral(out, ",\"sdp\":");
+  AppendString(out, sdp);
+  out->push_back('}');
+}
+
+}  // namespace signaling_writer
+}  // namespace sora
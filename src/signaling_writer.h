@@ -0,0 +1,39 @@
+#ifndef SORA_SIGNALING_WRITER_H_INCLUDED
+#define SORA_SIGNALING_WRITER_H_INCLUDED
+
+#include <string>
+
+namespace sora {
+
+// シグナリングサーバに送るメッセージを組み立てる
+//
+// JSON の DOM は作らず、固定部分は文字列リテラルのまま、
+// 可変部分（ストリーム ID や SDP 等）だけをエスケープして out の末尾に直接書き込む。
+// out に確保済みの容量があれば、メモリ確保は発生しない。
+namespace signaling_writer {
+
+// s を JSON の文字列としてエスケープし、ダブルクォートで囲んで追加する
+void AppendString(std::string* out, const std::string& s);
+
+void Publish(std::string* out, const std::string& stream_id, bool video);
+void Play(std::string* out, const std::string& stream_id);
+void JoinRoom(std::string* out, const std::string& room);
+void GetRoomInfo(std::string* out,
+                 const std::string& room,
+                 const std::string& stream_id);
+void Ping(std::string* out);
+void TakeCandidate(std::string* out,
+                   const std::string& stream_id,
+                   int label,
+                   const std::string& id,
+                   const std::string& candidate);
+void TakeConfiguration(std::string* out,
+                       const std::string& stream_id,
+                       const std::string& type,
+                       const std::string& sdp);
+
+}  // namespace signaling_writer
+
+}  // namespace sora
+
+#endif  // SORA_SIGNALING_WRITER_H_INCLUDED
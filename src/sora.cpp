@@ -1,7 +1,11 @@
 #include "sora.h"
+#include <algorithm>
+#include <cstring>
+#include <boost/asio/post.hpp>
 #include <nlohmann/json.hpp>
 #include "api/task_queue/default_task_queue_factory.h"
 #include "modules/audio_device/include/audio_device_factory.h"
+#include "rtc_base/time_utils.h"
 
 #ifdef SORA_UNITY_SDK_ANDROID
 #include "sdk/android/native_api/audio_device_module/audio_device_android.h"
@@ -20,7 +24,11 @@
 using json = nlohmann::json;
 namespace sora {
 
-Sora::Sora(UnityContext* context) : context_(context) {
+Sora::Sora(UnityContext* context)
+    : context_(context),
+      event_queue_(kEventQueueCapacity),
+      pending_events_(kEventQueueCapacity),
+      stats_collector_(std::make_shared<StatsCollector>()) {
   ptrid_ = IdPointer::Instance().Register(this);
 }
 
@@ -37,6 +45,11 @@ Sora::~Sora() {
   capturer_ = nullptr;
   unity_adm_ = nullptr;
 
+  // シグナリングは IO スレッドの strand 上で破棄するので、io_context を止める前に行う。
+  // IO スレッドを起動できていなければ strand 上では何も動いていないので、解放するだけで良い
+  if (signaling_ && thread_) {
+    signaling_->release();
+  }
   if (ioc_ != nullptr) {
     ioc_->stop();
   }
@@ -45,11 +58,11 @@ Sora::~Sora() {
     thread_->Stop();
     thread_.reset();
   }
-  if (signaling_) {
-    signaling_->release();
-  }
   signaling_.reset();
+  stats_timer_.reset();
   ioc_.reset();
+  // 受信した音声トラックから外すのに signaling スレッドを使うので、先に破棄する
+  audio_receiver_.reset();
   rtc_manager_.reset();
   renderer_.reset();
   RTC_LOG(LS_INFO) << "Sora object destroy finished";
@@ -63,17 +76,158 @@ void Sora::SetOnRemoveTrack(std::function<void(ptrid_t)> on_remove_track) {
 void Sora::SetOnNotify(std::function<void(std::string)> on_notify) {
   on_notify_ = std::move(on_notify);
 }
+void Sora::SetTrackViewport(ptrid_t track_id,
+                            int width,
+                            int height,
+                            int max_fps) {
+  if (rtc_manager_ == nullptr || renderer_ == nullptr) {
+    return;
+  }
+  // rtc_manager_ は renderer_ より先に破棄されるので、
+  // このタスクが動く時には renderer_ はまだ生きている
+  UnityRenderer* renderer = renderer_.get();
+  rtc_manager_->signalingThread()->PostTask(
+      RTC_FROM_HERE, [renderer, track_id, width, height, max_fps]() {
+        renderer->SetViewport(track_id, width, height, max_fps);
+      });
+}
+void Sora::SetStreamAudioEnabled(bool enabled) {
+  stream_audio_enabled_ = enabled;
+}
+
+void Sora::PushEvent(Event ev) {
+  // overflow_events_ が空の間は lock-free のキューに積む。
+  // 一度溢れたら、overflow_events_ が空になるまでは全てのスレッドが
+  // overflow_mutex_ を取って overflow_events_ の末尾に積む。
+  // 溢れた後に積まれたイベントがキューに入って、先に溢れたイベントを追い越さないようにするため
+  if (overflow_size_.load(std::memory_order_acquire) == 0 &&
+      event_queue_.Push(std::move(ev))) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(overflow_mutex_);
+  if (overflow_events_.empty() && event_queue_.Push(std::move(ev))) {
+    // ロックを待っている間に Unity スレッドがキューを空けた
+    return;
+  }
+  // トラックの追加・削除を捨てると C# 側のトラックと食い違うし、
+  // 統計情報のコールバックを捨てると C# 側で確保したハンドルが解放されない。
+  // なのでこれらは溢れても必ず積んで、捨てるのは通知だけにする
+  if (ev.type == Event::Type::Notify &&
+      overflow_events_.size() >= kEventQueueCapacity) {
+    int64_t dropped = ++dropped_events_;
+    RTC_LOG(LS_WARNING) << "Event queue is full, event dropped: dropped="
+                        << dropped;
+    return;
+  }
+  overflow_events_.push_back(std::move(ev));
+  overflow_size_.store(overflow_events_.size(), std::memory_order_release);
+}
+
+bool Sora::PopEvent(Event& ev) {
+  // overflow_events_ に積まれたイベントは、溢れた時点でキューに入っていたイベントより後なので、
+  // キューを先に空にする
+  if (event_queue_.Pop(ev)) {
+    return true;
+  }
+  if (overflow_size_.load(std::memory_order_acquire) == 0) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(overflow_mutex_);
+  if (overflow_events_.empty()) {
+    return false;
+  }
+  ev = std::move(overflow_events_.front());
+  overflow_events_.pop_front();
+  overflow_size_.store(overflow_events_.size(), std::memory_order_release);
+  return true;
+}
 
 void Sora::DispatchEvents() {
-  while (!event_queue_.empty()) {
-    std::function<void()> f;
-    {
-      std::lock_guard<std::mutex> guard(event_mutex_);
-      f = std::move(event_queue_.front());
-      event_queue_.pop_front();
+  DispatchEvents(0);
+}
+
+int Sora::DispatchEvents(int budget_us) {
+  // ここは Unity スレッドから呼ばれる
+  // 取り出すのはリングバッファに入る分までにして、残りはキューに置いておく。
+  // 処理しきれないイベントが Unity 側に際限なく溜まらないようにするため
+  Event ev;
+  while (pending_end_ - pending_begin_ < kEventQueueCapacity && PopEvent(ev)) {
+    if (!ev.coalesce_key.empty()) {
+      auto it = coalesce_index_.find(ev.coalesce_key);
+      if (it == coalesce_index_.end()) {
+        coalesce_index_.emplace(ev.coalesce_key, pending_end_);
+      } else {
+        // 古い方は捨てて、新しい方を処理する
+        pending_events_[it->second % kEventQueueCapacity] = Event();
+        it->second = pending_end_;
+        coalesced_events_++;
+      }
     }
-    f();
+    pending_events_[pending_end_ % kEventQueueCapacity] = std::move(ev);
+    pending_end_++;
   }
+
+  auto start = std::chrono::steady_clock::now();
+  auto budget = std::chrono::microseconds(budget_us);
+  while (pending_begin_ < pending_end_) {
+    Event& e = pending_events_[pending_begin_ % kEventQueueCapacity];
+    if (e.type != Event::Type::None && budget_us > 0 &&
+        std::chrono::steady_clock::now() - start >= budget) {
+      break;
+    }
+    if (!e.coalesce_key.empty()) {
+      auto it = coalesce_index_.find(e.coalesce_key);
+      if (it != coalesce_index_.end() && it->second == pending_begin_) {
+        coalesce_index_.erase(it);
+      }
+    }
+    pending_begin_++;
+    RunEvent(e);
+    e = Event();
+  }
+
+  pending_size_ = pending_end_ - pending_begin_;
+  return GetEventQueueDepth();
+}
+
+void Sora::RunEvent(Event& ev) {
+  switch (ev.type) {
+    case Event::Type::AddTrack:
+      if (on_add_track_) {
+        on_add_track_(ev.track_id);
+      }
+      break;
+    case Event::Type::RemoveTrack:
+      if (on_remove_track_) {
+        on_remove_track_(ev.track_id);
+      }
+      break;
+    case Event::Type::Notify:
+      if (on_notify_) {
+        on_notify_(std::move(ev.json));
+      }
+      break;
+    case Event::Type::Stats:
+      ev.on_get_stats(std::move(ev.json));
+      break;
+    case Event::Type::None:
+      break;
+  }
+}
+
+void Sora::SetEventCoalescing(bool enabled) {
+  coalesce_events_ = enabled;
+}
+
+int Sora::GetEventQueueDepth() const {
+  return (int)(event_queue_.Size() + overflow_size_.load() +
+               pending_size_.load());
+}
+int64_t Sora::GetDroppedEventCount() const {
+  return dropped_events_;
+}
+int64_t Sora::GetCoalescedEventCount() const {
+  return coalesced_events_;
 }
 
 bool Sora::Connect(const Sora::ConnectConfig& cc) {
@@ -123,24 +277,22 @@ bool Sora::DoConnect(const Sora::ConnectConfig& cc) {
 
   renderer_.reset(new UnityRenderer(
       [this](ptrid_t track_id) {
-        std::lock_guard<std::mutex> guard(event_mutex_);
-        event_queue_.push_back([this, track_id]() {
-          // ここは Unity スレッドから呼ばれる
-          if (on_add_track_) {
-            on_add_track_(track_id);
-          }
-        });
+        Event ev;
+        ev.type = Event::Type::AddTrack;
+        ev.track_id = track_id;
+        PushEvent(std::move(ev));
       },
       [this](ptrid_t track_id) {
-        std::lock_guard<std::mutex> guard(event_mutex_);
-        event_queue_.push_back([this, track_id]() {
-          // ここは Unity スレッドから呼ばれる
-          if (on_remove_track_) {
-            on_remove_track_(track_id);
-          }
-        });
+        Event ev;
+        ev.type = Event::Type::RemoveTrack;
+        ev.track_id = track_id;
+        PushEvent(std::move(ev));
       }));
 
+  if (stream_audio_enabled_) {
+    audio_receiver_.reset(new UnityAudioReceiver());
+  }
+
   std::unique_ptr<rtc::Thread> worker_thread = rtc::Thread::Create();
   worker_thread->Start();
 
@@ -179,8 +331,8 @@ bool Sora::DoConnect(const Sora::ConnectConfig& cc) {
     if (cc.audio_only==true)
       config.no_video = true;
     rtc_manager_ = RTCManager::Create(
-        config, std::move(capturer), renderer_.get(), unity_adm_,
-        std::move(task_queue_factory), std::move(signaling_thread),
+        config, std::move(capturer), renderer_.get(), audio_receiver_.get(),
+        unity_adm_, std::move(task_queue_factory), std::move(signaling_thread),
         std::move(worker_thread));
   } else {
     // 受信側は capturer を作らず、video, recording の設定もしない
@@ -190,10 +342,10 @@ bool Sora::DoConnect(const Sora::ConnectConfig& cc) {
 
     config.audio_recording_device = cc.audio_recording_device;
     config.audio_playout_device = cc.audio_playout_device;
-    rtc_manager_ = RTCManager::Create(config, nullptr, renderer_.get(),
-                                      unity_adm_, std::move(task_queue_factory),
-                                      std::move(signaling_thread),
-                                      std::move(worker_thread));
+    rtc_manager_ = RTCManager::Create(
+        config, nullptr, renderer_.get(), audio_receiver_.get(), unity_adm_,
+        std::move(task_queue_factory), std::move(signaling_thread),
+        std::move(worker_thread));
   }
 
   {
@@ -214,6 +366,12 @@ bool Sora::DoConnect(const Sora::ConnectConfig& cc) {
     config.audio_codec = cc.audio_codec;
     config.audio_bitrate = cc.audio_bitrate;
     config.audio_only = cc.audio_only;
+    config.keepalive_interval_ms = keepalive_interval_ms_;
+    config.room_refresh_interval_ms = room_refresh_interval_ms_;
+    config.reconnect_max_attempts = reconnect_max_attempts_;
+    config.reconnect_base_delay_ms = reconnect_base_delay_ms_;
+    config.reconnect_max_delay_ms = reconnect_max_delay_ms_;
+    config.candidate_batch_ms = candidate_batch_ms_;
     if (!cc.metadata.empty()) {
       auto md = nlohmann::json::parse(cc.metadata, nullptr, false);
       if (md.type() == nlohmann::json::value_t::discarded) {
@@ -225,14 +383,15 @@ bool Sora::DoConnect(const Sora::ConnectConfig& cc) {
 
     ioc_.reset(new boost::asio::io_context(1));
     signaling_ = SoraSignaling::Create(
-        *ioc_, rtc_manager_.get(), config, [this](std::string json) {
-          std::lock_guard<std::mutex> guard(event_mutex_);
-          event_queue_.push_back([this, json = std::move(json)]() {
-            // ここは Unity スレッドから呼ばれる
-            if (on_notify_) {
-              on_notify_(std::move(json));
-            }
-          });
+        *ioc_, rtc_manager_.get(), config,
+        [this](std::string json, std::string coalesce_key) {
+          Event ev;
+          ev.type = Event::Type::Notify;
+          if (coalesce_events_) {
+            ev.coalesce_key = std::move(coalesce_key);
+          }
+          ev.json = std::move(json);
+          PushEvent(std::move(ev));
         });
     if (signaling_ == nullptr) {
       return false;
@@ -240,15 +399,19 @@ bool Sora::DoConnect(const Sora::ConnectConfig& cc) {
     if (!signaling_->connect()) {
       return false;
     }
+    stats_timer_.reset(new boost::asio::steady_timer(*ioc_));
+    boost::asio::post(*ioc_, [this]() { StartStatsTimer(); });
   }
 
   thread_ = rtc::Thread::Create();
   if (!thread_->SetName("Sora IO Thread", nullptr)) {
     RTC_LOG(LS_INFO) << "Failed to set thread name";
+    thread_.reset();
     return false;
   }
   if (!thread_->Start()) {
     RTC_LOG(LS_INFO) << "Failed to start thread";
+    thread_.reset();
     return false;
   }
   thread_->PostTask(RTC_FROM_HERE, [this]() {
@@ -261,7 +424,9 @@ bool Sora::DoConnect(const Sora::ConnectConfig& cc) {
 }
 
 void Sora::RenderCallbackStatic(int event_id) {
-  auto sora = (sora::Sora*)IdPointer::Instance().Lookup(event_id);
+  // ピン留めしている間は ~Sora が Unregister で待つので、Sora は破棄されない
+  auto pinned = IdPointer::Instance().Lookup(event_id);
+  auto sora = (sora::Sora*)pinned.get();
   if (sora == nullptr) {
     return;
   }
@@ -277,12 +442,98 @@ void Sora::RenderCallback() {
     static_cast<UnityCameraCapturer*>(capturer_.get())->OnRender();
   }
 }
-void Sora::ProcessAudio(const void* p, int offset, int samples) {
+void Sora::ProcessAudio(const void* p,
+                        int offset,
+                        int samples,
+                        int channels,
+                        int sample_rate) {
+  if (!unity_adm_) {
+    return;
+  }
+  unity_adm_->ProcessAudioData((const float*)p + offset, samples, channels,
+                               sample_rate);
+}
+void Sora::PullAudio(void* p,
+                     int offset,
+                     int samples,
+                     int channels,
+                     int sample_rate) {
   if (!unity_adm_) {
+    std::fill((float*)p + offset, (float*)p + offset + samples * channels,
+              0.0f);
+    return;
+  }
+  unity_adm_->PullAudioData((float*)p + offset, samples, channels,
+                            sample_rate);
+}
+void Sora::EnumAudioStreams(std::function<void(const std::string&)> f) {
+  if (!audio_receiver_) {
+    return;
+  }
+  audio_receiver_->EnumStreams(std::move(f));
+}
+int Sora::PullStreamAudio(const std::string& stream_id,
+                          void* p,
+                          int offset,
+                          int samples,
+                          int channels,
+                          int sample_rate) {
+  float* data = (float*)p + offset;
+  auto sink = audio_receiver_ ? audio_receiver_->GetSink(stream_id) : nullptr;
+  if (!sink) {
+    std::fill(data, data + samples * channels, 0.0f);
+    return 0;
+  }
+  return sink->Pull(data, samples, channels, sample_rate);
+}
+int Sora::GetStreamAudioSampleRate(const std::string& stream_id) {
+  auto sink = audio_receiver_ ? audio_receiver_->GetSink(stream_id) : nullptr;
+  return sink ? sink->GetSampleRate() : 0;
+}
+void Sora::SetStreamAudioSpatial(const std::string& stream_id,
+                                 float gain,
+                                 float pan,
+                                 float distance) {
+  auto sink = audio_receiver_ ? audio_receiver_->GetSink(stream_id) : nullptr;
+  if (sink) {
+    sink->SetSpatial(gain, pan, distance);
+  }
+}
+void Sora::PullSpatialAudio(void* p,
+                            int offset,
+                            int samples,
+                            int channels,
+                            int sample_rate) {
+  float* data = (float*)p + offset;
+  if (!audio_receiver_) {
+    std::fill(data, data + samples * channels, 0.0f);
     return;
   }
-  // 今のところステレオデータを渡すようにしてるので2倍する
-  unity_adm_->ProcessAudioData((const float*)p + offset, samples * 2);
+  audio_receiver_->Mix(data, samples, channels, sample_rate);
+}
+int Sora::GetAudioLevels(sora_audio_level_t* levels, int max_levels) {
+  int count = 0;
+  auto set_level = [levels, max_levels, &count](
+                       const std::string& stream_id,
+                       const AudioLevelMeter::Level& level) {
+    if (count >= max_levels) {
+      return;
+    }
+    sora_audio_level_t& dst = levels[count++];
+    size_t size = std::min(stream_id.size(), sizeof(dst.stream_id) - 1);
+    memcpy(dst.stream_id, stream_id.data(), size);
+    dst.stream_id[size] = '\0';
+    dst.rms = level.rms;
+    dst.peak = level.peak;
+    dst.voice_active = level.voice_active;
+  };
+  if (unity_adm_) {
+    set_level("", unity_adm_->GetRecordingLevel());
+  }
+  if (audio_receiver_) {
+    audio_receiver_->EnumLevels(set_level);
+  }
+  return count;
 }
 void Sora::SetOnHandleAudio(std::function<void(const int16_t*, int, int)> f) {
   on_handle_audio_ = f;
@@ -366,39 +617,159 @@ rtc::scoped_refptr<rtc::AdaptedVideoTrackSource> Sora::CreateVideoCapturer(
                                        video_height);
   }
 }
+void Sora::SetKeepalive(int keepalive_interval_ms,
+                        int room_refresh_interval_ms) {
+  keepalive_interval_ms_ = keepalive_interval_ms;
+  room_refresh_interval_ms_ = room_refresh_interval_ms;
+  if (signaling_ != nullptr) {
+    signaling_->setKeepalive(keepalive_interval_ms, room_refresh_interval_ms);
+  }
+}
+
+void Sora::SetReconnect(int max_attempts,
+                        int base_delay_ms,
+                        int max_delay_ms) {
+  reconnect_max_attempts_ = std::max(max_attempts, 0);
+  reconnect_base_delay_ms_ = std::max(base_delay_ms, 1);
+  reconnect_max_delay_ms_ = std::max(max_delay_ms, reconnect_base_delay_ms_);
+}
+
+void Sora::SetCandidateBatching(int window_ms) {
+  candidate_batch_ms_ = std::max(window_ms, 0);
+}
+
+void Sora::GetSignalingStats(sora_signaling_stats_t* stats) {
+  if (signaling_ == nullptr) {
+    memset(stats, 0, sizeof(*stats));
+    return;
+  }
+  signaling_->getSignalingStats(stats);
+}
+
 /*
-If it is conference, sends getRoomInfo every 5 seconds.
+Gets the stats report of the current connection. Keepalive and room refresh are
+sent by the signaling scheduler, so nothing is sent over the websocket here.
 */
 void Sora::GetStats(std::function<void (std::string)> on_get_stats) {
   auto conn = signaling_ == nullptr ? nullptr : signaling_->getRTCConnection();
   if (signaling_ == nullptr || conn == nullptr) {
-    std::lock_guard<std::mutex> guard(event_mutex_);
-    event_queue_.push_back([on_get_stats = std::move(on_get_stats)]() {
-      // ここは Unity スレッドから呼ばれる
-      on_get_stats("[]");
-    });
+    Event ev;
+    ev.type = Event::Type::Stats;
+    ev.json = "[]";
+    ev.on_get_stats = std::move(on_get_stats);
+    PushEvent(std::move(ev));
     return;
   } else {
-    json json_message = {
-        {"command", "getRoomInfo"},
-        {"room", channel_id_},
-        {"streamId", conn->getStreamId()},
-    };
-    if (conrole == "sendrecv")
-      signaling_->sendText(json_message.dump());    //Sends getroominfo every 5 seconds to ensure there is no stream missing in the list. 
-                                                    //If any stream has stopped, it removes the stream. If any stream added, it will start playing it.
-    signaling_->doSendPong();
     conn->getStats(
     [this, on_get_stats = std::move(on_get_stats)](const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report) {
-      std::string json = report->ToJson();
-      std::lock_guard<std::mutex> guard(event_mutex_);
-      event_queue_.push_back([on_get_stats = std::move(on_get_stats), json = std::move(json)]() {
-        // ここは Unity スレッドから呼ばれる
-        on_get_stats(std::move(json));
-      });
+      Event ev;
+      ev.type = Event::Type::Stats;
+      ev.json = AppendAudioPlayoutStats(report->ToJson());
+      ev.on_get_stats = std::move(on_get_stats);
+      PushEvent(std::move(ev));
     });
   }
 }
+int Sora::GetStreamStats(sora_stream_stats_t* stats, int max_stats) {
+  // 定期的に取得している場合は、最新の結果を返すだけで良い。
+  // そうでない場合は次の取得を始めるが、毎フレーム呼ばれても getStats が
+  // 溜まらないように、前回の取得が終わっていて一定時間経った場合だけにする
+  if (signaling_ != nullptr && ioc_ != nullptr && stats_interval_ms_ <= 0) {
+    int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::steady_clock::now().time_since_epoch())
+                         .count();
+    if (stats_collector_->TryBeginRequest(now_ms, kMinStatsRequestIntervalMs,
+                                          kStatsRequestTimeoutMs)) {
+      boost::asio::post(*ioc_, [this]() { CollectStreamStats(); });
+    }
+  }
+  return stats_collector_->GetStats(stats, max_stats);
+}
+
+void Sora::SetStatsSampling(int interval_ms, int history_size) {
+  stats_collector_->SetHistorySize(history_size);
+  stats_interval_ms_ = std::max(interval_ms, 0);
+  // 接続後に変更された場合はタイマーを掛け直す
+  if (stats_timer_ != nullptr) {
+    boost::asio::post(*ioc_, [this]() { StartStatsTimer(); });
+  }
+}
+
+int Sora::GetStreamStatsHistory(const std::string& stream_id,
+                                const std::string& kind,
+                                bool inbound,
+                                sora_stream_stats_t* stats,
+                                int max_stats) {
+  return stats_collector_->GetHistory(stream_id, kind, inbound, stats,
+                                      max_stats);
+}
+
+void Sora::CollectStreamStats() {
+  // コネクションの一覧はシグナリングのスレッドで触る
+  auto collector = stats_collector_;
+  auto conns = signaling_->getRTCConnections();
+  collector->ExpectReports((int)conns.size());
+  std::vector<std::string> stream_ids;
+  for (auto conn : conns) {
+    std::string stream_id = conn->getStreamId();
+    stream_ids.push_back(stream_id);
+    conn->getStats(
+        [collector, stream_id](
+            const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report) {
+          collector->OnReport(stream_id, report);
+        });
+  }
+  collector->Retain(stream_ids);
+}
+
+void Sora::StartStatsTimer() {
+  stats_timer_->cancel();
+  int interval_ms = stats_interval_ms_;
+  if (interval_ms <= 0) {
+    return;
+  }
+  stats_timer_->expires_after(std::chrono::milliseconds(interval_ms));
+  stats_timer_->async_wait([this](const boost::system::error_code& ec) {
+    if (ec == boost::asio::error::operation_aborted) {
+      return;
+    }
+    CollectStreamStats();
+    StartStatsTimer();
+  });
+}
+/*
+Appends the playout counters of the Unity audio device to the stats report
+as an object of type "sora-audio-playout".
+*/
+std::string Sora::AppendAudioPlayoutStats(std::string report_json) const {
+  if (!unity_adm_) {
+    return report_json;
+  }
+  auto stats = unity_adm_->GetPlayoutStats();
+  if (stats.chunks == 0) {
+    return report_json;
+  }
+  json playout = {
+      {"type", "sora-audio-playout"},
+      {"id", "sora-audio-playout"},
+      {"timestamp", rtc::TimeMicros()},
+      {"pull", stats.pull},
+      {"chunks", stats.chunks},
+      {"underruns", stats.underruns},
+      {"overruns", stats.overruns},
+      {"lateWakeups", stats.late_wakeups},
+      {"resyncs", stats.resyncs},
+      {"jitterUs", stats.jitter_us},
+      {"bufferedMs", stats.buffered_ms},
+  };
+  auto pos = report_json.rfind(']');
+  if (pos == std::string::npos) {
+    return report_json;
+  }
+  bool empty = report_json.find_first_not_of(" \t\r\n[", 0) >= pos;
+  report_json.insert(pos, (empty ? "" : ",") + playout.dump());
+  return report_json;
+}
 /*
 Sends data channel message according to taken str from unity app.
 */
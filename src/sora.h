@@ -1,12 +1,18 @@
 #ifndef SORA_SORA_H_INCLUDED
 #define SORA_SORA_H_INCLUDED
 
+#include <atomic>
+#include <deque>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <vector>
 
 // boost
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
 
 #if defined(SORA_UNITY_SDK_MACOS) || defined(SORA_UNITY_SDK_IOS)
 #include "mac_helper/mac_capturer.h"
@@ -21,10 +27,13 @@
 
 // sora
 #include "id_pointer.h"
+#include "mpsc_queue.h"
 #include "rtc/rtc_manager.h"
+#include "rtc/stats_collector.h"
 #include "sora_signaling.h"
 #include "unity.h"
 #include "unity_audio_device.h"
+#include "unity_audio_receiver.h"
 #include "unity_camera_capturer.h"
 #include "unity_context.h"
 #include "unity_renderer.h"
@@ -32,6 +41,19 @@
 namespace sora {
 
 class Sora {
+  // Unity スレッドで処理するイベント
+  // 各スレッドから event_queue_ に積まれ、DispatchEvents でまとめて処理される
+  struct Event {
+    enum class Type { None, AddTrack, RemoveTrack, Notify, Stats };
+    Type type = Type::None;
+    ptrid_t track_id = 0;
+    std::string json;
+    std::function<void(std::string)> on_get_stats;
+    // 空でなければ、同じキーを持つ未処理の古いイベントはこのイベントで置き換えられる
+    std::string coalesce_key;
+  };
+  static const size_t kEventQueueCapacity = 4096;
+
   std::unique_ptr<boost::asio::io_context> ioc_;
   UnityContext* context_;
   std::string signaling_url_;
@@ -40,13 +62,34 @@ class Sora {
   std::shared_ptr<SoraSignaling> signaling_;
   std::unique_ptr<rtc::Thread> thread_;
   std::unique_ptr<UnityRenderer> renderer_;
+  // ストリーム毎の音声の取り出しが有効な場合のみ作る
+  bool stream_audio_enabled_ = false;
+  std::unique_ptr<UnityAudioReceiver> audio_receiver_;
   std::function<void(ptrid_t)> on_add_track_;
   std::function<void(ptrid_t)> on_remove_track_;
   std::function<void(std::string)> on_notify_;
   std::function<void(const int16_t*, int, int)> on_handle_audio_;
   std::string conrole;
-  std::mutex event_mutex_;
-  std::deque<std::function<void()>> event_queue_;
+  MpscQueue<Event> event_queue_;
+  // event_queue_ が一杯の時に、捨てられないイベントを積んでおく。
+  // 溢れている間は順序を保つため、全てのイベントをこちらに積む
+  std::mutex overflow_mutex_;
+  std::deque<Event> overflow_events_;
+  std::atomic<size_t> overflow_size_ = {0};
+  std::atomic<int64_t> dropped_events_ = {0};
+  // Unity スレッドからのみ触る
+  // event_queue_ から取り出したけど、まだ処理していないイベントのリングバッファ。
+  // pending_begin_ と pending_end_ は取り出した順の通し番号で、
+  // pending_events_[n % kEventQueueCapacity] が n 番目のイベントになる
+  std::vector<Event> pending_events_;
+  size_t pending_begin_ = 0;
+  size_t pending_end_ = 0;
+  // coalesce_key から、そのキーを持つ最新のイベントの通し番号へのマップ
+  std::unordered_map<std::string, size_t> coalesce_index_;
+  // pending_events_ の未処理のイベントの数。GetEventQueueDepth で使う
+  std::atomic<size_t> pending_size_ = {0};
+  std::atomic_bool coalesce_events_ = {false};
+  std::atomic<int64_t> coalesced_events_ = {0};
 
   ptrid_t ptrid_;
 
@@ -55,6 +98,22 @@ class Sora {
 
   rtc::scoped_refptr<UnityAudioDevice> unity_adm_;
 
+  std::shared_ptr<StatsCollector> stats_collector_;
+  // GetStreamStats で統計情報を取得し直す最短の間隔
+  static const int kMinStatsRequestIntervalMs = 250;
+  // GetStreamStats で始めた取得の結果がこの時間揃わなければ、取得し直す
+  static const int kStatsRequestTimeoutMs = 2000;
+  // 統計情報を定期的に取得する間隔。0 なら GetStreamStats の呼び出し毎に取得する
+  std::atomic<int> stats_interval_ms_ = {0};
+  // ioc_ のスレッドからのみ触る
+  std::unique_ptr<boost::asio::steady_timer> stats_timer_;
+  int keepalive_interval_ms_ = 5000;
+  int room_refresh_interval_ms_ = 5000;
+  int reconnect_max_attempts_ = 10;
+  int reconnect_base_delay_ms_ = 500;
+  int reconnect_max_delay_ms_ = 30000;
+  int candidate_batch_ms_ = 0;
+
  public:
   Sora(UnityContext* context);
   ~Sora();
@@ -62,6 +121,14 @@ class Sora {
   void SetOnRemoveTrack(std::function<void(ptrid_t)> on_remove_track);
   void SetOnNotify(std::function<void(std::string)> on_notify);
   void DispatchEvents();
+  // budget_us マイクロ秒を使い切ったら処理を打ち切り、残りは次回に回す。
+  // budget_us <= 0 の場合は全て処理する。
+  // 戻り値は次回に回したイベントの数（キューに残っている分も含む）。
+  int DispatchEvents(int budget_us);
+  void SetEventCoalescing(bool enabled);
+  int GetEventQueueDepth() const;
+  int64_t GetDroppedEventCount() const;
+  int64_t GetCoalescedEventCount() const;
 
   struct ConnectConfig {
     std::string unity_version;
@@ -93,14 +160,90 @@ class Sora {
 
   void RenderCallback();
 
-  void ProcessAudio(const void* p, int offset, int samples);
+  // Unity 側で track_id を表示しているサイズとフレームレートを設定する。
+  // 受信トラックの Sink は signaling スレッドで追加・削除されるので、設定もそこで行う
+  void SetTrackViewport(ptrid_t track_id, int width, int height, int max_fps);
+
+  // samples は 1 チャンネルあたりのサンプル数
+  void ProcessAudio(const void* p,
+                    int offset,
+                    int samples,
+                    int channels,
+                    int sample_rate);
   void SetOnHandleAudio(std::function<void(const int16_t*, int, int)> f);
+  // 受信した音声を取り出す。samples は 1 チャンネルあたりのサンプル数
+  void PullAudio(void* p,
+                 int offset,
+                 int samples,
+                 int channels,
+                 int sample_rate);
+
+  // 受信した音声をストリーム毎に取り出せるようにする。Connect の前に呼ぶこと
+  void SetStreamAudioEnabled(bool enabled);
+  void EnumAudioStreams(std::function<void(const std::string&)> f);
+  // stream_id の音声を sample_rate に変換して取り出す。
+  // 取り出せたサンプル数を返して、足りない分は無音で埋める
+  int PullStreamAudio(const std::string& stream_id,
+                      void* p,
+                      int offset,
+                      int samples,
+                      int channels,
+                      int sample_rate);
+  int GetStreamAudioSampleRate(const std::string& stream_id);
+  // ストリーム毎の音量・定位・距離を設定する
+  void SetStreamAudioSpatial(const std::string& stream_id,
+                             float gain,
+                             float pan,
+                             float distance);
+  // 全ストリームを SetStreamAudioSpatial の設定で混ぜて、sample_rate で取り出す
+  void PullSpatialAudio(void* p,
+                        int offset,
+                        int samples,
+                        int channels,
+                        int sample_rate);
+  // 送信音声と、ストリーム毎の受信音声のレベルを levels に書き込んで、書き込んだ数を返す
+  int GetAudioLevels(sora_audio_level_t* levels, int max_levels);
+
+  // 前回の呼び出し以降に集めたストリーム毎の統計情報を stats に書き込んで、書き込んだ数を返す。
+  // 定期的に取得していない場合は、呼び出した時に次の統計情報の取得を開始するので、
+  // 返す値は 1 回前の呼び出しで始めた取得の結果になる。取得を始めるのは前回の取得が
+  // 終わっていて kMinStatsRequestIntervalMs 経った場合だけ。シグナリングのメッセージは送らない。
+  int GetStreamStats(sora_stream_stats_t* stats, int max_stats);
+  // interval_ms ミリ秒毎に統計情報を取得し、ストリーム毎に直近 history_size 個を残す。
+  // interval_ms <= 0 で定期的な取得を止める。
+  void SetStatsSampling(int interval_ms, int history_size);
+  // 残している統計情報を古い順に stats に書き込んで、書き込んだ数を返す
+  int GetStreamStatsHistory(const std::string& stream_id,
+                            const std::string& kind,
+                            bool inbound,
+                            sora_stream_stats_t* stats,
+                            int max_stats);
+
+  // シグナリングの ping と（sendrecv の場合の）getRoomInfo を送る間隔。
+  // 0 なら送らない。Connect の前後どちらでも呼び出せる
+  void SetKeepalive(int keepalive_interval_ms, int room_refresh_interval_ms);
+
+  // シグナリングの Websocket が切れた場合の再接続の設定。Connect の前に呼ぶこと。
+  // max_attempts が 0 なら再接続しない
+  void SetReconnect(int max_attempts, int base_delay_ms, int max_delay_ms);
+  // offer/answer の SDP を最大 window_ms 保留して、その間に集まった ICE 候補を SDP に
+  // 含めて送る。0 なら保留せず、候補は見つかり次第 takeCandidate で送る。
+  // Connect の前に呼ぶこと
+  void SetCandidateBatching(int window_ms);
+  void GetSignalingStats(sora_signaling_stats_t* stats);
 
   void GetStats(std::function<void (std::string)> on_get_stats);
   void SendDataChannelMessage(const char* str);
 
  private:
   bool DoConnect(const ConnectConfig& config);
+  // ioc_ のスレッドで呼ぶこと
+  void CollectStreamStats();
+  void StartStatsTimer();
+  void PushEvent(Event ev);
+  bool PopEvent(Event& ev);
+  void RunEvent(Event& ev);
+  std::string AppendAudioPlayoutStats(std::string report_json) const;
 
   static rtc::scoped_refptr<UnityAudioDevice> CreateADM(
       webrtc::TaskQueueFactory* task_queue_factory,
@@ -1,11 +1,11 @@
 #include "sora_signaling.h"
+#include "signaling_writer.h"
 #include "sora_version.h"
 
-#include <boost/asio/connect.hpp>
-#include <boost/beast/core/buffers_to_string.hpp>
 #include <boost/beast/websocket/stream.hpp>
 #include <boost/preprocessor/stringize.hpp>
 #include <nlohmann/json.hpp>
+#include <future>
 #include <thread>
 namespace {
 
@@ -32,6 +32,27 @@ std::string iceConnectionStateToString(
   return "unknown";
 }
 
+/*
+Notifications that only report the latest state of the signaling connection.
+They are merged with each other by event coalescing.
+*/
+const char* const kStateNotifications[] = {
+    "signalingReconnecting",
+    "signalingReconnected",
+    "signalingClosed",
+};
+
+/*
+Notifications that carry the whole current state of one stream or room, so a
+newer one makes an older one of the same definition and stream redundant.
+They are merged per (definition, streamId). Anything else, data channel
+messages in particular, is never merged.
+*/
+const char* const kIdempotentNotifications[] = {
+    "roomMembershipChanged",
+    "streamStateChanged",
+};
+
 }  // namespace
 
 using json = nlohmann::json;
@@ -40,37 +61,65 @@ namespace sora {
 
 webrtc::PeerConnectionInterface::IceConnectionState
 SoraSignaling::getRTCConnectionState() const {
-  return rtc_state_;
+  return rtc_state_.load();
 }
 
-//Checks for iceconnection state and for the role and returns the appropriate rtconnection.
-std::shared_ptr<RTCConnection> SoraSignaling::getRTCConnection()const{
-    if (config_.multistream == true && config_.role == SoraSignalingConfig::Role::Sendrecv && !publishstreamId.empty()){
-    if (connection_.at(publishstreamId)->getIceState() ==webrtc::PeerConnectionInterface::IceConnectionState::kIceConnectionConnected ||
-        connection_.at(publishstreamId)->getIceState() == webrtc::PeerConnectionInterface::IceConnectionState::kIceConnectionCompleted) {
-      return connection_.at(publishstreamId);
-    }
+/*
+Checks for iceconnection state and for the role and returns the appropriate
+rtconnection. Reads the snapshot, so it can be called from any thread.
+*/
+std::shared_ptr<RTCConnection> SoraSignaling::getRTCConnection() const {
+  auto snapshot = std::atomic_load(&snapshot_);
+  if (snapshot == nullptr || snapshot->primary == nullptr) {
+    return nullptr;
   }
-    if (config_.role == SoraSignalingConfig::Role::Recvonly && !playonlystreamId.empty()) {
-    if (connection_.at(playonlystreamId)->getIceState() ==webrtc::PeerConnectionInterface::IceConnectionState::kIceConnectionConnected ||
-        connection_.at(playonlystreamId)->getIceState() ==webrtc::PeerConnectionInterface::IceConnectionState::kIceConnectionCompleted) {
-      return connection_.at(playonlystreamId);
-      }
+  auto state = snapshot->primary->getIceState();
+  if (state == webrtc::PeerConnectionInterface::kIceConnectionConnected ||
+      state == webrtc::PeerConnectionInterface::kIceConnectionCompleted) {
+    return snapshot->primary;
+  }
+  return nullptr;
+}
+
+std::vector<std::shared_ptr<RTCConnection>> SoraSignaling::getRTCConnections()
+    const {
+  auto snapshot = std::atomic_load(&snapshot_);
+  if (snapshot == nullptr) {
+    return std::vector<std::shared_ptr<RTCConnection>>();
+  }
+  return snapshot->connections;
+}
+
+/*
+Replaces the snapshot read by other threads. Called on the strand after
+streams_ or the publish/play stream ids changed.
+*/
+void SoraSignaling::publishSnapshot() {
+  auto snapshot = std::make_shared<Snapshot>();
+  for (const auto& it : streams_) {
+    if (it.second.connection != nullptr) {
+      snapshot->connections.push_back(it.second.connection);
     }
-    if (config_.role == SoraSignalingConfig::Role::Sendonly&& !publishstreamId.empty()) {
-      if (connection_.at(publishstreamId)->getIceState() == webrtc::PeerConnectionInterface::IceConnectionState::kIceConnectionConnected ||
-          connection_.at(publishstreamId)->getIceState() ==webrtc::PeerConnectionInterface::IceConnectionState::kIceConnectionCompleted) {
-        return connection_.at(publishstreamId);
-      }
+    if (it.second.datachannel != nullptr) {
+      snapshot->datachannels[it.first] = it.second.datachannel;
     }
-    return nullptr;
+  }
+  const std::string& primary =
+      config_.role == SoraSignalingConfig::Role::Recvonly ? playonlystreamId
+                                                          : publishstreamId;
+  auto it = streams_.find(primary);
+  if (!primary.empty() && it != streams_.end()) {
+    snapshot->primary = it->second.connection;
+  }
+  std::atomic_store(&snapshot_,
+                    std::shared_ptr<const Snapshot>(std::move(snapshot)));
 }
 
 std::shared_ptr<SoraSignaling> SoraSignaling::Create(
     boost::asio::io_context& ioc,
     RTCManager* manager,
     SoraSignalingConfig config,
-    std::function<void(std::string)> on_notify) {
+    notify_callback_t on_notify) {
   auto p = std::shared_ptr<SoraSignaling>(
       new SoraSignaling(ioc, manager, config, std::move(on_notify)));
   if (!p->Init()) {
@@ -82,12 +131,15 @@ std::shared_ptr<SoraSignaling> SoraSignaling::Create(
 SoraSignaling::SoraSignaling(boost::asio::io_context& ioc,
                              RTCManager* manager,
                              SoraSignalingConfig config,
-                             std::function<void(std::string)> on_notify)
+                             notify_callback_t on_notify)
     : ioc_(ioc),
-      resolver_(ioc),
+      strand_(boost::asio::make_strand(ioc)),
       manager_(manager),
       config_(config),
-      on_notify_(std::move(on_notify)) {}
+      on_notify_(std::move(on_notify)),
+      keepalive_timer_(strand_),
+      room_refresh_timer_(strand_),
+      jitter_rng_(std::random_device()()) {}
 
 bool SoraSignaling::Init() {
   if (!URLParts::parse(config_.signaling_url, parts_)) {
@@ -101,132 +153,195 @@ bool SoraSignaling::Init() {
     return false;
   }
 
-  boost::asio::ssl::context ssl_ctx(boost::asio::ssl::context::tlsv12);
-  ssl_ctx.set_default_verify_paths();
-  ssl_ctx.set_options(boost::asio::ssl::context::default_workarounds |
-                      boost::asio::ssl::context::no_sslv2 |
-                      boost::asio::ssl::context::no_sslv3 |
-                      boost::asio::ssl::context::single_dh_use);
-
-  wss_.reset(new ssl_websocket_t(ioc_, ssl_ctx));
-  wss_->write_buffer_bytes(8192);
-
-  // SNI
-  if (!SSL_set_tlsext_host_name(wss_->next_layer().native_handle(),
-                                parts_.host.c_str())) {
-    boost::system::error_code ec{static_cast<int>(::ERR_get_error()),
-                                 boost::asio::error::get_ssl_category()};
-    RTC_LOG(LS_ERROR) << "Failed SSL_set_tlsext_host_name: ec=" << ec;
+  SignalingTransportConfig transport_config;
+  transport_config.host = parts_.host;
+  transport_config.port = parts_.port.empty() ? "5443" : parts_.port;
+  transport_config.path = parts_.path_query_fragment;
+  transport_config.reconnect_max_attempts = config_.reconnect_max_attempts;
+  transport_config.reconnect_base_delay_ms = config_.reconnect_base_delay_ms;
+  transport_config.reconnect_max_delay_ms = config_.reconnect_max_delay_ms;
+
+  // Pending operations keep the transport alive after this object is gone,
+  // so its callbacks only hold this object weakly.
+  std::weak_ptr<SoraSignaling> weak = shared_from_this();
+  SignalingTransport::Handler handler;
+  handler.on_connected = [weak](bool resumed, int attempts) {
+    if (auto self = weak.lock()) {
+      self->onConnected(resumed, attempts);
+    }
+  };
+  handler.on_message = [weak](const char* data, size_t size) {
+    if (auto self = weak.lock()) {
+      self->onSignalingMessage(data, size);
+    }
+  };
+  handler.on_reconnecting = [weak](int attempt, int delay_ms) {
+    if (auto self = weak.lock()) {
+      self->onReconnecting(attempt, delay_ms);
+    }
+  };
+  handler.on_closed = [weak](int attempts) {
+    if (auto self = weak.lock()) {
+      self->onClosed(attempts);
+    }
+  };
+  transport_ = SignalingTransport::Create(strand_, std::move(transport_config),
+                                          std::move(handler));
+  if (transport_ == nullptr) {
     return false;
   }
 
+  CandidateBatcher::Handler batcher_handler;
+  batcher_handler.send_description = [weak](const std::string& streamId,
+                                            const std::string& type,
+                                            const std::string& sdp) {
+    if (auto self = weak.lock()) {
+      self->doSendDescription(streamId, type, sdp);
+    }
+  };
+  batcher_handler.send_candidate = [weak](const std::string& streamId,
+                                          const IceCandidate& candidate) {
+    if (auto self = weak.lock()) {
+      self->doLocalCandidate(streamId, candidate);
+    }
+  };
+  candidate_batcher_ = CandidateBatcher::Create(
+      strand_, config_.candidate_batch_ms, std::move(batcher_handler));
   return true;
 }
+
 /*
-Releases Sora.
+Releases Sora. The streams are only touched on the strand, so the teardown is
+posted there and this waits for it.
 */
 void SoraSignaling::release() {
-  if (config_.role == SoraSignalingConfig::Role::Sendonly) {
-    /*auto connection = std::move(connection_[publishstreamId]);
-    connection = nullptr;*/
-    connection_.clear();
-    datachannels.clear();
-  } else if (config_.multistream == true &&
-             config_.role == SoraSignalingConfig::Role::Sendrecv) {
-    connection_.clear();
-    datachannels.clear();
-  } else if (config_.role == SoraSignalingConfig::Role::Recvonly) {
-    /*auto connection = std::move(connection_[playonlystreamId]);
-    connection = nullptr;*/
-    connection_.clear();
-    datachannels.clear();
+  std::promise<void> released;
+  boost::asio::post(strand_, [this, &released]() {
+    doRelease();
+    released.set_value();
+  });
+  // run() returns once it is out of work, and then nobody runs the teardown.
+  if (ioc_.stopped()) {
+    ioc_.restart();
+    ioc_.poll();
   }
+  released.get_future().wait();
+}
+
+void SoraSignaling::doRelease() {
+  close();
+  std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>());
+  streams_.clear();
 }
 /*
 Connects to the websocket that you defined in Unity.
 */
 bool SoraSignaling::connect() {
   RTC_LOG(LS_INFO) << __FUNCTION__;
-
-  if (connected_) {
-    return false;
-  }
-
-  std::string port = "5443";
-  if (!parts_.port.empty()) {
-    port = parts_.port;
+  return transport_->Connect();
+}
+
+void SoraSignaling::onConnected(bool resumed, int attempts) {
+  if (resumed) {
+    RTC_LOG(LS_INFO) << "Signaling Websocket is reconnected: attempts="
+                     << attempts;
+    notify({
+        {"command", "notification"},
+        {"definition", "signalingReconnected"},
+        {"attempts", attempts},
+    });
+    doResume();
+  } else {
+    doSendConnect();
   }
-
-  RTC_LOG(LS_INFO) << "Start to resolve DNS: host=" << parts_.host
-                   << " port=" << port;
-
-  // DNS 
-  resolver_.async_resolve(parts_.host, port,
-                          boost::beast::bind_front_handler(
-                              &SoraSignaling::onResolve, shared_from_this()));
-
-  return true;
+  startKeepalive();
 }
 
-void SoraSignaling::onResolve(
-    boost::system::error_code ec,
-    boost::asio::ip::tcp::resolver::results_type results) {
-  RTC_LOG(LS_INFO) << __FUNCTION__;
-
-  if (ec) {
-    RTC_LOG(LS_ERROR) << "Failed to resolve DNS: " << ec;
-    return;
+/*
+The transport lost the websocket and waits before connecting again.
+PeerConnections are kept; see doResume.
+*/
+void SoraSignaling::onReconnecting(int attempt, int delay_ms) {
+  keepalive_timer_.cancel();
+  room_refresh_timer_.cancel();
+  notify({
+      {"command", "notification"},
+      {"definition", "signalingReconnecting"},
+      {"attempt", attempt},
+      {"delayMs", delay_ms},
+  });
+}
+
+void SoraSignaling::onClosed(int attempts) {
+  keepalive_timer_.cancel();
+  room_refresh_timer_.cancel();
+  notify({
+      {"command", "notification"},
+      {"definition", "signalingClosed"},
+      {"attempts", attempts},
+  });
+}
+
+bool SoraSignaling::isStreamAlive(const std::string& streamId) const {
+  auto it = streams_.find(streamId);
+  if (it == streams_.end() || it->second.state != StreamState::Connected) {
+    return false;
   }
-
-  // DNS 
-  boost::asio::async_connect(
-      wss_->next_layer().next_layer(), results.begin(), results.end(),
-      std::bind(&SoraSignaling::onSSLConnect, shared_from_this(),
-                std::placeholders::_1));
+  // ICE may have dropped since; the state change is still on its way.
+  auto state = it->second.connection->getIceState();
+  return state == webrtc::PeerConnectionInterface::kIceConnectionConnected ||
+         state == webrtc::PeerConnectionInterface::kIceConnectionCompleted;
 }
 
-void SoraSignaling::onSSLConnect(boost::system::error_code ec) {
-  RTC_LOG(LS_INFO) << __FUNCTION__;
-
-  if (ec) {
-    RTC_LOG(LS_ERROR) << "Failed to connect: " << ec;
-    return;
+/*
+Re-issues the commands of the session after a reconnect. Streams whose
+PeerConnection is still connected are left alone; the others are torn down and
+requested again.
+*/
+void SoraSignaling::doResume() {
+  std::vector<std::string> dead;
+  for (const auto& it : streams_) {
+    if (!isStreamAlive(it.first)) {
+      dead.push_back(it.first);
+    }
   }
-
-  // SSL
-  wss_->next_layer().async_handshake(
-      boost::asio::ssl::stream_base::client,
-      boost::beast::bind_front_handler(&SoraSignaling::onSSLHandshake,
-                                       shared_from_this()));
-}
-
-void SoraSignaling::onSSLHandshake(boost::system::error_code ec) {
-  RTC_LOG(LS_INFO) << __FUNCTION__;
-
-  if (ec) {
-    RTC_LOG(LS_ERROR) << "Failed SSL handshake: " << ec;
-    return;
+  /*
+  Torn down streams also leave the membership, so that joinedTheRoom reports
+  the ones still in the room as added and plays them again, while the diff for
+  the other members stays accurate across the reconnect.
+  */
+  RoomState::Diff diff;
+  for (const auto& streamId : dead) {
+    closeStream(streamId);
+    if (room_.Remove(streamId)) {
+      diff.removed.push_back(streamId);
+    }
   }
-
-  // Websocket 
-  wss_->async_handshake(parts_.host, parts_.path_query_fragment,
-                        boost::beast::bind_front_handler(
-                            &SoraSignaling::onHandshake, shared_from_this()));
-}
-
-void SoraSignaling::onHandshake(boost::system::error_code ec) {
-  RTC_LOG(LS_INFO) << __FUNCTION__;
-
-  if (ec) {
-    RTC_LOG(LS_ERROR) << "Failed Websocket handshake: " << ec;
-    return;
+  if (!diff.empty()) {
+    notifyRoomDiff(diff);
+  }
+  // Only the candidates gathered while the websocket was down; the earlier
+  // ones of a kept stream already did their job, as it is connected.
+  for (auto& it : streams_) {
+    for (const auto& c : it.second.unsent_candidates) {
+      doSendCandidate(it.first, c.sdp_mid, c.sdp_mlineindex, c.sdp);
+    }
+    std::vector<IceCandidate>().swap(it.second.unsent_candidates);
   }
 
-  connected_ = true;
-  RTC_LOG(LS_INFO) << "Signaling Websocket is connected";
-
-  doRead();
-  doSendConnect();
+  if (config_.multistream == true &&
+      config_.role == SoraSignalingConfig::Role::Sendrecv) {
+    // joinedTheRoom publishes only if needed and plays the missing streams.
+    doSendJoinRoom(config_.channel_id);
+  } else if (config_.role == SoraSignalingConfig::Role::Sendonly) {
+    if (!isStreamAlive(config_.channel_id)) {
+      doSendPublish(config_.channel_id);
+    }
+  } else if (config_.role == SoraSignalingConfig::Role::Recvonly) {
+    if (!isStreamAlive(config_.channel_id)) {
+      doSendPlay(config_.channel_id);
+    }
+  }
 }
 
 #define SORA_CLIENT \
@@ -247,183 +362,403 @@ void SoraSignaling::doSendConnect() {
     doSendPlay(config_.channel_id);
 }
 
+/*
+Outbound commands are built by signaling_writer directly into a slot of the
+write queue. These run on the io_context thread.
+*/
 void SoraSignaling::doSendJoinRoom(std::string str) {
-  json json_message = {
-      {"command", "joinRoom"},
-      {"room", str}
-  };
-  sendText(json_message.dump());
+  if (std::string* out = beginMessage()) {
+    signaling_writer::JoinRoom(out, str);
+    endMessage(out);
+  }
 }
 
 void SoraSignaling::doSendPublish(std::string str) {
-  json json_message = {
-      {"command", "publish"},
-      {"streamId", str},
-      {"video", config_.audio_only==true?false:true},
-  };
-  sendText(json_message.dump());
+  if (std::string* out = beginMessage()) {
+    signaling_writer::Publish(out, str, !config_.audio_only);
+    endMessage(out);
+  }
 }
 void SoraSignaling::doSendPlay(std::string str) {
-  json json_message = {
-      {"command", "play"},
-      {"streamId", str},
-  };
-  sendText(json_message.dump());
+  if (std::string* out = beginMessage()) {
+    signaling_writer::Play(out, str);
+    endMessage(out);
+  }
 }
 void SoraSignaling::doSendPong() {
-  json json_message = {{"command", "ping"}};
-  sendText(json_message.dump());
+  if (std::string* out = beginMessage()) {
+    signaling_writer::Ping(out);
+    endMessage(out);
+  }
 }
 void SoraSignaling::doSendGetRoomInfo(std::string roomId, std::string str) {
-  json json_message = {
-      {"command", "getRoomInfo"},
-      {"room", roomId},
-      {"streamId", str},
-  };
-  sendText(json_message.dump());
+  if (std::string* out = beginMessage()) {
+    signaling_writer::GetRoomInfo(out, roomId, str);
+    endMessage(out);
+  }
 }
-                     
+
 /*
-Creates peer connection and sets streamid.
+Plays the streams that joined the room and tears down the ones that left, then
+reports the change to Unity as a single notification.
 */
-void SoraSignaling::createPeerFromConfig(std::string streamId) {
-  webrtc::PeerConnectionInterface::RTCConfiguration rtc_config;
-  webrtc::PeerConnectionInterface::IceServers ice_servers;
-
-  webrtc::PeerConnectionInterface::IceServer ice_server;
-  ice_server.uri = "stun:stun1.l.google.com:19302";
-  ice_servers.push_back(ice_server);
+void SoraSignaling::applyRoomDiff(const RoomState::Diff& diff) {
+  if (diff.empty()) {
+    return;
+  }
+  for (const auto& stream : diff.added) {
+    if (stream != publishstreamId && streams_.find(stream) == streams_.end()) {
+      doSendPlay(stream);
+    }
+  }
+  for (const auto& stream : diff.removed) {
+    if (stream != publishstreamId) {
+      closeStream(stream);
+    }
+  }
+  notifyRoomDiff(diff);
+}
 
-  rtc_config.servers = ice_servers;
-  playOnly = config_.role == SoraSignalingConfig::Role::Recvonly;
-  if (!publishstreamId.empty())
-    playOnly = true;
-  connection_[streamId] = manager_->createConnection(rtc_config, this,streamId,config_.audio_only,playOnly);
-  connection_[streamId]->setStreamId(streamId);
+/*
+"added" and "removed" are relative to the previous roomMembershipChanged;
+"streams" is the whole membership, so the latest notification is enough when
+a burst of them is merged.
+*/
+void SoraSignaling::notifyRoomDiff(const RoomState::Diff& diff) {
+  notify({
+      {"command", "notification"},
+      {"definition", "roomMembershipChanged"},
+      {"room", config_.channel_id},
+      {"streamId", config_.channel_id},
+      {"added", diff.added},
+      {"removed", diff.removed},
+      {"streams", room_.Members()},
+  });
+}
+
+void SoraSignaling::notifyStreamState(const std::string& streamId,
+                                      const char* state) {
+  notify({
+      {"command", "notification"},
+      {"definition", "streamStateChanged"},
+      {"streamId", streamId},
+      {"state", state},
+  });
 }
 
-void SoraSignaling::close() {
-  wss_->async_close(boost::beast::websocket::close_code::normal,
-                    boost::beast::bind_front_handler(&SoraSignaling::onClose,
-                                                     shared_from_this()));
+/*
+Passes a notification built here to Unity. Only the notifications listed in
+kStateNotifications and kIdempotentNotifications get a coalesce key, so that
+the others are never merged.
+*/
+void SoraSignaling::notify(const json& message) {
+  if (!on_notify_) {
+    return;
+  }
+  std::string coalesce_key;
+  auto definition = message.find("definition");
+  if (definition != message.end() && definition->is_string()) {
+    const std::string& name = definition->get_ref<const std::string&>();
+    for (const char* state : kStateNotifications) {
+      if (name == state) {
+        // They all describe the one signaling connection, so the latest wins.
+        coalesce_key = "signalingState";
+        break;
+      }
+    }
+    for (const char* idempotent : kIdempotentNotifications) {
+      if (name == idempotent) {
+        coalesce_key = name + '\n' + message.value("streamId", "");
+        break;
+      }
+    }
+  }
+  on_notify_(message.dump(), std::move(coalesce_key));
 }
 
-void SoraSignaling::onClose(boost::system::error_code ec) {
-  if (ec) {
-    RTC_LOG(LS_ERROR) << "Failed to close: ec=" << ec;
+void SoraSignaling::closeStream(const std::string& streamId) {
+  auto it = streams_.find(streamId);
+  if (it == streams_.end()) {
     return;
   }
+  if (it->second.datachannel) {
+    it->second.datachannel->UnregisterObserver();
+  }
+  candidate_batcher_->Remove(streamId);
+  // Other threads may still hold the connection through the old snapshot, so
+  // it is destroyed when the last of them lets go.
+  streams_.erase(it);
+  // A later start or offer for the same id creates the stream anew.
+  if (streamId == publishstreamId) {
+    publishstreamId.clear();
+  }
+  if (streamId == playonlystreamId) {
+    playonlystreamId.clear();
+  }
+  publishSnapshot();
+  notifyStreamState(streamId, "closed");
+}
+
+/*
+Keepalive scheduler. Sends ping and, for conferences, getRoomInfo on timers of
+the signaling io_context, independently of whether Unity polls GetStats.
+*/
+void SoraSignaling::setKeepalive(int keepalive_interval_ms,
+                                 int room_refresh_interval_ms) {
+  auto self = shared_from_this();
+  boost::asio::post(strand_, [self, keepalive_interval_ms,
+                           room_refresh_interval_ms]() {
+    self->config_.keepalive_interval_ms = keepalive_interval_ms;
+    self->config_.room_refresh_interval_ms = room_refresh_interval_ms;
+    if (self->transport_->IsConnected()) {
+      self->startKeepalive();
+    }
+  });
 }
 
-void SoraSignaling::doRead() {
-  wss_->async_read(read_buffer_,
-                   boost::beast::bind_front_handler(&SoraSignaling::onRead,
-                                                    shared_from_this()));
+void SoraSignaling::startKeepalive() {
+  keepalive_backoff_ = 1;
+  room_refresh_backoff_ = 1;
+  pong_pending_ = false;
+  missed_pongs_ = 0;
+  scheduleKeepalive();
+  scheduleRoomRefresh();
 }
 
-void SoraSignaling::onRead(boost::system::error_code ec,
-                           std::size_t bytes_transferred) {
-  boost::ignore_unused(bytes_transferred);
+void SoraSignaling::scheduleKeepalive() {
+  keepalive_timer_.cancel();
+  if (config_.keepalive_interval_ms <= 0) {
+    return;
+  }
+  keepalive_timer_.expires_after(
+      withJitter(config_.keepalive_interval_ms * keepalive_backoff_));
+  keepalive_timer_.async_wait(boost::beast::bind_front_handler(
+      &SoraSignaling::onKeepalive, shared_from_this()));
+}
 
+void SoraSignaling::onKeepalive(boost::system::error_code ec) {
   if (ec == boost::asio::error::operation_aborted) {
     return;
   }
+  // No pong for the previous ping: back off instead of piling up pings
+  // on a stalled connection. A half-open connection (e.g. dropped by a load
+  // balancer) never fails a read or write, so give up on it after a few.
+  if (pong_pending_) {
+    if (++missed_pongs_ >= config_.keepalive_max_missed) {
+      transport_->Reconnect("Keepalive timeout", boost::asio::error::timed_out);
+      return;
+    }
+    keepalive_backoff_ = std::min(keepalive_backoff_ * 2, config_.max_backoff);
+  }
+  pong_pending_ = true;
+  doSendPong();
+  scheduleKeepalive();
+}
 
-  if (ec) {
-    RTC_LOG(LS_ERROR) << "Failed to read: ec=" << ec;
+void SoraSignaling::scheduleRoomRefresh() {
+  room_refresh_timer_.cancel();
+  if (config_.room_refresh_interval_ms <= 0 ||
+      config_.role != SoraSignalingConfig::Role::Sendrecv) {
     return;
   }
+  room_refresh_timer_.expires_after(
+      withJitter(config_.room_refresh_interval_ms * room_refresh_backoff_));
+  room_refresh_timer_.async_wait(boost::beast::bind_front_handler(
+      &SoraSignaling::onRoomRefresh, shared_from_this()));
+}
 
-  const auto text = boost::beast::buffers_to_string(read_buffer_.data());
-  read_buffer_.consume(read_buffer_.size());
+void SoraSignaling::onRoomRefresh(boost::system::error_code ec) {
+  if (ec == boost::asio::error::operation_aborted) {
+    return;
+  }
+  // getRoomInfo needs the publish stream id, so wait until publishing started.
+  if (!publishstreamId.empty()) {
+    doSendGetRoomInfo(config_.channel_id, publishstreamId);
+  }
+  scheduleRoomRefresh();
+}
+
+std::chrono::milliseconds SoraSignaling::withJitter(int interval_ms) {
+  int jitter = interval_ms / 10;
+  std::uniform_int_distribution<int> dist(-jitter, jitter);
+  return std::chrono::milliseconds(interval_ms + dist(jitter_rng_));
+}
+                     
+/*
+Creates peer connection and sets streamid. Whether it sends is decided by the
+command that created it (start publishes, an offer plays), not by which
+streams exist already.
+*/
+void SoraSignaling::createPeerFromConfig(std::string streamId, bool playOnly) {
+  webrtc::PeerConnectionInterface::RTCConfiguration rtc_config;
+  webrtc::PeerConnectionInterface::IceServers ice_servers;
 
-  RTC_LOG(LS_INFO) << __FUNCTION__ << ": text=" << text;
+  webrtc::PeerConnectionInterface::IceServer ice_server;
+  ice_server.uri = "stun:stun1.l.google.com:19302";
+  ice_servers.push_back(ice_server);
+
+  rtc_config.servers = ice_servers;
+  // A new offer for a known stream replaces its PeerConnection.
+  Stream& stream = streams_[streamId];
+  if (stream.datachannel) {
+    stream.datachannel->UnregisterObserver();
+  }
+  stream = Stream();
+  stream.connection = manager_->createConnection(rtc_config, this,streamId,config_.audio_only,playOnly);
+  stream.connection->setStreamId(streamId);
+  publishSnapshot();
+}
+
+void SoraSignaling::close() {
+  keepalive_timer_.cancel();
+  room_refresh_timer_.cancel();
+  candidate_batcher_->Clear();
+  transport_->Close();
+}
+
+/*
+Handles one message from the server. The data is only valid during the call,
+so it is parsed in place into read_message_.
+*/
+void SoraSignaling::onSignalingMessage(const char* data, size_t size) {
+  if (rtc::LogMessage::Loggable(rtc::LS_INFO)) {
+    RTC_LOG(LS_INFO) << __FUNCTION__ << ": text=" << std::string(data, size);
+  }
   /*
   Parsing the incoming websocket message and function according to message. If it is start, start publishing etc.
   */
-  auto json_message = json::parse(text);
-  const std::string command = json_message["command"];
+  SignalingMessage& message = read_message_;
+  if (!ParseSignalingMessage(data, size, &message)) {
+    RTC_LOG(LS_ERROR) << "Failed to parse signaling message";
+    return;
+  }
+  const std::string& streamId = message.stream_id;
+  auto findStream = [this](const std::string& id) -> Stream* {
+    auto it = streams_.find(id);
+    if (it == streams_.end()) {
+      RTC_LOG(LS_WARNING) << "No connection for stream: " << id;
+      return nullptr;
+    }
+    return &it->second;
+  };
   //Here is the where signaling handled
-  //Start is for starting the publishing, creates peerconnection and sends offer. See observer.h and observer.cpp for callbacks in here for offer and answers. Also creates DataChannel.
-  if (command == "start") {
-    offer_sent_ = false;
-    createPeerFromConfig(json_message["streamId"]);
-    datachannels[json_message["streamId"]] =connection_[json_message["streamId"]]->createDataChannel(json_message["streamId"]);
-    datachannels[json_message["streamId"]]->RegisterObserver(new DataChannelObserver(connection_[json_message["streamId"]]->getMessageSender(),json_message["streamId"]));
-    connection_[json_message["streamId"]]->createOffer(json_message["streamId"],playOnly);
-    offer_sent_ = true;
-    publishstreamId = json_message["streamId"];
-    connection_[publishstreamId]->setStreamId(publishstreamId);
-  } else if (command == "takeConfiguration") {  // If playing, it will set remote offer and create answer. If publishing, it will set answer and that is all.
-    if (json_message["type"] == "answer")
-      connection_[json_message["streamId"]]->setAnswer(json_message["sdp"]);
-    else if (json_message["type"] == "offer") {
-      createPeerFromConfig(json_message["streamId"]);
+  switch (message.command) {
+    //Start is for starting the publishing, creates peerconnection and sends offer. See observer.h and observer.cpp for callbacks in here for offer and answers. Also creates DataChannel.
+    case SignalingMessage::Command::Start: {
       offer_sent_ = false;
-      connection_[json_message["streamId"]]->setOffer(json_message["sdp"]);
-      connection_[json_message["streamId"]]->createAnswer(json_message["streamId"]);
-      playonlystreamId = json_message["streamId"];
-    }
-  } else if (command == "takeCandidate") { //Adds remote ice candidates to the peerconnection.
-    ///*if (on_notify_) {
-      //on_notify_(text);
-    doSendPong();
-    connection_[json_message["streamId"]]->addIceCandidate(
-        json_message["id"], json_message["label"],
-                                 json_message["candidate"]);
-  }
-  else if (command == "pong"){ //If pong message is arrived, try to read websocket again, if you are here without any incoming message, application may hang.
-          if (rtc_state_ != webrtc::PeerConnectionInterface::IceConnectionState::
-                          kIceConnectionConnected) {
-      doRead();
-      return;
+      createPeerFromConfig(streamId, false);
+      Stream& stream = streams_[streamId];
+      auto connection = stream.connection;
+      stream.datachannel = connection->createDataChannel(streamId);
+      stream.datachannel->RegisterObserver(new DataChannelObserver(
+          connection->getMessageSender(), streamId));
+      stream.state = StreamState::Offering;
+      connection->createOffer(streamId, false);
+      offer_sent_ = true;
+      publishstreamId = streamId;
+      connection->setStreamId(publishstreamId);
+      publishSnapshot();
+      notifyStreamState(streamId, "offering");
+      break;
     }
-
-  } else if (command == "notification") {
-    if (json_message["definition"] == "joinedTheRoom") {    // When joined to the room, it gets the streams from the room with 'streams' then plays them one by one. 
-      doSendPublish(json_message["streamId"]);              //Also starting publishing the stream according to taken streamid from the server
-      for (auto stream : json_message["streams"]) {
-        doSendPlay(stream);
-        playStreamIds.push_back(stream);
+    // If playing, it will set remote offer and create answer. If publishing, it will set answer and that is all.
+    case SignalingMessage::Command::TakeConfiguration:
+      if (message.type == "answer") {
+        if (Stream* stream = findStream(streamId)) {
+          stream->connection->setAnswer(message.sdp);
         }
-    } else if (json_message["definition"] == "play_finished") {
-      if (datachannels[json_message["streamId"]]) {
-        datachannels[json_message["streamId"]]->UnregisterObserver();
+      } else if (message.type == "offer") {
+        createPeerFromConfig(streamId, true);
+        offer_sent_ = false;
+        Stream& stream = streams_[streamId];
+        stream.state = StreamState::Offering;
+        stream.connection->setOffer(message.sdp);
+        stream.connection->createAnswer(streamId);
+        playonlystreamId = streamId;
+        publishSnapshot();
+        notifyStreamState(streamId, "offering");
       }
-      connection_.erase(json_message["streamId"]);
-      datachannels.erase(json_message["streamId"]);
-      RTC_LOG(LS_ERROR) << "__FUNCTION__"
-                        << "PLAY_FINISHED: "
-                        << "stream "<<json_message["streamId"]<<"has been removed from the stream list";
-    } else if (json_message["definition"] == "bitrateMeasurement") {
+      break;
+    //Adds remote ice candidates to the peerconnection.
+    case SignalingMessage::Command::TakeCandidate:
       doSendPong();
-    }
-  
-  } else if (command == "roomInformation") {
-    playStreamIds.clear();
-    for (auto stream : json_message["streams"]) {
-      if (connection_.find(stream) == connection_.end())
-        doSendPlay(stream);
-      playStreamIds.push_back(stream);
-    }
-  } else if(command=="error"){
-    if (json_message["defition"] == "publishTimeoutError") {
-      RTC_LOG(LS_ERROR) << "__FUNCTION__"
-                        << "PUBLISH_TIMEOUT_ERROR: "
-                        << "Publish stream is resetted";
-      if (datachannels[publishstreamId]) {
-        datachannels[publishstreamId]->UnregisterObserver();
-        datachannels.erase(publishstreamId);
+      if (Stream* stream = findStream(streamId)) {
+        stream->connection->addIceCandidate(message.id, message.label,
+                                            message.candidate);
       }
-      connection_.erase(publishstreamId);
-    } else if (json_message["defition"] == "no_stream_exist") {
-      RTC_LOG(LS_INFO) << "__FUNCTION__"
-                        << "no_stream_exist: "
-                        << "No stream has found with according stream id";
-
+      break;
+    //If pong message is arrived, try to read websocket again, if you are here without any incoming message, application may hang.
+    case SignalingMessage::Command::Pong:
+      pong_pending_ = false;
+      missed_pongs_ = 0;
+      keepalive_backoff_ = 1;
+      break;
+    case SignalingMessage::Command::Notification:
+      switch (message.definition) {
+        // When joined to the room, it gets the streams from the room with 'streams' then plays them one by one.
+        // Also starting publishing the stream according to taken streamid from the server
+        case SignalingMessage::Definition::JoinedTheRoom: {
+          if (!isStreamAlive(publishstreamId))
+            doSendPublish(streamId);
+          // Diffed against the membership from before a reconnect, so only
+          // real changes are reported; see doResume.
+          RoomState::Diff diff;
+          room_.Update(std::move(message.streams), &diff);
+          applyRoomDiff(diff);
+          break;
+        }
+        case SignalingMessage::Definition::PlayFinished:
+          closeStream(streamId);
+          // Drop it from the membership too, so that it is played again if the
+          // next roomInformation still lists it.
+          if (room_.Remove(streamId)) {
+            RoomState::Diff diff;
+            diff.removed.push_back(streamId);
+            notifyRoomDiff(diff);
+          }
+          room_refresh_backoff_ = 1;
+          RTC_LOG(LS_ERROR) << "__FUNCTION__"
+                            << "PLAY_FINISHED: "
+                            << "stream " << streamId
+                            << "has been removed from the stream list";
+          break;
+        case SignalingMessage::Definition::BitrateMeasurement:
+          doSendPong();
+          break;
+        default:
+          break;
+      }
+      break;
+    case SignalingMessage::Command::RoomInformation: {
+      RoomState::Diff diff;
+      room_.Update(std::move(message.streams), &diff);
+      applyRoomDiff(diff);
+      // Poll less often while the room is quiet.
+      if (diff.empty()) {
+        room_refresh_backoff_ =
+            std::min(room_refresh_backoff_ * 2, config_.max_backoff);
+      } else {
+        room_refresh_backoff_ = 1;
+      }
+      break;
     }
+    case SignalingMessage::Command::Error:
+      if (message.definition ==
+          SignalingMessage::Definition::PublishTimeoutError) {
+        RTC_LOG(LS_ERROR) << "__FUNCTION__"
+                          << "PUBLISH_TIMEOUT_ERROR: "
+                          << "Publish stream is resetted";
+        closeStream(publishstreamId);
+      } else if (message.definition ==
+                 SignalingMessage::Definition::NoStreamExist) {
+        RTC_LOG(LS_INFO) << "__FUNCTION__"
+                         << "no_stream_exist: "
+                         << "No stream has found with according stream id";
+      }
+      break;
+    default:
+      break;
   }
-  doRead();
 }
 /*
 Sends websocket message.
@@ -431,78 +766,69 @@ Sends websocket message.
 void SoraSignaling::sendText(std::string text) {
   RTC_LOG(LS_INFO) << __FUNCTION__;
 
-  boost::asio::post(boost::beast::bind_front_handler(
+  boost::asio::post(strand_, boost::beast::bind_front_handler(
       &SoraSignaling::doSendText, shared_from_this(), std::move(text)));
 }
 
 void SoraSignaling::doSendText(std::string text) {
-  RTC_LOG(LS_INFO) << __FUNCTION__ << ": " << text;
-
-  bool empty = write_buffer_.empty();
-  boost::beast::flat_buffer buffer;
-
-  const auto n = boost::asio::buffer_copy(buffer.prepare(text.size()),
-                                          boost::asio::buffer(text));
-  buffer.commit(n);
-
-  write_buffer_.push_back(std::move(buffer));
-
-  if (empty) {
-    doWrite();
+  // The string is swapped into the queue and written from there, no copy.
+  if (std::string* out = beginMessage()) {
+    out->swap(text);
+    endMessage(out);
   }
 }
 
-void SoraSignaling::doWrite() {
-  RTC_LOG(LS_INFO) << __FUNCTION__;
-
-  auto& buffer = write_buffer_.front();
-
-  wss_->text(true);
-  wss_->async_write(buffer.data(),
-                    boost::beast::bind_front_handler(&SoraSignaling::onWrite,
-                                                     shared_from_this()));
+/*
+Messages are built straight into a slot of the transport's write queue.
+While reconnecting there is no slot and the message is dropped; doResume
+re-issues what is needed.
+*/
+std::string* SoraSignaling::beginMessage() {
+  return transport_->BeginMessage();
 }
 
-void SoraSignaling::onWrite(boost::system::error_code ec,
-                            std::size_t bytes_transferred) {
-  RTC_LOG(LS_INFO) << __FUNCTION__;
-
-  if (ec == boost::asio::error::operation_aborted) {
-    return;
-  }
-
-  if (ec) {
-    RTC_LOG(LS_ERROR) << "Failed to write: ec=" << ec;
-    return;
-  }
-
-  write_buffer_.erase(write_buffer_.begin());
-
-  if (!write_buffer_.empty()) {
-    doWrite();
-  }
+void SoraSignaling::endMessage(std::string* text) {
+  transport_->EndMessage(text);
 }
 
 /*
 Functions at below are handled at observer.cpp.
 */
 void SoraSignaling::onIceConnectionStateChange(
+    const std::string streamId,
     webrtc::PeerConnectionInterface::IceConnectionState new_state) {
-  RTC_LOG(LS_INFO) << __FUNCTION__ << " state:" << new_state;
-  boost::asio::post(boost::beast::bind_front_handler(
+  RTC_LOG(LS_INFO) << __FUNCTION__ << " streamId:" << streamId
+                   << " state:" << new_state;
+  boost::asio::post(strand_, boost::beast::bind_front_handler(
       &SoraSignaling::doIceConnectionStateChange, shared_from_this(),
-      new_state));
+      streamId, new_state));
 }
-void SoraSignaling::onIceCandidate(const std::string sdp_mid,
+void SoraSignaling::onIceCandidate(const std::string streamId,
+                                   const std::string sdp_mid,
                                    const int sdp_mlineindex,
                                    const std::string sdp) {
   RTC_LOG(LS_INFO) << "__FUNCTION__"
                    << "Candidates are being added.";
+  boost::asio::post(strand_, boost::beast::bind_front_handler(
+                              &SoraSignaling::doIceCandidate,
+                              shared_from_this(), streamId, sdp_mid,
+                              sdp_mlineindex, sdp));
 }
-void SoraSignaling::onCreateDescription(webrtc::SdpType type,
+void SoraSignaling::onCreateDescription(const std::string streamId,
+                                        webrtc::SdpType type,
                                         const std::string sdp) {
- 
-RTC_LOG(LS_INFO) << __FUNCTION__ << " " << webrtc::SdpTypeToString(type);
+  RTC_LOG(LS_INFO) << __FUNCTION__ << " streamId:" << streamId << " "
+                   << webrtc::SdpTypeToString(type);
+  boost::asio::post(strand_, boost::beast::bind_front_handler(
+                                 &SoraSignaling::doCreateDescription,
+                                 shared_from_this(), streamId, type, sdp));
+}
+void SoraSignaling::onIceGatheringComplete(const std::string streamId,
+                                           const std::string sdp) {
+  RTC_LOG(LS_INFO) << __FUNCTION__ << " streamId:" << streamId;
+  boost::asio::post(strand_, boost::beast::bind_front_handler(
+                                 &SoraSignaling::doIceGatheringComplete,
+                                 shared_from_this(), streamId, sdp));
 }
 void SoraSignaling::onSetDescription(webrtc::SdpType type) {
   RTC_LOG(LS_INFO) << __FUNCTION__
@@ -510,40 +836,155 @@ void SoraSignaling::onSetDescription(webrtc::SdpType type) {
 }
 
 void SoraSignaling::doIceConnectionStateChange(
+    std::string streamId,
     webrtc::PeerConnectionInterface::IceConnectionState new_state) {
-  RTC_LOG(LS_INFO) << __FUNCTION__
-                   << ": oldState=" << iceConnectionStateToString(rtc_state_)
+  RTC_LOG(LS_INFO) << __FUNCTION__ << ": streamId=" << streamId
+                   << ", oldState="
+                   << iceConnectionStateToString(rtc_state_.load())
                    << ", newState=" << iceConnectionStateToString(new_state);
 
-  switch (new_state) {
-    case webrtc::PeerConnectionInterface::IceConnectionState::
-        kIceConnectionConnected:
-      break;
-    case webrtc::PeerConnectionInterface::IceConnectionState::
-        kIceConnectionFailed:
-      break;
-    default:
-      break;
+  // Stream state machine: Offering -> Connected once ICE connects. A closed
+  // stream is already gone from streams_, so its late changes are ignored.
+  auto it = streams_.find(streamId);
+  if (it != streams_.end()) {
+    switch (new_state) {
+      case webrtc::PeerConnectionInterface::IceConnectionState::
+          kIceConnectionConnected:
+      case webrtc::PeerConnectionInterface::IceConnectionState::
+          kIceConnectionCompleted:
+        if (it->second.state != StreamState::Connected) {
+          it->second.state = StreamState::Connected;
+          std::vector<IceCandidate>().swap(it->second.unsent_candidates);
+          notifyStreamState(streamId, "connected");
+        }
+        break;
+      case webrtc::PeerConnectionInterface::IceConnectionState::
+          kIceConnectionFailed:
+        RTC_LOG(LS_ERROR) << "ICE failed: streamId=" << streamId;
+        break;
+      default:
+        break;
+    }
   }
   rtc_state_ = new_state;
 }
+/*
+The local description and candidates go through candidate_batcher_. With
+candidate_batch_ms, the description is held until gathering completes and then
+sent once with every candidate in it, instead of one takeCandidate per
+candidate; the signaling server takes a single candidate per takeCandidate.
+*/
+void SoraSignaling::doCreateDescription(std::string streamId,
+                                        webrtc::SdpType type,
+                                        std::string sdp) {
+  candidate_batcher_->OnDescription(
+      streamId, type == webrtc::SdpType::kAnswer ? "answer" : "offer", sdp);
+}
+
+void SoraSignaling::doIceGatheringComplete(std::string streamId,
+                                           std::string sdp) {
+  candidate_batcher_->OnGatheringComplete(streamId, sdp);
+}
+
+void SoraSignaling::doIceCandidate(std::string streamId,
+                                   std::string sdp_mid,
+                                   int sdp_mlineindex,
+                                   std::string sdp) {
+  candidate_batcher_->OnCandidate(
+      streamId, {std::move(sdp_mid), sdp_mlineindex, std::move(sdp)});
+}
+
+void SoraSignaling::doSendDescription(const std::string& streamId,
+                                      const std::string& type,
+                                      const std::string& sdp) {
+  if (std::string* out = beginMessage()) {
+    signaling_writer::TakeConfiguration(out, streamId, type, sdp);
+    endMessage(out);
+  }
+}
+
+void SoraSignaling::doLocalCandidate(const std::string& streamId,
+                                     const IceCandidate& candidate) {
+  // While the websocket is down, keep it for doResume to send. Nothing else
+  // is kept, so the list only grows for the length of an outage.
+  if (!transport_->IsConnected()) {
+    auto it = streams_.find(streamId);
+    if (it != streams_.end()) {
+      it->second.unsent_candidates.push_back(candidate);
+    }
+    return;
+  }
+  doSendCandidate(streamId, candidate.sdp_mid, candidate.sdp_mlineindex,
+                  candidate.sdp);
+}
+
+void SoraSignaling::doSendCandidate(const std::string& streamId,
+                                    const std::string& sdp_mid,
+                                    int sdp_mlineindex,
+                                    const std::string& sdp) {
+  if (std::string* out = beginMessage()) {
+    signaling_writer::TakeCandidate(out, streamId, sdp_mlineindex, sdp_mid,
+                                    sdp);
+    endMessage(out);
+    candidates_sent_++;
+  }
+}
+
+void SoraSignaling::getSignalingStats(sora_signaling_stats_t* stats) const {
+  auto transport_stats = transport_->GetStats();
+  stats->messages_sent = transport_stats.messages_sent;
+  stats->bytes_sent = transport_stats.bytes_sent;
+  stats->messages_received = transport_stats.messages_received;
+  stats->bytes_received = transport_stats.bytes_received;
+  stats->candidates_sent = candidates_sent_;
+}
+
 /*
 When remote peer opens a data channel, this callback will be executed. It creates a data channel with the incoming data channel and adds an observer to it to detect incoming messages.
 */
 void SoraSignaling::onDataChannel(
     rtc::scoped_refptr<webrtc::DataChannelInterface> data_channel,std::string streamId) {
-  datachannels[streamId] = data_channel;
-  datachannels[streamId]->RegisterObserver(
-      new DataChannelObserver(connection_[streamId]->getMessageSender(),streamId));
+  // Called on the WebRTC signaling thread; streams_ is only touched on the strand.
+  boost::asio::post(strand_, boost::beast::bind_front_handler(
+                                 &SoraSignaling::doDataChannel,
+                                 shared_from_this(), data_channel, streamId));
+}
+
+void SoraSignaling::doDataChannel(
+    rtc::scoped_refptr<webrtc::DataChannelInterface> data_channel,
+    std::string streamId) {
+  auto it = streams_.find(streamId);
+  if (it == streams_.end()) {
+    RTC_LOG(LS_WARNING) << "Data channel for unknown stream: " << streamId;
+    return;
+  }
+  Stream& stream = it->second;
+  if (stream.datachannel) {
+    stream.datachannel->UnregisterObserver();
+  }
+  stream.datachannel = data_channel;
+  stream.datachannel->RegisterObserver(new DataChannelObserver(
+      stream.connection->getMessageSender(), streamId));
+  publishSnapshot();
 }
 
 /*
 Sends Data channel message. You can also send binary data and not only string but you may need to modify the way it binds with unity application.
 */
 void sora::SoraSignaling::sendDataMessage(std::string streamId,std::string text) {
-  if (datachannels[streamId]) {
+  // Called from the Unity thread, so look the channel up in the snapshot.
+  // DataChannelInterface::Send itself is thread safe.
+  auto snapshot = std::atomic_load(&snapshot_);
+  rtc::scoped_refptr<webrtc::DataChannelInterface> datachannel;
+  if (snapshot != nullptr) {
+    auto it = snapshot->datachannels.find(streamId);
+    if (it != snapshot->datachannels.end()) {
+      datachannel = it->second;
+    }
+  }
+  if (datachannel) {
     webrtc::DataBuffer buffer(text);
-    datachannels[streamId]->Send(buffer);
+    datachannel->Send(buffer);
   } else {
     RTC_LOG(LS_INFO) << __FUNCTION__;
     RTC_LOG(LS_ERROR)<< "Datachannel is not ready to send a message";
@@ -557,7 +998,8 @@ void sora::SoraSignaling::onMessage(const webrtc::DataBuffer& buffer,
     
   //rtc::CopyOnWriteBuffer buf = buffer.data;
   //char* c = buf.data<char>();
-    on_notify_(std::string(buffer.data.data<char>()));
+    // Application messages are never merged, so no coalesce key.
+    on_notify_(std::string(buffer.data.data<char>()), std::string());
   RTC_LOG(LS_INFO) << std::string(buffer.data.data<char>());
 }
 
@@ -2,24 +2,26 @@
 #define SORA_SORA_SIGNALING_H_
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
 #include <functional>
 #include <memory>
+#include <random>
 #include <string>
 
 #include <boost/asio/io_context.hpp>
-#include <boost/asio/ip/tcp.hpp>
-#include <boost/asio/ssl/context.hpp>
-#include <boost/asio/ssl/stream.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/strand.hpp>
-#include <boost/beast/core/flat_buffer.hpp>
-#include <boost/beast/core/multi_buffer.hpp>
-#include <boost/beast/websocket/ssl.hpp>
-#include <boost/beast/websocket/stream.hpp>
 #include <nlohmann/json.hpp>
 #include <unordered_map>
+#include "candidate_batcher.h"
 #include "rtc/rtc_manager.h"
 #include "rtc/rtc_message_sender.h"
+#include "room_state.h"
+#include "signaling_message.h"
+#include "signaling_transport.h"
+#include "unity.h"
 #include "url_parts.h"
 
 namespace sora {
@@ -40,55 +42,128 @@ struct SoraSignalingConfig {
   Role role = Role::Sendonly;
   bool multistream = false;
   bool audio_only = false;
+
+  // ping を送る間隔。0 なら送らない
+  int keepalive_interval_ms = 5000;
+  // Sendrecv の場合に getRoomInfo を送って参加者の一覧を更新する間隔。0 なら送らない
+  int room_refresh_interval_ms = 5000;
+  // pong が返ってこない、または参加者の一覧に変化が無い間は間隔を倍にしていき、
+  // 最大でこの倍数まで延ばす
+  int max_backoff = 8;
+  // この回数続けて pong が返ってこなければ、接続が切れたとみなして再接続する
+  int keepalive_max_missed = 3;
+
+  // Websocket が切れた場合の再接続。試行毎に待ち時間を倍にしていく。
+  // reconnect_max_attempts が 0 なら再接続しない
+  int reconnect_max_attempts = 10;
+  int reconnect_base_delay_ms = 500;
+  int reconnect_max_delay_ms = 30000;
+
+  // 0 より大きい場合、offer/answer の SDP をストリーム毎に最大この時間保留し、
+  // その間に集まった ICE 候補を SDP に含めて送る（CandidateBatcher）
+  int candidate_batch_ms = 0;
 };
 
 class SoraSignaling : public std::enable_shared_from_this<SoraSignaling>,
                       public RTCMessageSender {
+ public:
+  // 通知する JSON と、まとめても良い状態の通知であればそのキー（それ以外は空文字列）
+  typedef std::function<void(std::string json, std::string coalesce_key)>
+      notify_callback_t;
+
+ private:
   boost::asio::io_context& ioc_;
+  // シグナリングの状態はこの strand 上でのみ変更する。
+  // 他のスレッドからの呼び出しは strand に post し、読み出しは snapshot_ を使う
+  boost::asio::strand<boost::asio::io_context::executor_type> strand_;
 
-  boost::asio::ip::tcp::resolver resolver_;
+  // Websocket の接続と再接続、送受信。コールバックは strand_ 上で呼ばれる
+  std::shared_ptr<SignalingTransport> transport_;
+  // 受信したメッセージはその場でパースする
+  SignalingMessage read_message_;
+  // ローカルの SDP と ICE 候補の送信
+  std::shared_ptr<CandidateBatcher> candidate_batcher_;
 
-  typedef boost::beast::websocket::stream<
-      boost::asio::ssl::stream<boost::asio::ip::tcp::socket>>
-      ssl_websocket_t;
-  std::unique_ptr<ssl_websocket_t> wss_;
-  boost::beast::multi_buffer read_buffer_;
-  std::vector<boost::beast::flat_buffer> write_buffer_;
+  // 送信した ICE 候補の数。任意のスレッドから読める
+  std::atomic<int64_t> candidates_sent_ = {0};
 
   URLParts parts_;
 
   RTCManager* manager_;
-  std::unordered_map<std::string, std::shared_ptr<RTCConnection>> connection_;
-  std::unordered_map<std::string, rtc::scoped_refptr<webrtc::DataChannelInterface>> datachannels;
+
+  // ストリーム毎の状態
+  //   Idle（PeerConnection を作った）→ Offering（offer/answer の交換中）
+  //   → Connected（ICE が繋がった）
+  // 破棄したストリームは streams_ から取り除くので、破棄中の状態は無い
+  enum class StreamState { Idle, Offering, Connected };
+  typedef CandidateBatcher::Candidate IceCandidate;
+  struct Stream {
+    StreamState state = StreamState::Idle;
+    std::shared_ptr<RTCConnection> connection;
+    rtc::scoped_refptr<webrtc::DataChannelInterface> datachannel;
+    // Websocket が切れている間に集まったローカルの ICE 候補。再接続した後に送る
+    std::vector<IceCandidate> unsent_candidates;
+  };
+  std::unordered_map<std::string, Stream> streams_;
+
+  // 他のスレッドから読むための、ある時点のストリームの一覧。
+  // 作った後は変更しないので、読む側はロック無しで使える。
+  // strand_ 上で streams_ 等を変更したら publishSnapshot() で丸ごと差し替える
+  struct Snapshot {
+    std::vector<std::shared_ptr<RTCConnection>> connections;
+    std::unordered_map<std::string,
+                       rtc::scoped_refptr<webrtc::DataChannelInterface>>
+        datachannels;
+    // getRTCConnection() で返す候補（ロールによって publish か play のストリーム）
+    std::shared_ptr<RTCConnection> primary;
+  };
+  // std::atomic_load/atomic_store でのみ触る
+  std::shared_ptr<const Snapshot> snapshot_;
+
   SoraSignalingConfig config_;
-  std::function<void(std::string)> on_notify_;
+  notify_callback_t on_notify_;
 
-  webrtc::PeerConnectionInterface::IceConnectionState rtc_state_;
+  // strand 上で更新し、getRTCConnectionState() で任意のスレッドから読む
+  std::atomic<webrtc::PeerConnectionInterface::IceConnectionState> rtc_state_ = {
+      webrtc::PeerConnectionInterface::kIceConnectionNew};
 
-  bool connected_ = false;
   bool offer_sent_ = false;
   std::string publishstreamId;
-  std::vector<std::string> playStreamIds;
+  // 部屋で再生しているストリームの一覧
+  RoomState room_;
   std::string playonlystreamId;
-  std::vector<std::string> allids;
-  bool playOnly;
+
+  // キープアライブと参加者の一覧の更新は strand 上のタイマーで行う
+  boost::asio::steady_timer keepalive_timer_;
+  boost::asio::steady_timer room_refresh_timer_;
+  int keepalive_backoff_ = 1;
+  int room_refresh_backoff_ = 1;
+  bool pong_pending_ = false;
+  int missed_pongs_ = 0;
+  std::minstd_rand jitter_rng_;
  public:
   webrtc::PeerConnectionInterface::IceConnectionState getRTCConnectionState() const;
+  // スナップショットを読むので、任意のスレッドから呼び出せる
   std::shared_ptr<RTCConnection> getRTCConnection() const;
+  std::vector<std::shared_ptr<RTCConnection>> getRTCConnections() const;
   void sendText(std::string text) override;
   void sendDataMessage(std::string streamId, std::string text) override;
   void doSendPong();
+  // 送受信したメッセージの統計情報を取得する。任意のスレッドから呼び出せる
+  void getSignalingStats(sora_signaling_stats_t* stats) const;
+  // キープアライブの間隔を変更する。任意のスレッドから呼び出せる
+  void setKeepalive(int keepalive_interval_ms, int room_refresh_interval_ms);
   static std::shared_ptr<SoraSignaling> Create(
       boost::asio::io_context& ioc,
       RTCManager* manager,
       SoraSignalingConfig config,
-      std::function<void(std::string)> on_notify);
+      notify_callback_t on_notify);
 
  private:
   SoraSignaling(boost::asio::io_context& ioc,
                 RTCManager* manager,
                 SoraSignalingConfig config,
-                std::function<void(std::string)> on_notify);
+                notify_callback_t on_notify);
   bool Init();
 
  public:
@@ -98,15 +173,10 @@ class SoraSignaling : public std::enable_shared_from_this<SoraSignaling>,
   // connection_ = nullptr すると直ちに onIceConnectionStateChange コールバックが呼ばれるが、
   // この中で使っている shared_from_this() がデストラクタ内で使えないため、デストラクタで connection_ = nullptr すると実行時エラーになる。
   // なのでこのクラスを解放する前に明示的に release() 関数を呼んでもらうことにする。.
+  // 破棄は strand 上で行い、終わるまで待つので、io_context が動いている間に呼ぶこと。
   void release();
 
  private:
-  void onResolve(boost::system::error_code ec,
-                 boost::asio::ip::tcp::resolver::results_type results);
-  void onSSLConnect(boost::system::error_code ec);
-  void onSSLHandshake(boost::system::error_code ec);
-  void onHandshake(boost::system::error_code ec);
-
   void doSendConnect();
   void doSendJoinRoom(std::string str);
   void doSendPublish(std::string str);
@@ -114,19 +184,42 @@ class SoraSignaling : public std::enable_shared_from_this<SoraSignaling>,
   void doSendGetRoomInfo(std::string roomId, std::string str);
   /*void doSendPong(
       const rtc::scoped_refptr<const webrtc::RTCStatsReport>& report);*/
-  void createPeerFromConfig(std::string streamId);
+  // playOnly なら受信専用（ローカルのトラックを追加しない）で作る
+  void createPeerFromConfig(std::string streamId, bool playOnly);
 
- private:
-  void onClose(boost::system::error_code ec);
+  // SignalingTransport のコールバック
+  void onConnected(bool resumed, int attempts);
+  void onSignalingMessage(const char* data, size_t size);
+  void onReconnecting(int attempt, int delay_ms);
+  void onClosed(int attempts);
+  // 再接続後に、繋がっていないストリームの publish/play/joinRoom をやり直す
+  void doResume();
+  bool isStreamAlive(const std::string& streamId) const;
+
+  // 参加者の一覧の変化を反映する
+  void applyRoomDiff(const RoomState::Diff& diff);
+  void notifyRoomDiff(const RoomState::Diff& diff);
+  void notifyStreamState(const std::string& streamId, const char* state);
+  void notify(const nlohmann::json& message);
+  void closeStream(const std::string& streamId);
+  void publishSnapshot();
+  void doRelease();
 
-  void doRead();
-  void onRead(boost::system::error_code ec, std::size_t bytes_transferred);
+  void startKeepalive();
+  void scheduleKeepalive();
+  void onKeepalive(boost::system::error_code ec);
+  void scheduleRoomRefresh();
+  void onRoomRefresh(boost::system::error_code ec);
+  // 同じ間隔で一斉に送らないように ±10% ずらす
+  std::chrono::milliseconds withJitter(int interval_ms);
 
+ private:
   //void sendText(std::string text) override;
   void doSendText(std::string text);
 
-  void doWrite();
-  void onWrite(boost::system::error_code ec, std::size_t bytes_transferred);
+  // 送信キューの空きスロットを返す。メッセージを書き込んだら endMessage を呼ぶこと
+  std::string* beginMessage();
+  void endMessage(std::string* text);
   
   void onMessage(const webrtc::DataBuffer& buffer,std::string streamId);
 
@@ -134,19 +227,46 @@ class SoraSignaling : public std::enable_shared_from_this<SoraSignaling>,
   // WebRTC からのコールバック
   // これらは別スレッドからやってくるので取り扱い注意.
   void onIceConnectionStateChange(
+      const std::string streamId,
       webrtc::PeerConnectionInterface::IceConnectionState new_state) override;
-  void onIceCandidate(const std::string sdp_mid,
+  void onIceCandidate(const std::string streamId,
+                      const std::string sdp_mid,
                       const int sdp_mlineindex,
                       const std::string sdp) override;
-  void onCreateDescription(webrtc::SdpType type,
+  void onCreateDescription(const std::string streamId,
+                           webrtc::SdpType type,
                            const std::string sdp) override;
+  void onIceGatheringComplete(const std::string streamId,
+                              const std::string sdp) override;
   void onSetDescription(webrtc::SdpType type) override;
   void onDataChannel(
       rtc::scoped_refptr<webrtc::DataChannelInterface> data_channel,std::string streamId) override;
 
  private:
   void doIceConnectionStateChange(
+      std::string streamId,
       webrtc::PeerConnectionInterface::IceConnectionState new_state);
+  void doDataChannel(
+      rtc::scoped_refptr<webrtc::DataChannelInterface> data_channel,
+      std::string streamId);
+  void doCreateDescription(std::string streamId,
+                           webrtc::SdpType type,
+                           std::string sdp);
+  void doIceGatheringComplete(std::string streamId, std::string sdp);
+  void doIceCandidate(std::string streamId,
+                      std::string sdp_mid,
+                      int sdp_mlineindex,
+                      std::string sdp);
+  // CandidateBatcher のコールバック
+  void doSendDescription(const std::string& streamId,
+                         const std::string& type,
+                         const std::string& sdp);
+  void doLocalCandidate(const std::string& streamId,
+                        const IceCandidate& candidate);
+  void doSendCandidate(const std::string& streamId,
+                       const std::string& sdp_mid,
+                       int sdp_mlineindex,
+                       const std::string& sdp);
 };
 }  // namespace sora
 
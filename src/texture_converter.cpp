@@ -0,0 +1,66 @@
+#include "texture_converter.h"
+
+// libyuv
+#include "libyuv.h"
+
+namespace sora {
+
+void TextureConverter::ConvertToABGR(const webrtc::I420BufferInterface& src,
+                                     uint8_t* dst,
+                                     int dst_stride,
+                                     int dst_width,
+                                     int dst_height) {
+  const int src_width = src.width();
+  const int src_height = src.height();
+
+  // サイズが同じならスケーリングは不要なので、直接変換する
+  if (src_width == dst_width && src_height == dst_height) {
+    libyuv::I420ToABGR(src.DataY(), src.StrideY(), src.DataU(), src.StrideU(),
+                       src.DataV(), src.StrideV(), dst, dst_stride, dst_width,
+                       dst_height);
+    return;
+  }
+
+  // 出力の 1 行毎に、スケーリングした Y, U, V の行を作ってすぐ ABGR に変換する。
+  // I420 なので、色差の行は出力の 2 行毎に 1 回作る
+  const int dst_chroma_width = (dst_width + 1) / 2;
+  const int dst_chroma_height = (dst_height + 1) / 2;
+  y_scaler_.Configure(src_width, src_height, dst_width, dst_height);
+  chroma_scaler_.Configure(src.ChromaWidth(), src.ChromaHeight(),
+                           dst_chroma_width, dst_chroma_height);
+  size_t row_size = (size_t)dst_width + dst_chroma_width * 2;
+  if (row_buf_.size() < row_size) {
+    row_buf_.resize(row_size);
+  }
+  uint8_t* y_row = row_buf_.data();
+  uint8_t* u_row = y_row + dst_width;
+  uint8_t* v_row = u_row + dst_chroma_width;
+  for (int y = 0; y < dst_height; y++) {
+    y_scaler_.ScaleRow(src.DataY(), src.StrideY(), y, y_row);
+    if (y % 2 == 0) {
+      chroma_scaler_.ScaleRow(src.DataU(), src.StrideU(), y / 2, u_row);
+      chroma_scaler_.ScaleRow(src.DataV(), src.StrideV(), y / 2, v_row);
+    }
+    // 高さ 1 の変換なので、libyuv の行変換を 1 回呼ぶだけで、確保は発生しない
+    libyuv::I420ToABGR(y_row, dst_width, u_row, dst_chroma_width, v_row,
+                       dst_chroma_width, dst + (size_t)y * dst_stride,
+                       dst_stride, dst_width, 1);
+  }
+}
+
+const uint8_t* TextureConverter::ExtractPlane(
+    const webrtc::I420BufferInterface& src,
+    TexturePlane plane,
+    int dst_width,
+    int dst_height,
+    size_t* bytes_copied) {
+  PlaneView y = {src.DataY(), src.StrideY(), src.width(), src.height()};
+  PlaneView u = {src.DataU(), src.StrideU(), src.ChromaWidth(),
+                 src.ChromaHeight()};
+  PlaneView v = {src.DataV(), src.StrideV(), src.ChromaWidth(),
+                 src.ChromaHeight()};
+  return extractor_.Extract(y, u, v, plane, dst_width, dst_height,
+                            bytes_copied);
+}
+
+}  // namespace sora
@@ -0,0 +1,47 @@
+#ifndef SORA_TEXTURE_CONVERTER_H_INCLUDED
+#define SORA_TEXTURE_CONVERTER_H_INCLUDED
+
+#include <stdint.h>
+#include <vector>
+
+// webrtc
+#include "api/video/video_frame_buffer.h"
+
+#include "plane_extractor.h"
+#include "plane_scaler.h"
+
+namespace sora {
+
+// 受信した I420 フレームを Unity のテクスチャ用のフォーマットに変換する。
+//
+// スケーリングが必要な場合は、出力の 1 行毎に Y, U, V の行を PlaneScaler で作り、
+// その行をすぐに libyuv の行変換（SSE2/AVX2/NEON を実行時に選択する）で ABGR にする。
+// スケーリングしたフレーム全体を中間バッファに置くことは無い。
+// フィルタの係数と行バッファは使い回すので、サイズが変わらない限りメモリ確保は発生しない。
+class TextureConverter {
+ public:
+  void ConvertToABGR(const webrtc::I420BufferInterface& src,
+                     uint8_t* dst,
+                     int dst_stride,
+                     int dst_width,
+                     int dst_height);
+
+  // src の plane を dst_width x dst_height の詰めた（stride == 幅）画像にして返す。
+  // 詳しくは PlaneExtractor::Extract を参照。
+  const uint8_t* ExtractPlane(const webrtc::I420BufferInterface& src,
+                              TexturePlane plane,
+                              int dst_width,
+                              int dst_height,
+                              size_t* bytes_copied);
+
+ private:
+  PlaneScaler y_scaler_;
+  // U と V は同じサイズなので 1 つを使い回す
+  PlaneScaler chroma_scaler_;
+  std::vector<uint8_t> row_buf_;
+  PlaneExtractor extractor_;
+};
+
+}  // namespace sora
+
+#endif  // SORA_TEXTURE_CONVERTER_H_INCLUDED
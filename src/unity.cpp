@@ -67,6 +67,26 @@ void sora_dispatch_events(void* p) {
   auto sora = (sora::Sora*)p;
   sora->DispatchEvents();
 }
+int sora_dispatch_events_with_budget(void* p, int budget_us) {
+  auto sora = (sora::Sora*)p;
+  return sora->DispatchEvents(budget_us);
+}
+void sora_set_event_coalescing(void* p, unity_bool_t enabled) {
+  auto sora = (sora::Sora*)p;
+  sora->SetEventCoalescing(enabled != 0);
+}
+int sora_get_event_queue_depth(void* p) {
+  auto sora = (sora::Sora*)p;
+  return sora->GetEventQueueDepth();
+}
+int64_t sora_get_dropped_event_count(void* p) {
+  auto sora = (sora::Sora*)p;
+  return sora->GetDroppedEventCount();
+}
+int64_t sora_get_coalesced_event_count(void* p) {
+  auto sora = (sora::Sora*)p;
+  return sora->GetCoalescedEventCount();
+}
 
 int sora_connect(void* p,
                  const char* unity_version,
@@ -120,6 +140,51 @@ int sora_connect(void* p,
 void* sora_get_texture_update_callback() {
   return (void*)&sora::UnityRenderer::Sink::TextureUpdateCallback;
 }
+void* sora_get_texture_update_callback_plane(int plane) {
+  switch ((sora::TexturePlane)plane) {
+    case sora::TexturePlane::Y:
+      return (void*)&sora::UnityRenderer::Sink::TextureUpdateCallbackY;
+    case sora::TexturePlane::U:
+      return (void*)&sora::UnityRenderer::Sink::TextureUpdateCallbackU;
+    case sora::TexturePlane::V:
+      return (void*)&sora::UnityRenderer::Sink::TextureUpdateCallbackV;
+    case sora::TexturePlane::UV:
+      return (void*)&sora::UnityRenderer::Sink::TextureUpdateCallbackUV;
+  }
+  return nullptr;
+}
+int sora_get_texture_update_time_us(ptrid_t track_id) {
+  auto pinned = sora::IdPointer::Instance().Lookup(track_id);
+  auto sink = (sora::UnityRenderer::Sink*)pinned.get();
+  if (sink == nullptr) {
+    return 0;
+  }
+  return sink->GetTextureUpdateTimeUs();
+}
+int64_t sora_get_track_frame_counter(ptrid_t track_id) {
+  auto pinned = sora::IdPointer::Instance().Lookup(track_id);
+  auto sink = (sora::UnityRenderer::Sink*)pinned.get();
+  if (sink == nullptr) {
+    return 0;
+  }
+  return (int64_t)sink->GetFrameCounter();
+}
+int64_t sora_get_track_plane_bytes_copied(ptrid_t track_id) {
+  auto pinned = sora::IdPointer::Instance().Lookup(track_id);
+  auto sink = (sora::UnityRenderer::Sink*)pinned.get();
+  if (sink == nullptr) {
+    return 0;
+  }
+  return sink->GetPlaneBytesCopied();
+}
+void sora_set_track_viewport(void* p,
+                             ptrid_t track_id,
+                             int width,
+                             int height,
+                             int max_fps) {
+  auto sora = (sora::Sora*)p;
+  sora->SetTrackViewport(track_id, width, height, max_fps);
+}
 
 void sora_destroy(void* sora) {
   delete (sora::Sora*)sora;
@@ -134,8 +199,118 @@ int sora_get_render_callback_event_id(void* p) {
 }
 
 void sora_process_audio(void* p, const void* buf, int offset, int samples) {
+  // 48kHz ステレオとして扱う
+  auto sora = (sora::Sora*)p;
+  sora->ProcessAudio(buf, offset, samples, 2, 48000);
+}
+void sora_process_audio_ex(void* p,
+                           const void* buf,
+                           int offset,
+                           int samples,
+                           int channels,
+                           int sample_rate) {
+  auto sora = (sora::Sora*)p;
+  sora->ProcessAudio(buf, offset, samples, channels, sample_rate);
+}
+void sora_pull_audio(void* p,
+                     void* buf,
+                     int offset,
+                     int samples,
+                     int channels,
+                     int sample_rate) {
+  auto sora = (sora::Sora*)p;
+  sora->PullAudio(buf, offset, samples, channels, sample_rate);
+}
+void sora_set_stream_audio_enabled(void* p, unity_bool_t enabled) {
+  auto sora = (sora::Sora*)p;
+  sora->SetStreamAudioEnabled(enabled);
+}
+void sora_enum_audio_streams(void* p,
+                             audio_stream_enum_cb_t f,
+                             void* userdata) {
+  auto sora = (sora::Sora*)p;
+  sora->EnumAudioStreams([f, userdata](const std::string& stream_id) {
+    f(stream_id.c_str(), userdata);
+  });
+}
+int sora_pull_stream_audio(void* p,
+                           const char* stream_id,
+                           void* buf,
+                           int offset,
+                           int samples,
+                           int channels,
+                           int sample_rate) {
+  auto sora = (sora::Sora*)p;
+  return sora->PullStreamAudio(stream_id, buf, offset, samples, channels,
+                               sample_rate);
+}
+int sora_get_stream_audio_sample_rate(void* p, const char* stream_id) {
+  auto sora = (sora::Sora*)p;
+  return sora->GetStreamAudioSampleRate(stream_id);
+}
+void sora_set_stream_audio_spatial(void* p,
+                                   const char* stream_id,
+                                   float gain,
+                                   float pan,
+                                   float distance) {
+  auto sora = (sora::Sora*)p;
+  sora->SetStreamAudioSpatial(stream_id, gain, pan, distance);
+}
+int sora_get_audio_levels(void* p,
+                          sora_audio_level_t* levels,
+                          int max_levels) {
+  auto sora = (sora::Sora*)p;
+  return sora->GetAudioLevels(levels, max_levels);
+}
+int sora_get_stream_stats(void* p,
+                          sora_stream_stats_t* stats,
+                          int max_stats) {
+  auto sora = (sora::Sora*)p;
+  return sora->GetStreamStats(stats, max_stats);
+}
+void sora_set_keepalive(void* p,
+                        int keepalive_interval_ms,
+                        int room_refresh_interval_ms) {
+  auto sora = (sora::Sora*)p;
+  sora->SetKeepalive(keepalive_interval_ms, room_refresh_interval_ms);
+}
+void sora_set_reconnect(void* p,
+                        int max_attempts,
+                        int base_delay_ms,
+                        int max_delay_ms) {
+  auto sora = (sora::Sora*)p;
+  sora->SetReconnect(max_attempts, base_delay_ms, max_delay_ms);
+}
+void sora_set_candidate_batching(void* p, int window_ms) {
+  auto sora = (sora::Sora*)p;
+  sora->SetCandidateBatching(window_ms);
+}
+void sora_get_signaling_stats(void* p, sora_signaling_stats_t* stats) {
+  auto sora = (sora::Sora*)p;
+  sora->GetSignalingStats(stats);
+}
+void sora_set_stats_sampling(void* p, int interval_ms, int history_size) {
+  auto sora = (sora::Sora*)p;
+  sora->SetStatsSampling(interval_ms, history_size);
+}
+int sora_get_stream_stats_history(void* p,
+                                  const char* stream_id,
+                                  const char* kind,
+                                  unity_bool_t inbound,
+                                  sora_stream_stats_t* stats,
+                                  int max_stats) {
+  auto sora = (sora::Sora*)p;
+  return sora->GetStreamStatsHistory(stream_id, kind, inbound != 0, stats,
+                                     max_stats);
+}
+void sora_pull_spatial_audio(void* p,
+                             void* buf,
+                             int offset,
+                             int samples,
+                             int channels,
+                             int sample_rate) {
   auto sora = (sora::Sora*)p;
-  sora->ProcessAudio(buf, offset, samples);
+  sora->PullSpatialAudio(buf, offset, samples, channels, sample_rate);
 }
 void sora_set_on_handle_audio(void* p, handle_audio_cb_t f, void* userdata) {
   auto sora = (sora::Sora*)p;
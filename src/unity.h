@@ -17,6 +17,40 @@ typedef void (*stats_cb_t)(const char* json, int size, void* userdata);
 
 typedef int32_t unity_bool_t;
 
+// sora_get_audio_levels で返す音声レベル
+typedef struct {
+  // 空文字列の場合は Unity から送信している音声
+  char stream_id[64];
+  float rms;
+  float peak;
+  unity_bool_t voice_active;
+} sora_audio_level_t;
+
+// sora_get_stream_stats で返す RTP ストリーム毎の統計情報
+typedef struct {
+  char stream_id[64];
+  // "audio" または "video"
+  char kind[8];
+  // 受信なら 1、送信なら 0
+  unity_bool_t inbound;
+  int64_t timestamp_us;
+  double bitrate_bps;
+  double frames_per_second;
+  // 選択されている候補ペアの RTT
+  double rtt_ms;
+  // 以下の 3 つは受信のみ
+  double jitter_ms;
+  int64_t packets_lost;
+  int64_t frames_dropped;
+  // 受信ならデコードした、送信ならエンコードしたフレーム数
+  int64_t frames;
+  // 1 フレームあたりのデコード（送信ならエンコード）時間
+  double frame_time_ms;
+  // 前回の統計情報からの増分
+  int64_t packets_lost_delta;
+  int64_t frames_dropped_delta;
+} sora_stream_stats_t;
+
 UNITY_INTERFACE_EXPORT void* sora_create();
 UNITY_INTERFACE_EXPORT void sora_set_on_add_track(void* p,
                                                   track_cb_t on_add_track,
@@ -28,6 +62,13 @@ UNITY_INTERFACE_EXPORT void sora_set_on_notify(void* p,
                                                notify_cb_t on_notify,
                                                void* userdata);
 UNITY_INTERFACE_EXPORT void sora_dispatch_events(void* p);
+UNITY_INTERFACE_EXPORT int sora_dispatch_events_with_budget(void* p,
+                                                            int budget_us);
+UNITY_INTERFACE_EXPORT void sora_set_event_coalescing(void* p,
+                                                      unity_bool_t enabled);
+UNITY_INTERFACE_EXPORT int sora_get_event_queue_depth(void* p);
+UNITY_INTERFACE_EXPORT int64_t sora_get_dropped_event_count(void* p);
+UNITY_INTERFACE_EXPORT int64_t sora_get_coalesced_event_count(void* p);
 UNITY_INTERFACE_EXPORT int sora_connect(void* p,
                                         const char* unity_version,
                                         const char* signaling_url,
@@ -50,6 +91,16 @@ UNITY_INTERFACE_EXPORT int sora_connect(void* p,
                                         int audio_bitrate,
                                         int audio_only);
 UNITY_INTERFACE_EXPORT void* sora_get_texture_update_callback();
+UNITY_INTERFACE_EXPORT void* sora_get_texture_update_callback_plane(int plane);
+UNITY_INTERFACE_EXPORT int sora_get_texture_update_time_us(ptrid_t track_id);
+UNITY_INTERFACE_EXPORT int64_t sora_get_track_frame_counter(ptrid_t track_id);
+UNITY_INTERFACE_EXPORT int64_t
+sora_get_track_plane_bytes_copied(ptrid_t track_id);
+UNITY_INTERFACE_EXPORT void sora_set_track_viewport(void* p,
+                                                   ptrid_t track_id,
+                                                   int width,
+                                                   int height,
+                                                   int max_fps);
 UNITY_INTERFACE_EXPORT void sora_destroy(void* sora);
 
 UNITY_INTERFACE_EXPORT void* sora_get_render_callback();
@@ -59,6 +110,82 @@ UNITY_INTERFACE_EXPORT void sora_process_audio(void* p,
                                                const void* buf,
                                                int offset,
                                                int samples);
+UNITY_INTERFACE_EXPORT void sora_process_audio_ex(void* p,
+                                                  const void* buf,
+                                                  int offset,
+                                                  int samples,
+                                                  int channels,
+                                                  int sample_rate);
+UNITY_INTERFACE_EXPORT void sora_pull_audio(void* p,
+                                            void* buf,
+                                            int offset,
+                                            int samples,
+                                            int channels,
+                                            int sample_rate);
+typedef void (*audio_stream_enum_cb_t)(const char* stream_id, void* userdata);
+UNITY_INTERFACE_EXPORT void sora_set_stream_audio_enabled(void* p,
+                                                          unity_bool_t enabled);
+UNITY_INTERFACE_EXPORT void sora_enum_audio_streams(void* p,
+                                                    audio_stream_enum_cb_t f,
+                                                    void* userdata);
+UNITY_INTERFACE_EXPORT int sora_pull_stream_audio(void* p,
+                                                  const char* stream_id,
+                                                  void* buf,
+                                                  int offset,
+                                                  int samples,
+                                                  int channels,
+                                                  int sample_rate);
+UNITY_INTERFACE_EXPORT int sora_get_stream_audio_sample_rate(
+    void* p,
+    const char* stream_id);
+UNITY_INTERFACE_EXPORT void sora_set_stream_audio_spatial(void* p,
+                                                          const char* stream_id,
+                                                          float gain,
+                                                          float pan,
+                                                          float distance);
+UNITY_INTERFACE_EXPORT void sora_pull_spatial_audio(void* p,
+                                                    void* buf,
+                                                    int offset,
+                                                    int samples,
+                                                    int channels,
+                                                    int sample_rate);
+UNITY_INTERFACE_EXPORT int sora_get_audio_levels(void* p,
+                                                 sora_audio_level_t* levels,
+                                                 int max_levels);
+UNITY_INTERFACE_EXPORT int sora_get_stream_stats(void* p,
+                                                 sora_stream_stats_t* stats,
+                                                 int max_stats);
+UNITY_INTERFACE_EXPORT void sora_set_keepalive(void* p,
+                                               int keepalive_interval_ms,
+                                               int room_refresh_interval_ms);
+UNITY_INTERFACE_EXPORT void sora_set_reconnect(void* p,
+                                               int max_attempts,
+                                               int base_delay_ms,
+                                               int max_delay_ms);
+UNITY_INTERFACE_EXPORT void sora_set_candidate_batching(void* p,
+                                                        int window_ms);
+typedef struct {
+  // シグナリングで送受信したメッセージ数とバイト数（接続してからの累計）
+  int64_t messages_sent;
+  int64_t bytes_sent;
+  int64_t messages_received;
+  int64_t bytes_received;
+  // 送信した ICE 候補（takeCandidate）の数
+  int64_t candidates_sent;
+} sora_signaling_stats_t;
+UNITY_INTERFACE_EXPORT void sora_get_signaling_stats(
+    void* p,
+    sora_signaling_stats_t* stats);
+UNITY_INTERFACE_EXPORT void sora_set_stats_sampling(void* p,
+                                                    int interval_ms,
+                                                    int history_size);
+UNITY_INTERFACE_EXPORT int sora_get_stream_stats_history(
+    void* p,
+    const char* stream_id,
+    const char* kind,
+    unity_bool_t inbound,
+    sora_stream_stats_t* stats,
+    int max_stats);
 typedef void (*handle_audio_cb_t)(const int16_t* buf,
                                   int samples,
                                   int channels,
@@ -2,16 +2,24 @@
 #define SORA_UNITY_AUDIO_DEVICE_H_INCLUDED
 
 #include <stddef.h>
+#include <algorithm>
+#include <cstdlib>
 #include <atomic>
 #include <memory>
 #include <vector>
 
 // webrtc
+#include "common_audio/resampler/push_sinc_resampler.h"
 #include "modules/audio_device/audio_device_buffer.h"
 #include "modules/audio_device/include/audio_device.h"
 #include "rtc_base/ref_counted_object.h"
 #include "rtc_base/thread.h"
 
+// sora
+#include "audio_level_meter.h"
+#include "audio_ring_buffer.h"
+#include "audio_util.h"
+
 namespace sora {
 
 class UnityAudioDevice : public webrtc::AudioDeviceModule {
@@ -45,22 +53,137 @@ class UnityAudioDevice : public webrtc::AudioDeviceModule {
         adm, adm_recording, adm_playout, on_handle_audio, task_queue_factory);
   }
 
-  void ProcessAudioData(const float* data, int32_t size) {
-    if (!adm_recording_ && initialized_ && is_recording_) {
-      for (int i = 0; i < size; i++) {
-#pragma warning(suppress : 4244)
-        converted_audio_data_.push_back(data[i] >= 0 ? data[i] * SHRT_MAX
-                                                     : data[i] * -SHRT_MIN);
+  // Unity の音声（インターリーブされた float）を送信する。
+  // frames は 1 チャンネルあたりのサンプル数。
+  //
+  // AudioDeviceBuffer のフォーマットは InitRecording で 48kHz ステレオに固定していて、
+  // Unity のサンプリングレートが違う場合はここで 48kHz に変換してから 10 ミリ秒ずつ渡す。
+  // 変換は入出力とも整数のサンプル数になる単位で行うので比率は正確で、
+  // Unity から渡された分だけ送る限り、クロックのずれでバッファが溢れることは無い。
+  // モノラルは両方のチャンネルに、3 チャンネル以上は先頭の 2 チャンネルを使う。
+  void ProcessAudioData(const float* data,
+                        int32_t frames,
+                        int channels,
+                        int sample_rate) {
+    if (adm_recording_ || !initialized_ || !is_recording_) {
+      return;
+    }
+    if (!SetRecordingFormat(channels, sample_rate)) {
+      return;
+    }
+    // リングバッファ上に直接変換して、変換の単位分溜まる度にそこから渡す。
+    // 容量は変換の単位の倍数なので、渡す領域は常に連続している。
+    size_t block_size = recording_block_frames_ * kRecordingChannels;
+    size_t right = channels == 1 ? 0 : 1;
+    size_t frame = 0;
+    while (frame < (size_t)frames) {
+      size_t n;
+      int16_t* dst = recorded_audio_data_.WriteRegion(&n);
+      n = std::min(n / kRecordingChannels, (size_t)frames - frame);
+      const float* src = data + frame * channels;
+      if (channels == kRecordingChannels) {
+        FloatToS16(src, n * kRecordingChannels, dst);
+      } else {
+        for (size_t i = 0; i < n; i++) {
+          FloatToS16(src + i * channels, 1, dst + i * 2);
+          FloatToS16(src + i * channels + right, 1, dst + i * 2 + 1);
+        }
+      }
+      recorded_audio_data_.Commit(n * kRecordingChannels);
+      frame += n;
+
+      while (recorded_audio_data_.Size() >= block_size) {
+        size_t available;
+        const int16_t* block = recorded_audio_data_.ReadRegion(&available);
+        DeliverRecordedBlock(block);
+        recorded_audio_data_.Consume(block_size);
+      }
+    }
+  }
+
+  // 送信する音声のフォーマットが変わっていれば、リングバッファとリサンプラを設定し直す。
+  // AudioDeviceBuffer 側のフォーマットは変えない。
+  // Unity のオーディオスレッドからのみ呼ぶこと。
+  bool SetRecordingFormat(int channels, int sample_rate) {
+    if (channels == recording_channels_ &&
+        sample_rate == recording_sample_rate_) {
+      return true;
+    }
+    int chunks = RecordingBlockChunks(sample_rate);
+    if (channels <= 0 || chunks == 0) {
+      if (channels != recording_channels_ ||
+          sample_rate != unsupported_sample_rate_) {
+        RTC_LOG(LS_ERROR) << "Unsupported audio format: channels=" << channels
+                          << " sample_rate=" << sample_rate;
+      }
+      recording_channels_ = channels;
+      unsupported_sample_rate_ = sample_rate;
+      recording_sample_rate_ = 0;
+      return false;
+    }
+    RTC_LOG(LS_INFO) << "Recording format: channels=" << channels
+                     << " sample_rate=" << sample_rate;
+    size_t in_frames = (size_t)sample_rate * chunks / 100;
+    size_t out_frames = (size_t)kRecordingSampleRate * chunks / 100;
+    recorded_audio_data_.Reset(in_frames * kRecordingChannels * 4);
+    if (sample_rate != kRecordingSampleRate) {
+      for (auto& resampler : recording_resamplers_) {
+        resampler.reset(new webrtc::PushSincResampler(in_frames, out_frames));
+      }
+      resample_src_.resize(in_frames);
+      resample_dst_.resize(out_frames);
+      resampled_audio_data_.resize(out_frames * kRecordingChannels);
+    }
+    recording_block_chunks_ = chunks;
+    recording_block_frames_ = in_frames;
+    recording_channels_ = channels;
+    recording_sample_rate_ = sample_rate;
+    unsupported_sample_rate_ = 0;
+    return true;
+  }
+
+  // 入力も出力も整数のサンプル数になる変換の単位が、10 ミリ秒の何倍になるかを返す。
+  // 22050Hz なら 20 ミリ秒（441 サンプル）、11025Hz なら 40 ミリ秒になる。
+  // 扱えないサンプリングレートなら 0 を返す。
+  static int RecordingBlockChunks(int sample_rate) {
+    if (sample_rate <= 0 || sample_rate > kMaxRecordingSampleRate) {
+      return 0;
+    }
+    for (int chunks = 1; chunks <= kMaxRecordingBlockChunks; chunks++) {
+      if ((int64_t)sample_rate * chunks % 100 == 0) {
+        return chunks;
       }
-      //opus supports up to 48khz sample rate, enforce 48khz here for quality
-      int chunk_size = 48000 * 2 / 100;
-      while (converted_audio_data_.size() > chunk_size) {
-        device_buffer_->SetRecordedBuffer(converted_audio_data_.data(),
-                                          chunk_size / 2);
-        device_buffer_->DeliverRecordedData();
-        converted_audio_data_.erase(converted_audio_data_.begin(),
-                                    converted_audio_data_.begin() + chunk_size);
+    }
+    return 0;
+  }
+
+  // Unity のサンプリングレートで変換の単位分の音声を 48kHz にして、10 ミリ秒ずつ渡す
+  void DeliverRecordedBlock(const int16_t* block) {
+    const int16_t* out = block;
+    size_t chunk_frames = kRecordingSampleRate / 100;
+    if (recording_sample_rate_ != kRecordingSampleRate) {
+      // PushSincResampler はモノラルなので、チャンネルごとに変換する
+      size_t out_frames = chunk_frames * recording_block_chunks_;
+      for (int ch = 0; ch < kRecordingChannels; ch++) {
+        for (size_t i = 0; i < recording_block_frames_; i++) {
+          resample_src_[i] = block[i * kRecordingChannels + ch];
+        }
+        recording_resamplers_[ch]->Resample(
+            resample_src_.data(), recording_block_frames_,
+            resample_dst_.data(), out_frames);
+        for (size_t i = 0; i < out_frames; i++) {
+          resampled_audio_data_[i * kRecordingChannels + ch] =
+              resample_dst_[i];
+        }
       }
+      out = resampled_audio_data_.data();
+    }
+    for (int i = 0; i < recording_block_chunks_; i++) {
+      const int16_t* chunk = out + i * chunk_frames * kRecordingChannels;
+      recording_level_.Process(chunk, chunk_frames, kRecordingChannels,
+                               kRecordingSampleRate);
+      device_buffer_->SetRecordedBuffer(chunk, chunk_frames);
+      device_buffer_->DeliverRecordedData();
     }
   }
 
@@ -146,24 +269,178 @@ class UnityAudioDevice : public webrtc::AudioDeviceModule {
     return adm_recording_ ? adm_->SetRecordingDevice(device) : 0;
   }
 
+  // 受信した音声を Unity の OnAudioFilterRead から取り出す（pull モード）。
+  // frames は 1 チャンネルあたりのサンプル数。
+  //
+  // 呼ばれている間は pull モードになり、再生スレッドはリングバッファの
+  // 残量に合わせて WebRTC から音声を取り出すようになる。
+  // kPullTimeoutMs の間呼ばれなければ、再生スレッドは 10 ミリ秒ごとのタイマーに戻る。
+  // 足りない分は無音で埋めてアンダーランとして数える。
+  void PullAudioData(float* data, int32_t frames, int channels, int sample_rate) {
+    // InitPlayout はこれが false の間にリングバッファを作り直す
+    pull_reading_ = true;
+    if (adm_playout_ || !is_playing_ || sample_rate <= 0 ||
+        sample_rate % 100 != 0 || sample_rate > kMaxPlayoutSampleRate) {
+      pull_reading_ = false;
+      std::fill(data, data + (size_t)frames * channels, 0.0f);
+      return;
+    }
+    last_pull_ns_ = NowNanos();
+    if (!pull_playout_) {
+      // タイマーに戻っていた間に残っていた古い音声は、下で捨てる
+      pull_ring_sample_rate_ = 0;
+      pull_playout_ = true;
+    }
+    pull_sample_rate_ = sample_rate;
+    // 再生スレッドがサンプリングレートを切り替えるまで、リングバッファには
+    // 前のサンプリングレートの音声しか入ってこない
+    if (playout_sample_rate_ != sample_rate) {
+      pull_reading_ = false;
+      std::fill(data, data + (size_t)frames * channels, 0.0f);
+      return;
+    }
+    // 切り替わった時点でリングバッファに残っている分は前のサンプリングレートか
+    // 古い音声なので、読み込み側で捨てる
+    if (pull_ring_sample_rate_ != sample_rate) {
+      playout_data_.Consume(playout_data_.Size());
+      pull_ring_sample_rate_ = sample_rate;
+    }
+
+    int src_channels = playout_channels_;
+    size_t frame = 0;
+    while (frame < (size_t)frames) {
+      size_t n;
+      const int16_t* src = playout_data_.ReadRegion(&n);
+      n = std::min(n / src_channels, (size_t)frames - frame);
+      if (n == 0) {
+        break;
+      }
+      S16ToFloat(src, n, src_channels, data + frame * channels, channels);
+      playout_data_.Consume(n * src_channels);
+      frame += n;
+    }
+    if (frame < (size_t)frames) {
+      std::fill(data + frame * channels, data + (size_t)frames * channels,
+                0.0f);
+      playout_underruns_++;
+    }
+    pull_reading_ = false;
+  }
+
+  // Unity から渡された送信音声のレベル
+  AudioLevelMeter::Level GetRecordingLevel() const {
+    return recording_level_.GetLevel();
+  }
+
+  struct PlayoutStats {
+    int64_t chunks;
+    int64_t underruns;
+    int64_t overruns;
+    int64_t late_wakeups;
+    int64_t resyncs;
+    int64_t jitter_us;
+    int buffered_ms;
+    bool pull;
+  };
+  PlayoutStats GetPlayoutStats() const {
+    PlayoutStats stats;
+    stats.chunks = playout_chunks_;
+    stats.underruns = playout_underruns_;
+    stats.overruns = playout_overruns_;
+    stats.late_wakeups = playout_late_wakeups_;
+    stats.resyncs = playout_resyncs_;
+    stats.jitter_us = playout_jitter_us_;
+    int rate = playout_sample_rate_;
+    stats.buffered_ms =
+        rate == 0 ? 0
+                  : (int)(playout_data_.Size() / playout_channels_ * 1000 /
+                          rate);
+    stats.pull = pull_playout_;
+    return stats;
+  }
+
   void HandleAudioData() {
     int channels = stereo_playout_ ? 2 : 1;
+    playout_channels_ = channels;
     auto next_at = std::chrono::steady_clock::now();
     while (!handle_audio_thread_stopped_) {
+      if (pull_playout_) {
+        // AudioSource が無効になった場合などで Unity が取り出さなくなったら、
+        // タイマーに戻って on_handle_audio を呼び続ける
+        if (NowNanos() - last_pull_ns_ > kPullTimeoutMs * 1000000LL) {
+          RTC_LOG(LS_INFO) << "Audio pull timed out, falling back to timer";
+          pull_playout_ = false;
+          next_at = std::chrono::steady_clock::now();
+          continue;
+        }
+        // Unity が取り出したペースに合わせて、目標の量まで補充する。
+        // 再生のクロックは Unity 側が持っているので、ずれは溜まらない。
+        int rate = pull_sample_rate_;
+        if (rate != playout_sample_rate_) {
+          device_buffer_->SetPlayoutSampleRate(rate);
+          playout_sample_rate_ = rate;
+        }
+        size_t target = (size_t)rate / 100 * channels * kPullTargetChunks;
+        while (playout_data_.Size() < target && !handle_audio_thread_stopped_) {
+          PlayoutChunk(channels);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        next_at = std::chrono::steady_clock::now();
+        continue;
+      }
+
       // 10 ミリ秒ごとにオーディオデータを取得する
       next_at += std::chrono::milliseconds(10);
       std::this_thread::sleep_until(next_at);
 
-      int chunk_size = 48000 / 100;
-      int samples = device_buffer_->RequestPlayoutData(chunk_size);
+      auto now = std::chrono::steady_clock::now();
+      int64_t late_us =
+          std::chrono::duration_cast<std::chrono::microseconds>(now - next_at)
+              .count();
+      // RFC 3550 と同じように 1/16 ずつ平滑化する
+      int64_t jitter_us = playout_jitter_us_;
+      playout_jitter_us_ = jitter_us + (std::abs(late_us) - jitter_us) / 16;
+      if (late_us > kLateWakeupUs) {
+        playout_late_wakeups_++;
+      }
 
-      //RTC_LOG(LS_INFO) << "handle audio data: chunk_size=" << chunk_size
-      //                 << " samples=" << samples;
+      // 遅れた分はまとめて取り出して追いつく。
+      // 遅れすぎた場合は追いつくのを諦めて、今の時刻を基準にし直す。
+      int chunks = 1 + (int)(late_us / 10000);
+      if (chunks > kMaxCatchUpChunks) {
+        playout_resyncs_++;
+        chunks = 1;
+        next_at = now;
+      } else {
+        next_at += std::chrono::milliseconds(10 * (chunks - 1));
+      }
+      for (int i = 0; i < chunks; i++) {
+        PlayoutChunk(channels);
+      }
+    }
+  }
+
+  static int64_t NowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
 
-      std::unique_ptr<int16_t[]> audio_buffer(new int16_t[samples * channels]);
-      device_buffer_->GetPlayoutData(audio_buffer.get());
-      if (on_handle_audio_) {
-        on_handle_audio_(audio_buffer.get(), samples, channels);
+  // WebRTC から 10 ミリ秒分の音声を取り出して、コールバックとリングバッファに渡す
+  void PlayoutChunk(int channels) {
+    int samples = device_buffer_->RequestPlayoutData(playout_sample_rate_ / 100);
+    device_buffer_->GetPlayoutData(playout_buffer_.get());
+    playout_chunks_++;
+
+    //RTC_LOG(LS_INFO) << "handle audio data: samples=" << samples;
+
+    if (on_handle_audio_) {
+      on_handle_audio_(playout_buffer_.get(), samples, channels);
+    }
+    if (pull_playout_) {
+      size_t size = (size_t)samples * channels;
+      if (playout_data_.Write(playout_buffer_.get(), size) < size) {
+        playout_overruns_++;
       }
     }
   }
@@ -187,8 +464,23 @@ class UnityAudioDevice : public webrtc::AudioDeviceModule {
     } else {
       DoStopPlayout();
 
+      // Unity が PullAudioData で読み込んでいない間に作り直す。
+      // is_playing_ を先に下ろすので、この後に始まる PullAudioData は読み込まない。
+      is_playing_ = false;
+      while (pull_reading_) {
+        std::this_thread::yield();
+      }
+
+      // 再生用のバッファはここで確保して使い回す
+      if (!playout_buffer_) {
+        playout_buffer_.reset(new int16_t[kMaxPlayoutSampleRate / 100 * 2]);
+      }
+      playout_data_.Reset(kMaxPlayoutSampleRate / 1000 * 2 *
+                          kPlayoutBufferMs);
+      playout_sample_rate_ = kDefaultPlayoutSampleRate;
+      pull_playout_ = false;
       is_playing_ = true;
-      device_buffer_->SetPlayoutSampleRate(48000);
+      device_buffer_->SetPlayoutSampleRate(kDefaultPlayoutSampleRate);
       device_buffer_->SetPlayoutChannels(stereo_playout_ ? 2 : 1);
 
       handle_audio_thread_.reset(new std::thread([this]() {
@@ -218,9 +510,15 @@ class UnityAudioDevice : public webrtc::AudioDeviceModule {
     if (adm_recording_) {
       return adm_->InitRecording();
     } else {
-      is_recording_ = true;
-      device_buffer_->SetRecordingSampleRate(48000);
-      device_buffer_->SetRecordingChannels(2);
+      // AudioDeviceBuffer のフォーマットは固定で、Unity のフォーマットは
+      // 最初の ProcessAudioData で設定する
+      if (!is_recording_) {
+        recording_channels_ = 0;
+        recording_sample_rate_ = 0;
+        device_buffer_->SetRecordingSampleRate(kRecordingSampleRate);
+        device_buffer_->SetRecordingChannels(kRecordingChannels);
+        is_recording_ = true;
+      }
       return 0;
     }
   }
@@ -415,6 +713,25 @@ class UnityAudioDevice : public webrtc::AudioDeviceModule {
 #endif  // WEBRTC_IOS
 
  private:
+  // AudioDeviceBuffer に渡す送信音声のフォーマット
+  static const int kRecordingSampleRate = 48000;
+  static const int kRecordingChannels = 2;
+  static const int kMaxRecordingSampleRate = 192000;
+  // 変換の単位の最大値（10 ミリ秒単位）
+  static const int kMaxRecordingBlockChunks = 4;
+  static const int kDefaultPlayoutSampleRate = 48000;
+  static const int kMaxPlayoutSampleRate = 96000;
+  // pull モードで取り出される前に溜めておく量（10 ミリ秒単位）
+  static const int kPullTargetChunks = 4;
+  // PullAudioData がこの間呼ばれなければ pull モードをやめる
+  static const int kPullTimeoutMs = 200;
+  // pull モードのリングバッファに溜められる量
+  static const int kPlayoutBufferMs = 200;
+  // 再生スレッドの起床がこれ以上遅れたら数える
+  static const int kLateWakeupUs = 5000;
+  // 追いつくために一度に取り出す最大数（10 ミリ秒単位）
+  static const int kMaxCatchUpChunks = 5;
+
   rtc::scoped_refptr<webrtc::AudioDeviceModule> adm_;
   bool adm_recording_;
   bool adm_playout_;
@@ -428,7 +745,35 @@ class UnityAudioDevice : public webrtc::AudioDeviceModule {
   std::atomic_bool is_recording_ = {false};
   std::atomic_bool is_playing_ = {false};
   std::atomic_bool stereo_playout_ = {false};
-  std::vector<int16_t> converted_audio_data_;
+  std::unique_ptr<int16_t[]> playout_buffer_;
+  AudioRingBuffer playout_data_;
+  std::atomic_bool pull_playout_ = {false};
+  std::atomic_bool pull_reading_ = {false};
+  std::atomic<int64_t> last_pull_ns_ = {0};
+  // PullAudioData からのみ触る
+  int pull_ring_sample_rate_ = 0;
+  std::atomic<int> pull_sample_rate_ = {0};
+  std::atomic<int> playout_sample_rate_ = {0};
+  std::atomic<int> playout_channels_ = {1};
+  std::atomic<int64_t> playout_chunks_ = {0};
+  std::atomic<int64_t> playout_underruns_ = {0};
+  std::atomic<int64_t> playout_overruns_ = {0};
+  std::atomic<int64_t> playout_late_wakeups_ = {0};
+  std::atomic<int64_t> playout_resyncs_ = {0};
+  std::atomic<int64_t> playout_jitter_us_ = {0};
+  AudioRingBuffer recorded_audio_data_;
+  AudioLevelMeter recording_level_;
+  // 以下は InitRecording の後は Unity のオーディオスレッドからのみ触る
+  int recording_channels_ = 0;
+  int recording_sample_rate_ = 0;
+  int unsupported_sample_rate_ = 0;
+  int recording_block_chunks_ = 0;
+  size_t recording_block_frames_ = 0;
+  std::unique_ptr<webrtc::PushSincResampler>
+      recording_resamplers_[kRecordingChannels];
+  std::vector<int16_t> resample_src_;
+  std::vector<int16_t> resample_dst_;
+  std::vector<int16_t> resampled_audio_data_;
 };  // namespace sora
 
 }  // namespace sora
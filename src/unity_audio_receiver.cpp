@@ -0,0 +1,310 @@
+#include "unity_audio_receiver.h"
+
+#include <algorithm>
+
+#include "rtc_base/logging.h"
+
+// sora
+#include "audio_util.h"
+
+namespace sora {
+
+UnityAudioReceiver::Sink::Sink(std::string stream_id,
+                               webrtc::AudioTrackInterface* track)
+    : stream_id_(std::move(stream_id)), track_(track) {
+  ring_.Reset(kMaxSampleRate * kChannels * kBufferMs / 1000);
+  // OnData は 10 ミリ秒毎に呼ばれるので、その分を確保しておく
+  stereo_buf_.resize(kMaxSampleRate / 100 * kChannels);
+  resample_buf_.resize(kMaxSampleRate / 100 * kChannels);
+  SetSpatial(1.0f, 0.0f, 0.0f);
+  track_->AddSink(this);
+}
+void UnityAudioReceiver::Sink::Detach() {
+  if (track_ != nullptr) {
+    track_->RemoveSink(this);
+    track_ = nullptr;
+  }
+}
+const std::string& UnityAudioReceiver::Sink::GetStreamId() const {
+  return stream_id_;
+}
+webrtc::AudioTrackInterface* UnityAudioReceiver::Sink::GetTrack() const {
+  return track_.get();
+}
+int UnityAudioReceiver::Sink::GetSampleRate() const {
+  return sample_rate_;
+}
+AudioLevelMeter::Level UnityAudioReceiver::Sink::GetLevel() const {
+  return meter_.GetLevel();
+}
+
+bool UnityAudioReceiver::Sink::SetOutputSampleRate(int sample_rate) {
+  if (sample_rate <= 0 || sample_rate % 100 != 0 ||
+      sample_rate > kMaxSampleRate) {
+    return false;
+  }
+  output_sample_rate_ = sample_rate;
+  return true;
+}
+
+int UnityAudioReceiver::Sink::Pull(float* data,
+                                   int frames,
+                                   int channels,
+                                   int sample_rate) {
+  if (!SetOutputSampleRate(sample_rate)) {
+    std::fill(data, data + (size_t)frames * channels, 0.0f);
+    return 0;
+  }
+  size_t frame = 0;
+  while (frame < (size_t)frames) {
+    size_t n;
+    const int16_t* src = ring_.ReadRegion(&n);
+    n = std::min(n / kChannels, (size_t)frames - frame);
+    if (n == 0) {
+      break;
+    }
+    S16ToFloat(src, n, kChannels, data + frame * channels, channels);
+    ring_.Consume(n * kChannels);
+    frame += n;
+  }
+  if (frame < (size_t)frames) {
+    std::fill(data + frame * channels, data + (size_t)frames * channels,
+              0.0f);
+    underruns_++;
+  }
+  return (int)frame;
+}
+
+void UnityAudioReceiver::Sink::SetSpatial(float gain,
+                                          float pan,
+                                          float distance) {
+  float left;
+  float right;
+  SpatialGains(gain, pan, distance, &left, &right);
+  target_left_gain_ = left;
+  target_right_gain_ = right;
+}
+
+void UnityAudioReceiver::Sink::MixInto(float* dst,
+                                       size_t frames,
+                                       int sample_rate) {
+  if (frames == 0 || !SetOutputSampleRate(sample_rate)) {
+    return;
+  }
+  float left_target = target_left_gain_;
+  float right_target = target_right_gain_;
+  if (!mixed_) {
+    left_gain_ = left_target;
+    right_gain_ = right_target;
+    mixed_ = true;
+  }
+  float left_step = (left_target - left_gain_) / frames;
+  float right_step = (right_target - right_gain_) / frames;
+
+  size_t frame = 0;
+  while (frame < frames) {
+    size_t n;
+    const int16_t* src = ring_.ReadRegion(&n);
+    n = std::min(n / kChannels, frames - frame);
+    if (n == 0) {
+      underruns_++;
+      break;
+    }
+    MixS16Stereo(src, n, left_gain_ + left_step * frame,
+                 right_gain_ + right_step * frame, left_step, right_step,
+                 dst + frame * kChannels);
+    ring_.Consume(n * kChannels);
+    frame += n;
+  }
+  left_gain_ = left_target;
+  right_gain_ = right_target;
+}
+
+// 受信スレッド（再生のために音声が取り出される度）に呼ばれる
+void UnityAudioReceiver::Sink::OnData(const void* audio_data,
+                                      int bits_per_sample,
+                                      int sample_rate,
+                                      size_t number_of_channels,
+                                      size_t number_of_frames) {
+  if (bits_per_sample != 16 || number_of_channels == 0) {
+    return;
+  }
+  sample_rate_ = sample_rate;
+
+  const int16_t* src = (const int16_t*)audio_data;
+  meter_.Process(src, number_of_frames, (int)number_of_channels, sample_rate);
+
+  // 先にステレオにする。
+  // モノラルは両方のチャンネルに、3 チャンネル以上は先頭の 2 チャンネルを入れる
+  if (number_of_channels != kChannels) {
+    size_t size = number_of_frames * kChannels;
+    if (stereo_buf_.size() < size) {
+      stereo_buf_.resize(size);
+    }
+    size_t right = number_of_channels == 1 ? 0 : 1;
+    for (size_t i = 0; i < number_of_frames; i++) {
+      stereo_buf_[i * 2] = src[i * number_of_channels];
+      stereo_buf_[i * 2 + 1] = src[i * number_of_channels + right];
+    }
+    src = stereo_buf_.data();
+  }
+
+  // 取り出す側のサンプリングレートに変換する。
+  // 変換しないと、受信する量と取り出す量がずれて、リングバッファが溢れ続けるか空になる
+  size_t frames = number_of_frames;
+  int output_sample_rate = output_sample_rate_;
+  if (output_sample_rate != 0 && output_sample_rate != sample_rate) {
+    // PushResampler は 10 ミリ秒単位でしか変換できない
+    if (sample_rate % 100 != 0 ||
+        number_of_frames != (size_t)sample_rate / 100 ||
+        resampler_.InitializeIfNeeded(sample_rate, output_sample_rate,
+                                      kChannels) != 0) {
+      return;
+    }
+    int n = resampler_.Resample(src, number_of_frames * kChannels,
+                                resample_buf_.data(), resample_buf_.size());
+    if (n < 0) {
+      return;
+    }
+    src = resample_buf_.data();
+    frames = (size_t)n / kChannels;
+  }
+
+  size_t frame = 0;
+  while (frame < frames) {
+    size_t n;
+    int16_t* dst = ring_.WriteRegion(&n);
+    n = std::min(n / kChannels, frames - frame);
+    if (n == 0) {
+      // Unity が取り出していないので、溢れた分は捨てる
+      overruns_++;
+      return;
+    }
+    const int16_t* s = src + frame * kChannels;
+    std::copy(s, s + n * kChannels, dst);
+    ring_.Commit(n * kChannels);
+    frame += n;
+  }
+}
+
+UnityAudioReceiver::~UnityAudioReceiver() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (const auto& sink : sinks_) {
+    sink->Detach();
+  }
+  sinks_.clear();
+  std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>());
+}
+
+void UnityAudioReceiver::PublishSnapshot() {
+  auto snapshot = std::make_shared<Snapshot>();
+  snapshot->sinks = sinks_;
+  for (const auto& sink : sinks_) {
+    snapshot->by_stream_id[sink->GetStreamId()] = sink;
+  }
+  std::atomic_store(&snapshot_,
+                    std::shared_ptr<const Snapshot>(std::move(snapshot)));
+}
+
+void UnityAudioReceiver::AddTrack(const std::string& stream_id,
+                                  webrtc::AudioTrackInterface* track) {
+  RTC_LOG(LS_INFO) << "UnityAudioReceiver::AddTrack: stream_id=" << stream_id;
+  std::shared_ptr<Sink> sink(new Sink(stream_id, track));
+  std::lock_guard<std::mutex> guard(mutex_);
+  // 同じストリームのトラックは新しい方に置き換える
+  auto it = std::partition(sinks_.begin(), sinks_.end(),
+                           [&stream_id](const std::shared_ptr<Sink>& sink) {
+                             return sink->GetStreamId() != stream_id;
+                           });
+  std::for_each(it, sinks_.end(),
+                [](const std::shared_ptr<Sink>& sink) { sink->Detach(); });
+  sinks_.erase(it, sinks_.end());
+  sinks_.push_back(sink);
+  PublishSnapshot();
+}
+
+void UnityAudioReceiver::RemoveTrack(webrtc::AudioTrackInterface* track) {
+  std::lock_guard<std::mutex> guard(mutex_);
+  // スナップショットから外す前に、ここ（signaling スレッド）でトラックから外しておく。
+  // Sink の最後の参照は Unity のオーディオスレッドで手放されることがあるので、
+  // デストラクタではトラックに触らない。
+  auto it = std::partition(sinks_.begin(), sinks_.end(),
+                           [track](const std::shared_ptr<Sink>& sink) {
+                             return sink->GetTrack() != track;
+                           });
+  std::for_each(it, sinks_.end(),
+                [](const std::shared_ptr<Sink>& sink) { sink->Detach(); });
+  sinks_.erase(it, sinks_.end());
+  PublishSnapshot();
+}
+
+void UnityAudioReceiver::EnumLevels(
+    std::function<void(const std::string&, const AudioLevelMeter::Level&)> f) {
+  auto snapshot = std::atomic_load(&snapshot_);
+  if (snapshot == nullptr) {
+    return;
+  }
+  for (const auto& sink : snapshot->sinks) {
+    f(sink->GetStreamId(), sink->GetLevel());
+  }
+}
+
+void UnityAudioReceiver::EnumStreams(
+    std::function<void(const std::string&)> f) {
+  auto snapshot = std::atomic_load(&snapshot_);
+  if (snapshot == nullptr) {
+    return;
+  }
+  for (const auto& sink : snapshot->sinks) {
+    f(sink->GetStreamId());
+  }
+}
+
+void UnityAudioReceiver::Mix(float* data,
+                             int frames,
+                             int channels,
+                             int sample_rate) {
+  if (frames <= 0) {
+    return;
+  }
+  size_t size = (size_t)frames * 2;
+  if (mix_buf_.size() < size) {
+    mix_buf_.resize(size);
+  }
+  std::fill(mix_buf_.begin(), mix_buf_.begin() + size, 0.0f);
+  // 削除されたトラックの Sink も、このスナップショットを使い終わるまでは有効
+  auto snapshot = std::atomic_load(&snapshot_);
+  if (snapshot != nullptr) {
+    for (const auto& sink : snapshot->sinks) {
+      sink->MixInto(mix_buf_.data(), frames, sample_rate);
+    }
+  }
+  if (channels == 2) {
+    std::copy(mix_buf_.begin(), mix_buf_.begin() + size, data);
+    return;
+  }
+  for (int i = 0; i < frames; i++) {
+    float left = mix_buf_[i * 2];
+    float right = mix_buf_[i * 2 + 1];
+    float* d = data + (size_t)i * channels;
+    if (channels == 1) {
+      d[0] = (left + right) * 0.5f;
+      continue;
+    }
+    d[0] = left;
+    d[1] = right;
+    std::fill(d + 2, d + channels, 0.0f);
+  }
+}
+
+std::shared_ptr<UnityAudioReceiver::Sink> UnityAudioReceiver::GetSink(
+    const std::string& stream_id) {
+  auto snapshot = std::atomic_load(&snapshot_);
+  if (snapshot == nullptr) {
+    return nullptr;
+  }
+  auto it = snapshot->by_stream_id.find(stream_id);
+  return it == snapshot->by_stream_id.end() ? nullptr : it->second;
+}
+
+}  // namespace sora
@@ -0,0 +1,134 @@
+#ifndef SORA_UNITY_AUDIO_RECEIVER_H_INCLUDED
+#define SORA_UNITY_AUDIO_RECEIVER_H_INCLUDED
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// webrtc
+#include "api/media_stream_interface.h"
+#include "common_audio/resampler/include/push_resampler.h"
+
+// sora
+#include "audio_level_meter.h"
+#include "audio_ring_buffer.h"
+#include "rtc/audio_track_receiver.h"
+
+namespace sora {
+
+// 受信した音声トラックを、WebRTC のミキサーを通さずにストリーム毎に取り出す。
+//
+// 各トラックの AudioTrackSinkInterface でデコード済みの音声を受け取り、
+// 取り出す側のサンプリングレートに変換してストリーム毎のリングバッファに溜めておく。
+// Unity は Pull でそれぞれの AudioSource に取り出す。
+class UnityAudioReceiver : public AudioTrackReceiver {
+ public:
+  class Sink : public webrtc::AudioTrackSinkInterface {
+   public:
+    Sink(std::string stream_id, webrtc::AudioTrackInterface* track);
+    // トラックから外して、トラックへの参照を手放す。
+    // signaling スレッドから、スナップショットから外す前に呼ぶこと。
+    void Detach();
+    const std::string& GetStreamId() const;
+    webrtc::AudioTrackInterface* GetTrack() const;
+    // 受信した音声のサンプリングレート
+    int GetSampleRate() const;
+    AudioLevelMeter::Level GetLevel() const;
+    // 溜まっている音声を frames サンプル分取り出す。
+    // 足りない分は無音で埋めて、取り出せたサンプル数を返す。
+    // 受信した音声は次の OnData から sample_rate に変換して溜める。
+    // sample_rate は 100 の倍数で kMaxSampleRate 以下であること。
+    int Pull(float* data, int frames, int channels, int sample_rate);
+
+    // Mix で使うパラメータを設定する。
+    // gain は音量、pan は -1.0（左）〜 1.0（右）、distance は聞き手からの距離。
+    void SetSpatial(float gain, float pan, float distance);
+    // 溜まっている音声を sample_rate で frames サンプル分、ステレオの dst に足し込む。
+    // ゲインは前回の Mix の値から設定値まで frames サンプルかけて変化させる。
+    void MixInto(float* dst, size_t frames, int sample_rate);
+
+    void OnData(const void* audio_data,
+                int bits_per_sample,
+                int sample_rate,
+                size_t number_of_channels,
+                size_t number_of_frames) override;
+
+    static const int kMaxSampleRate = 96000;
+
+   private:
+    bool SetOutputSampleRate(int sample_rate);
+
+    // リングバッファには常にステレオで入れる
+    static const int kChannels = 2;
+    static const int kBufferMs = 500;
+
+    std::string stream_id_;
+    // signaling スレッドからのみ触る。Detach の後は nullptr
+    rtc::scoped_refptr<webrtc::AudioTrackInterface> track_;
+    AudioRingBuffer ring_;
+    AudioLevelMeter meter_;
+    std::atomic<int> sample_rate_ = {0};
+    // 取り出す側のサンプリングレート。0 なら変換しない
+    std::atomic<int> output_sample_rate_ = {0};
+    // 以下は OnData からのみ触る
+    webrtc::PushResampler<int16_t> resampler_;
+    std::vector<int16_t> stereo_buf_;
+    std::vector<int16_t> resample_buf_;
+    std::atomic<int64_t> overruns_ = {0};
+    std::atomic<int64_t> underruns_ = {0};
+
+    // SetSpatial で設定された左右のゲイン
+    std::atomic<float> target_left_gain_;
+    std::atomic<float> target_right_gain_;
+    // 以下は MixInto からのみ触る
+    bool mixed_ = false;
+    float left_gain_ = 0.0f;
+    float right_gain_ = 0.0f;
+  };
+
+  ~UnityAudioReceiver();
+
+  void AddTrack(const std::string& stream_id,
+                webrtc::AudioTrackInterface* track) override;
+  void RemoveTrack(webrtc::AudioTrackInterface* track) override;
+
+  void EnumStreams(std::function<void(const std::string&)> f);
+  // 各ストリームの音声レベルを列挙する。
+  // ロックを取らずにスナップショットから読むので、毎フレーム呼んでも音声の処理を妨げない
+  void EnumLevels(
+      std::function<void(const std::string&, const AudioLevelMeter::Level&)>
+          f);
+  // 返した Sink は、トラックが削除されても使い終わるまで有効。
+  // ロックを取らないので、Unity のオーディオスレッドから呼び出せる
+  std::shared_ptr<Sink> GetSink(const std::string& stream_id);
+  // 全ストリームの音声を SetSpatial の設定で混ぜて、sample_rate で data に書き込む。
+  // frames は 1 チャンネルあたりのサンプル数。
+  // Mix で取り出したストリームは Pull で取り出さないこと。
+  // ロックを取らないので、Unity のオーディオスレッドで AddTrack/RemoveTrack を待つことは無い。
+  void Mix(float* data, int frames, int channels, int sample_rate);
+
+ private:
+  // ある時点の Sink の一覧。作った後は変更しないので、読む側はロック無しで使える。
+  // AddTrack/RemoveTrack の度に PublishSnapshot で丸ごと差し替える
+  struct Snapshot {
+    std::vector<std::shared_ptr<Sink>> sinks;
+    std::unordered_map<std::string, std::shared_ptr<Sink>> by_stream_id;
+  };
+  // mutex_ を取ったまま呼ぶこと
+  void PublishSnapshot();
+
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<Sink>> sinks_;
+  // std::atomic_load/atomic_store でのみ触る
+  std::shared_ptr<const Snapshot> snapshot_;
+  // Mix の作業用のバッファ（Unity のオーディオスレッドからのみ触る）
+  std::vector<float> mix_buf_;
+};
+
+}  // namespace sora
+
+#endif  // SORA_UNITY_AUDIO_RECEIVER_H_INCLUDED
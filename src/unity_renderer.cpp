@@ -1,12 +1,110 @@
 #include "unity_renderer.h"
 
+#include <algorithm>
+#include <limits>
+
 #include <rtc_base/logging.h>
+#include <rtc_base/time_utils.h>
 
 namespace sora {
 
+// UnityRenderer::Sink::ConvertedFrames
+
+struct UnityRenderer::Sink::ConvertedFrames {
+  struct Image {
+    std::unique_ptr<uint8_t[]> data;
+    size_t size = 0;
+    int width = 0;
+    int height = 0;
+    uint64_t frame_counter = 0;
+  };
+  static const uint8_t kIndexMask = 0x3;
+  static const uint8_t kFresh = 0x4;
+
+  // 3 枚のうち back はワーカースレッド、front はレンダースレッドが所有していて、
+  // 残りの 1 枚（middle）を atomic に交換して受け渡す。
+  // middle に kFresh が立っていれば、まだレンダースレッドが受け取っていない新しい画像。
+  Image images[3];
+  int back = 0;
+  int front = 1;
+  std::atomic<uint8_t> middle = {2};
+
+  // 変換先のテクスチャサイズ。レンダースレッドが書いてワーカースレッドが読む
+  std::atomic<int> texture_width = {0};
+  std::atomic<int> texture_height = {0};
+
+  // 変換待ちのフレーム。変換が追いつかない場合は最新のフレーム以外は捨てる
+  std::mutex mutex;
+  rtc::scoped_refptr<webrtc::VideoFrameBuffer> pending;
+  uint64_t pending_frame_counter = 0;
+  bool convert_posted = false;
+
+  // ワーカースレッドからのみ触る
+  TextureConverter converter;
+
+  // 変換待ちのフレームを登録する。ワーカースレッドにタスクを投げる必要があれば true
+  bool SetPending(rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame,
+                  uint64_t frame_counter) {
+    std::lock_guard<std::mutex> guard(mutex);
+    pending = frame;
+    pending_frame_counter = frame_counter;
+    if (convert_posted) {
+      return false;
+    }
+    convert_posted = true;
+    return true;
+  }
+
+  // ワーカースレッドから呼ばれる
+  void Convert() {
+    rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame;
+    uint64_t frame_counter;
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      frame = pending;
+      frame_counter = pending_frame_counter;
+      pending = nullptr;
+      convert_posted = false;
+    }
+    int width = texture_width;
+    int height = texture_height;
+    if (!frame || width <= 0 || height <= 0) {
+      return;
+    }
+
+    Image& image = images[back];
+    size_t size = (size_t)width * height * 4;
+    if (image.size != size) {
+      image.data.reset(new uint8_t[size]);
+      image.size = size;
+    }
+    converter.ConvertToABGR(*frame->ToI420(), image.data.get(), width * 4,
+                            width, height);
+    image.width = width;
+    image.height = height;
+    image.frame_counter = frame_counter;
+    back = middle.exchange(back | kFresh) & kIndexMask;
+  }
+
+  // レンダースレッドから呼ばれる。
+  // 変換済みの最新の画像を返す。まだ 1 枚も無ければ nullptr
+  const Image* Acquire() {
+    if (middle.load() & kFresh) {
+      front = middle.exchange(front) & kIndexMask;
+    }
+    const Image& image = images[front];
+    return image.data ? &image : nullptr;
+  }
+};
+
 // UnityRenderer::Sink
 
-UnityRenderer::Sink::Sink(webrtc::VideoTrackInterface* track) : track_(track) {
+UnityRenderer::Sink::Sink(webrtc::VideoTrackInterface* track,
+                          rtc::Thread* worker_thread)
+    : track_(track),
+      worker_thread_(worker_thread),
+      converted_(std::make_shared<ConvertedFrames>()),
+      remote_(track->GetSource()->remote()) {
   ptrid_ = IdPointer::Instance().Register(this);
   track_->AddOrUpdateSink(this, rtc::VideoSinkWants());
 }
@@ -16,19 +114,137 @@ UnityRenderer::Sink::~Sink() {
 ptrid_t UnityRenderer::Sink::GetSinkID() const {
   return ptrid_;
 }
+int UnityRenderer::Sink::GetTextureUpdateTimeUs() const {
+  return texture_update_time_us_;
+}
+uint64_t UnityRenderer::Sink::GetFrameCounter() const {
+  return frame_counter_;
+}
+int64_t UnityRenderer::Sink::GetPlaneBytesCopied() const {
+  return plane_bytes_copied_;
+}
+
+uint64_t UnityRenderer::Sink::PackViewport(const Viewport& v) {
+  return ((uint64_t)(uint32_t)v.width << 40) |
+         ((uint64_t)(uint32_t)v.height << 16) | (uint64_t)(uint16_t)v.max_fps;
+}
+UnityRenderer::Sink::Viewport UnityRenderer::Sink::UnpackViewport(
+    uint64_t v) {
+  Viewport viewport;
+  viewport.width = (int)((v >> 40) & 0xffffff);
+  viewport.height = (int)((v >> 16) & 0xffffff);
+  viewport.max_fps = (int)(v & 0xffff);
+  return viewport;
+}
+
+// Unity 側で表示しているサイズとフレームレートを設定する。
+// width, height が 0 以下なら制限を解除する。
+// 書き込むのは signaling スレッドだけなので、比較してから書いても競合しない
+void UnityRenderer::Sink::SetViewport(int width, int height, int max_fps) {
+  // ローカルの映像はエンコードにも使っているので制限しない
+  if (!remote_) {
+    return;
+  }
+  if (width <= 0 || height <= 0) {
+    width = 0;
+    height = 0;
+  }
+  Viewport viewport;
+  viewport.width = std::min(width, 0xffffff);
+  viewport.height = std::min(height, 0xffffff);
+  viewport.max_fps = std::min(std::max(max_fps, 0), 0xffff);
+  uint64_t packed = PackViewport(viewport);
+  if (packed == viewport_.load()) {
+    return;
+  }
+  viewport_ = packed;
+  width = viewport.width;
+  height = viewport.height;
+  max_fps = viewport.max_fps;
+
+  rtc::VideoSinkWants wants;
+  if (width > 0) {
+    wants.max_pixel_count = (int)std::min<int64_t>(
+        (int64_t)width * height, std::numeric_limits<int>::max());
+  }
+  if (max_fps > 0) {
+    wants.max_framerate_fps = max_fps;
+  }
+  track_->AddOrUpdateSink(this, wants);
+}
 
 rtc::scoped_refptr<webrtc::VideoFrameBuffer>
-UnityRenderer::Sink::GetFrameBuffer() {
+UnityRenderer::Sink::GetFrameBuffer(uint64_t* frame_counter) {
   std::lock_guard<std::mutex> guard(mutex_);
+  *frame_counter = frame_counter_;
   return frame_buffer_;
 }
-void UnityRenderer::Sink::SetFrameBuffer(
+uint64_t UnityRenderer::Sink::SetFrameBuffer(
     rtc::scoped_refptr<webrtc::VideoFrameBuffer> v) {
   std::lock_guard<std::mutex> guard(mutex_);
   frame_buffer_ = v;
+  return ++frame_counter_;
+}
+
+// max_fps を超えるペースで届いたフレームは捨てる
+bool UnityRenderer::Sink::DropFrame(const webrtc::VideoFrame& frame) {
+  int max_fps = UnpackViewport(viewport_.load()).max_fps;
+  if (max_fps <= 0) {
+    return false;
+  }
+  // タイムスタンプの揺らぎで必要なフレームまで捨てないように、間隔は少し短めに見る
+  int64_t interval_us = rtc::kNumMicrosecsPerSec / max_fps;
+  int64_t timestamp_us = frame.timestamp_us();
+  if (last_frame_time_us_ != 0 && timestamp_us >= last_frame_time_us_ &&
+      timestamp_us - last_frame_time_us_ < interval_us - interval_us / 10) {
+    return true;
+  }
+  last_frame_time_us_ = timestamp_us;
+  return false;
+}
+
+// 表示サイズより大きいフレームは、アスペクト比を保ったまま表示サイズに収まるように縮小する
+rtc::scoped_refptr<webrtc::VideoFrameBuffer>
+UnityRenderer::Sink::ScaleToViewport(
+    rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame_buffer) {
+  Viewport viewport = UnpackViewport(viewport_.load());
+  int viewport_width = viewport.width;
+  int viewport_height = viewport.height;
+  if (viewport_width <= 0 || viewport_height <= 0) {
+    return frame_buffer;
+  }
+  int width = frame_buffer->width();
+  int height = frame_buffer->height();
+  if (width <= viewport_width && height <= viewport_height) {
+    return frame_buffer;
+  }
+  int scaled_width;
+  int scaled_height;
+  if ((int64_t)width * viewport_height > (int64_t)height * viewport_width) {
+    scaled_width = viewport_width;
+    scaled_height = (int)((int64_t)height * viewport_width / width);
+  } else {
+    scaled_height = viewport_height;
+    scaled_width = (int)((int64_t)width * viewport_height / height);
+  }
+  scaled_width = std::max(scaled_width & ~1, 2);
+  scaled_height = std::max(scaled_height & ~1, 2);
+
+  // プールから取り出すので、サイズが変わらない限りメモリ確保は発生しない
+  rtc::scoped_refptr<webrtc::I420Buffer> scaled =
+      scaled_pool_.CreateBuffer(scaled_width, scaled_height);
+  if (!scaled) {
+    return frame_buffer;
+  }
+  scaled->ScaleFrom(*frame_buffer->ToI420());
+  return scaled;
 }
 
 void UnityRenderer::Sink::OnFrame(const webrtc::VideoFrame& frame) {
+  if (DropFrame(frame)) {
+    return;
+  }
+
   rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame_buffer =
       frame.video_frame_buffer();
 
@@ -38,7 +254,67 @@ void UnityRenderer::Sink::OnFrame(const webrtc::VideoFrame& frame) {
     frame_buffer = frame_buffer->ToI420();
   }
 
-  SetFrameBuffer(frame_buffer);
+  // 小さく表示している映像は、ここで縮小しておけば以降の変換や転送も軽くなる
+  frame_buffer = ScaleToViewport(frame_buffer);
+
+  uint64_t frame_counter = SetFrameBuffer(frame_buffer);
+
+  // テクスチャサイズが分かっていれば、ワーカースレッドで先に変換しておく
+  if (converted_->texture_width > 0 &&
+      converted_->SetPending(frame_buffer, frame_counter)) {
+    auto converted = converted_;
+    worker_thread_->PostTask(RTC_FROM_HERE,
+                             [converted]() { converted->Convert(); });
+  }
+}
+
+// テクスチャに書き込む ABGR 画像を返す。
+// 前回書き込んだフレームから変化が無ければ nullptr を返して、変換と転送を省く。
+uint8_t* UnityRenderer::Sink::UpdateTexture(intptr_t texture_id,
+                                            int width,
+                                            int height) {
+  converted_->texture_width = width;
+  converted_->texture_height = height;
+
+  bool same_texture = texture_id == uploaded_texture_id_ &&
+                      width == uploaded_width_ && height == uploaded_height_;
+
+  // ワーカースレッドで変換済みの画像があればそれを渡すだけで済む
+  auto image = converted_->Acquire();
+  if (image != nullptr && image->width == width && image->height == height) {
+    if (same_texture && image->frame_counter <= uploaded_frame_counter_) {
+      return nullptr;
+    }
+    uploaded_frame_counter_ = image->frame_counter;
+    uploaded_texture_id_ = texture_id;
+    uploaded_width_ = width;
+    uploaded_height_ = height;
+    return image->data.get();
+  }
+
+  // まだ変換されていない場合やテクスチャサイズが変わった場合はここで変換する
+  uint64_t frame_counter;
+  auto video_frame_buffer = GetFrameBuffer(&frame_counter);
+  if (!video_frame_buffer) {
+    return nullptr;
+  }
+  if (same_texture && frame_counter == uploaded_frame_counter_) {
+    return nullptr;
+  }
+  // テクスチャ用のバッファは Sink ごとに使い回す
+  size_t size = (size_t)width * height * 4;
+  if (temp_buf_size_ != size) {
+    temp_buf_.reset(new uint8_t[size]);
+    temp_buf_size_ = size;
+  }
+  // スケーリングした行をそのまま ABGR に変換するので、中間フレームは作らない
+  converter_.ConvertToABGR(*video_frame_buffer->ToI420(), temp_buf_.get(),
+                           width * 4, width, height);
+  uploaded_frame_counter_ = frame_counter;
+  uploaded_texture_id_ = texture_id;
+  uploaded_width_ = width;
+  uploaded_height_ = height;
+  return temp_buf_.get();
 }
 
 void UnityRenderer::Sink::TextureUpdateCallback(int eventID, void* data) {
@@ -47,44 +323,113 @@ void UnityRenderer::Sink::TextureUpdateCallback(int eventID, void* data) {
   if (event == kUnityRenderingExtEventUpdateTextureBeginV2) {
     auto params =
         reinterpret_cast<UnityRenderingExtTextureUpdateParamsV2*>(data);
-    Sink* p = (Sink*)IdPointer::Instance().Lookup(params->userData);
+    // ピン留めしている間は Sink が破棄されない
+    auto pinned = IdPointer::Instance().Lookup(params->userData);
+    Sink* p = (Sink*)pinned.get();
     if (p == nullptr) {
       return;
     }
-    auto video_frame_buffer = p->GetFrameBuffer();
-    if (!video_frame_buffer) {
-      return;
-    }
 
     // UpdateTextureBegin: Generate and return texture image data.
-    rtc::scoped_refptr<webrtc::I420Buffer> i420_buffer =
-        webrtc::I420Buffer::Create(params->width, params->height);
-    i420_buffer->ScaleFrom(*video_frame_buffer->ToI420());
-    delete[] p->temp_buf_;
-    p->temp_buf_ = new uint8_t[params->width * params->height * 4];
-    libyuv::I420ToABGR(
-        i420_buffer->DataY(), i420_buffer->StrideY(), i420_buffer->DataU(),
-        i420_buffer->StrideU(), i420_buffer->DataV(), i420_buffer->StrideV(),
-        p->temp_buf_, params->width * 4, params->width, params->height);
-    params->texData = p->temp_buf_;
+    // texData が nullptr のままならテクスチャは更新されない
+    int64_t start_us = rtc::TimeMicros();
+    params->texData =
+        p->UpdateTexture(params->textureID, params->width, params->height);
+    int elapsed_us = (int)(rtc::TimeMicros() - start_us);
+    p->texture_update_time_us_ =
+        (p->texture_update_time_us_ * 7 + elapsed_us) / 8;
   } else if (event == kUnityRenderingExtEventUpdateTextureEndV2) {
+    // 渡したバッファは次のフレームで再利用するのでここでは解放しない
+  }
+}
+
+// plane のテクスチャに書き込むデータを返す。
+// 前回書き込んだフレームから変化が無ければ nullptr を返す。
+const uint8_t* UnityRenderer::Sink::UpdatePlaneTexture(TexturePlane plane,
+                                                       intptr_t texture_id,
+                                                       int width,
+                                                       int height) {
+  if (plane == TexturePlane::Y || !planar_frame_) {
+    uint64_t frame_counter;
+    auto video_frame_buffer = GetFrameBuffer(&frame_counter);
+    if (!video_frame_buffer) {
+      return nullptr;
+    }
+    if (frame_counter != planar_frame_counter_) {
+      planar_frame_ = video_frame_buffer->ToI420();
+      planar_frame_counter_ = frame_counter;
+    }
+  }
+
+  PlaneUpload& uploaded = uploaded_planes_[(int)plane];
+  if (uploaded.frame_counter == planar_frame_counter_ &&
+      uploaded.texture_id == texture_id && uploaded.width == width &&
+      uploaded.height == height) {
+    return nullptr;
+  }
+
+  size_t bytes_copied;
+  const uint8_t* data = converter_.ExtractPlane(
+      *planar_frame_->GetI420(), plane, width, height, &bytes_copied);
+  plane_bytes_copied_ += bytes_copied;
+
+  uploaded.frame_counter = planar_frame_counter_;
+  uploaded.texture_id = texture_id;
+  uploaded.width = width;
+  uploaded.height = height;
+  return data;
+}
+
+void UnityRenderer::Sink::PlaneTextureUpdateCallback(TexturePlane plane,
+                                                     int eventID,
+                                                     void* data) {
+  auto event = static_cast<UnityRenderingExtEventType>(eventID);
+
+  if (event == kUnityRenderingExtEventUpdateTextureBeginV2) {
     auto params =
         reinterpret_cast<UnityRenderingExtTextureUpdateParamsV2*>(data);
-    Sink* p = (Sink*)IdPointer::Instance().Lookup(params->userData);
+    auto pinned = IdPointer::Instance().Lookup(params->userData);
+    Sink* p = (Sink*)pinned.get();
     if (p == nullptr) {
       return;
     }
-    delete[] p->temp_buf_;
-    p->temp_buf_ = nullptr;
+    // planar_frame_ は次の Y の更新まで保持しているので、
+    // コピーせずに渡したメモリは UpdateTextureEnd まで有効
+    params->texData = const_cast<uint8_t*>(p->UpdatePlaneTexture(
+        plane, params->textureID, params->width, params->height));
   }
 }
 
+void UnityRenderer::Sink::TextureUpdateCallbackY(int eventID, void* data) {
+  PlaneTextureUpdateCallback(TexturePlane::Y, eventID, data);
+}
+void UnityRenderer::Sink::TextureUpdateCallbackU(int eventID, void* data) {
+  PlaneTextureUpdateCallback(TexturePlane::U, eventID, data);
+}
+void UnityRenderer::Sink::TextureUpdateCallbackV(int eventID, void* data) {
+  PlaneTextureUpdateCallback(TexturePlane::V, eventID, data);
+}
+void UnityRenderer::Sink::TextureUpdateCallbackUV(int eventID, void* data) {
+  PlaneTextureUpdateCallback(TexturePlane::UV, eventID, data);
+}
+
 UnityRenderer::UnityRenderer(std::function<void(ptrid_t)> on_add_track,
                              std::function<void(ptrid_t)> on_remove_track)
-    : on_add_track_(on_add_track), on_remove_track_(on_remove_track) {}
+    : on_add_track_(on_add_track), on_remove_track_(on_remove_track) {
+  for (int i = 0; i < kWorkerThreads; i++) {
+    std::unique_ptr<rtc::Thread> thread = rtc::Thread::Create();
+    thread->SetName("Sora Renderer Thread", nullptr);
+    thread->Start();
+    worker_threads_.push_back(std::move(thread));
+  }
+}
 
 void UnityRenderer::AddTrack(webrtc::VideoTrackInterface* track) {
-  std::unique_ptr<Sink> sink(new Sink(track));
+  // 各 Sink の変換はワーカースレッドに順番に割り当てる
+  rtc::Thread* worker_thread = worker_threads_[next_worker_].get();
+  next_worker_ = (next_worker_ + 1) % kWorkerThreads;
+
+  std::unique_ptr<Sink> sink(new Sink(track, worker_thread));
   auto sink_id = sink->GetSinkID();
   sinks_.push_back(std::make_pair(track, std::move(sink)));
   on_add_track_(sink_id);
@@ -103,4 +448,17 @@ void UnityRenderer::RemoveTrack(webrtc::VideoTrackInterface* track) {
   on_remove_track_(sink_id);
 }
 
+void UnityRenderer::SetViewport(ptrid_t sink_id,
+                                int width,
+                                int height,
+                                int max_fps) {
+  // 既に RemoveTrack された Sink なら見つからないので何もしない
+  for (auto& sink : sinks_) {
+    if (sink.second->GetSinkID() == sink_id) {
+      sink.second->SetViewport(width, height, max_fps);
+      return;
+    }
+  }
+}
+
 }  // namespace sora
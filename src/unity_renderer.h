@@ -1,13 +1,20 @@
 #ifndef SORA_UNITY_RENDERER_H_INCLUDED
 #define SORA_UNITY_RENDERER_H_INCLUDED
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 // webrtc
 #include "api/video/i420_buffer.h"
+#include "common_video/include/i420_buffer_pool.h"
 #include "libyuv.h"
+#include "rtc_base/thread.h"
 
 // sora
 #include "id_pointer.h"
 #include "rtc/video_track_receiver.h"
+#include "texture_converter.h"
 #include "unity/IUnityRenderingExtensions.h"
 
 namespace sora {
@@ -15,31 +22,111 @@ namespace sora {
 class UnityRenderer : public VideoTrackReceiver {
  public:
   class Sink : public rtc::VideoSinkInterface<webrtc::VideoFrame> {
+    // ワーカースレッドで変換した ABGR 画像を受け渡すためのトリプルバッファ
+    struct ConvertedFrames;
+
     webrtc::VideoTrackInterface* track_;
     ptrid_t ptrid_;
     std::mutex mutex_;
     rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame_buffer_;
-    uint8_t* temp_buf_ = nullptr;
+    // OnFrame で受け取ったフレームの通し番号
+    std::atomic<uint64_t> frame_counter_ = {0};
+    rtc::Thread* worker_thread_;
+    std::shared_ptr<ConvertedFrames> converted_;
+
+    // 受信映像の場合、Unity 側で表示しているサイズとフレームレート。
+    // これを超える映像は OnFrame で縮小・間引きする。0 なら制限しない。
+    // 幅・高さ・フレームレートが食い違わないように、1 つの値に詰めて保持する
+    struct Viewport {
+      int width;
+      int height;
+      int max_fps;
+    };
+    static uint64_t PackViewport(const Viewport& v);
+    static Viewport UnpackViewport(uint64_t v);
+    bool remote_;
+    std::atomic<uint64_t> viewport_ = {0};
+    // 以下は OnFrame からのみ触る
+    webrtc::I420BufferPool scaled_pool_;
+    int64_t last_frame_time_us_ = 0;
+
+    // 以下は TextureUpdateCallback（レンダースレッド）からのみ触る。
+    // テクスチャサイズが変わらない限り、毎フレームのメモリ確保は発生しない。
+    TextureConverter converter_;
+    std::unique_ptr<uint8_t[]> temp_buf_;
+    size_t temp_buf_size_ = 0;
+    // 最後にテクスチャに書き込んだフレームとテクスチャ
+    uint64_t uploaded_frame_counter_ = 0;
+    intptr_t uploaded_texture_id_ = 0;
+    int uploaded_width_ = 0;
+    int uploaded_height_ = 0;
+
+    // プレーン毎にテクスチャを更新する場合に使うフレーム。
+    // Y, U, V で別のフレームを使ってしまわないように、Y の更新時に最新のフレームに切り替える
+    struct PlaneUpload {
+      uint64_t frame_counter = 0;
+      intptr_t texture_id = 0;
+      int width = 0;
+      int height = 0;
+    };
+    rtc::scoped_refptr<webrtc::VideoFrameBuffer> planar_frame_;
+    uint64_t planar_frame_counter_ = 0;
+    PlaneUpload uploaded_planes_[kTexturePlaneCount];
+    std::atomic<int64_t> plane_bytes_copied_ = {0};
+
+    // TextureUpdateCallback でレンダースレッドが使った時間（マイクロ秒、移動平均）
+    std::atomic<int> texture_update_time_us_ = {0};
 
    public:
-    Sink(webrtc::VideoTrackInterface* track);
+    Sink(webrtc::VideoTrackInterface* track, rtc::Thread* worker_thread);
     ~Sink();
     ptrid_t GetSinkID() const;
+    int GetTextureUpdateTimeUs() const;
+    uint64_t GetFrameCounter() const;
+    int64_t GetPlaneBytesCopied() const;
+    // signaling スレッドから呼ぶこと
+    void SetViewport(int width, int height, int max_fps);
 
    private:
-    rtc::scoped_refptr<webrtc::VideoFrameBuffer> GetFrameBuffer();
-    void SetFrameBuffer(rtc::scoped_refptr<webrtc::VideoFrameBuffer> v);
+    rtc::scoped_refptr<webrtc::VideoFrameBuffer> GetFrameBuffer(
+        uint64_t* frame_counter);
+    uint64_t SetFrameBuffer(rtc::scoped_refptr<webrtc::VideoFrameBuffer> v);
+    bool DropFrame(const webrtc::VideoFrame& frame);
+    rtc::scoped_refptr<webrtc::VideoFrameBuffer> ScaleToViewport(
+        rtc::scoped_refptr<webrtc::VideoFrameBuffer> frame_buffer);
+    uint8_t* UpdateTexture(intptr_t texture_id, int width, int height);
+    const uint8_t* UpdatePlaneTexture(TexturePlane plane,
+                                      intptr_t texture_id,
+                                      int width,
+                                      int height);
+    static void PlaneTextureUpdateCallback(TexturePlane plane,
+                                           int eventID,
+                                           void* data);
 
    public:
     void OnFrame(const webrtc::VideoFrame& frame) override;
     static void UNITY_INTERFACE_API TextureUpdateCallback(int eventID,
                                                           void* data);
+    // 各プレーンを 1 枚ずつテクスチャに書き込むためのコールバック
+    static void UNITY_INTERFACE_API TextureUpdateCallbackY(int eventID,
+                                                           void* data);
+    static void UNITY_INTERFACE_API TextureUpdateCallbackU(int eventID,
+                                                           void* data);
+    static void UNITY_INTERFACE_API TextureUpdateCallbackV(int eventID,
+                                                           void* data);
+    static void UNITY_INTERFACE_API TextureUpdateCallbackUV(int eventID,
+                                                            void* data);
   };
 
  private:
+  // 受信映像の変換を行うワーカースレッドの数
+  static const int kWorkerThreads = 2;
+
   typedef std::vector<
       std::pair<webrtc::VideoTrackInterface*, std::unique_ptr<Sink>>>
       VideoSinkVector;
+  std::vector<std::unique_ptr<rtc::Thread>> worker_threads_;
+  int next_worker_ = 0;
   VideoSinkVector sinks_;
   std::function<void(ptrid_t)> on_add_track_;
   std::function<void(ptrid_t)> on_remove_track_;
@@ -50,6 +137,9 @@ class UnityRenderer : public VideoTrackReceiver {
 
   void AddTrack(webrtc::VideoTrackInterface* track) override;
   void RemoveTrack(webrtc::VideoTrackInterface* track) override;
+  // sink_id の Sink の表示サイズを設定する。
+  // 受信トラックの AddTrack/RemoveTrack と同じく signaling スレッドから呼ぶこと
+  void SetViewport(ptrid_t sink_id, int width, int height, int max_fps);
 };
 
 }  // namespace sora
@@ -0,0 +1,46 @@
+#ifndef SORA_TEST_ALLOC_COUNTER_H_INCLUDED
+#define SORA_TEST_ALLOC_COUNTER_H_INCLUDED
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+// operator new を置き換えて、確保の回数を数える。
+// 1 つの実行ファイルの 1 つの翻訳単位からだけ include すること。
+namespace sora {
+namespace test {
+
+inline std::atomic<int64_t>& AllocationCount() {
+  static std::atomic<int64_t> count(0);
+  return count;
+}
+
+}  // namespace test
+}  // namespace sora
+
+void* operator new(size_t size) {
+  sora::test::AllocationCount()++;
+  void* p = malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+void operator delete(void* p) noexcept {
+  free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+  free(p);
+}
+
+#endif  // SORA_TEST_ALLOC_COUNTER_H_INCLUDED
@@ -0,0 +1,67 @@
+// Unity から受け取った float の音声を int16 にしてリングに積み、
+// 10ms 単位で取り出す（UnityAudioDevice::ProcessAudioData と同じ流れ）のベンチマーク
+#include <stdio.h>
+#include <vector>
+
+#include "alloc_counter.h"
+#include "audio_ring_buffer.h"
+#include "audio_util.h"
+#include "test_util.h"
+
+int main() {
+  const int kSampleRate = 48000;
+  const int kChannels = 2;
+  const size_t kChunk = kSampleRate / 100 * kChannels;
+  // Unity の OnAudioFilterRead は 1024 フレーム単位で呼ばれることが多い
+  const size_t kUnityBlock = 1024 * kChannels;
+  const int kIterations = 20000;
+
+  std::vector<float> input(kUnityBlock);
+  for (size_t i = 0; i < input.size(); i++) {
+    input[i] = (float)((int)(i * 37 % 2000) - 1000) / 1000.0f;
+  }
+  std::vector<int16_t> converted(kUnityBlock);
+
+  double ns = sora::test::MeasureNanos(kIterations, [&]() {
+    sora::FloatToS16(input.data(), input.size(), converted.data());
+  });
+  printf("FloatToS16:            %8.3f ns/sample\n", ns / kUnityBlock);
+
+  sora::AudioRingBuffer ring;
+  ring.Reset(kChunk * 8);
+  int64_t chunks = 0;
+  int64_t checksum = 0;
+  auto ingest = [&]() {
+    // 書き込み側: 空いている領域に直接変換する
+    size_t done = 0;
+    while (done < input.size()) {
+      size_t n;
+      int16_t* dst = ring.WriteRegion(&n);
+      n = std::min(n, input.size() - done);
+      if (n == 0) {
+        break;
+      }
+      sora::FloatToS16(input.data() + done, n, dst);
+      ring.Commit(n);
+      done += n;
+    }
+    // 読み込み側: 10ms 分ずつリング上のメモリのまま渡す
+    while (ring.Size() >= kChunk) {
+      size_t n;
+      const int16_t* p = ring.ReadRegion(&n);
+      checksum += p[0];
+      ring.Consume(kChunk);
+      chunks++;
+    }
+  };
+  ingest();
+  int64_t allocs = sora::test::AllocationCount().load();
+  ns = sora::test::MeasureNanos(kIterations, ingest);
+  allocs = sora::test::AllocationCount().load() - allocs;
+  printf("convert + ring + 10ms: %8.3f ns/sample, %lld allocations in %d "
+         "blocks (%lld chunks, checksum %lld)\n",
+         ns / kUnityBlock, (long long)allocs, kIterations, (long long)chunks,
+         (long long)checksum);
+  SORA_CHECK_EQ(allocs, 0);
+  return 0;
+}
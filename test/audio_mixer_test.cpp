@@ -0,0 +1,110 @@
+// UnityAudioReceiver::Mix と同じ手順（SpatialGains で求めたゲインで MixS16Stereo に足し込む）を、
+// 合成した正弦波で確かめる
+#include <math.h>
+#include <vector>
+
+#include "audio_util.h"
+#include "test_util.h"
+
+static const int kSampleRate = 48000;
+static const size_t kFrames = kSampleRate / 10;
+
+// 振幅 amplitude の正弦波を左右同じに入れたステレオの int16 音声
+static std::vector<int16_t> Sine(float frequency, float amplitude) {
+  std::vector<int16_t> v(kFrames * 2);
+  for (size_t i = 0; i < kFrames; i++) {
+    float s = amplitude * sinf(2.0f * 3.14159265f * frequency * i / kSampleRate);
+    v[i * 2] = v[i * 2 + 1] = (int16_t)lrintf(s * 32767.0f);
+  }
+  return v;
+}
+
+static float Rms(const std::vector<float>& v, int channel) {
+  double sum = 0.0;
+  for (size_t i = 0; i < kFrames; i++) {
+    sum += (double)v[i * 2 + channel] * v[i * 2 + channel];
+  }
+  return (float)sqrt(sum / kFrames);
+}
+
+static void Mix(const std::vector<int16_t>& src,
+                float gain,
+                float pan,
+                float distance,
+                std::vector<float>* dst) {
+  float left;
+  float right;
+  sora::SpatialGains(gain, pan, distance, &left, &right);
+  sora::MixS16Stereo(src.data(), kFrames, left, right, 0.0f, 0.0f,
+                     dst->data());
+}
+
+static bool Near(float a, float b) {
+  return fabsf(a - b) < 1e-3f;
+}
+
+static void TestSpatialGains() {
+  float left;
+  float right;
+  sora::SpatialGains(1.0f, 0.0f, 0.0f, &left, &right);
+  SORA_CHECK(Near(left, 0.70710678f));
+  SORA_CHECK(Near(right, 0.70710678f));
+  sora::SpatialGains(1.0f, -1.0f, 1.0f, &left, &right);
+  SORA_CHECK(Near(left, 1.0f));
+  SORA_CHECK(Near(right, 0.0f));
+  // 範囲外のパンは端に揃える
+  sora::SpatialGains(0.5f, 3.0f, 0.5f, &left, &right);
+  SORA_CHECK(Near(left, 0.0f));
+  SORA_CHECK(Near(right, 0.5f));
+  // 基準の距離の 4 倍で 1/4 になる
+  sora::SpatialGains(1.0f, 1.0f, 4.0f, &left, &right);
+  SORA_CHECK(Near(right, 0.25f));
+  // 負の音量は無音
+  sora::SpatialGains(-1.0f, 0.0f, 1.0f, &left, &right);
+  SORA_CHECK_EQ(left, 0.0f);
+  SORA_CHECK_EQ(right, 0.0f);
+}
+
+// 左に振った音と、右に振って 2 倍の距離に置いた音が、それぞれのチャンネルにだけ出る
+static void TestHardPannedStreams() {
+  std::vector<int16_t> a = Sine(440.0f, 0.5f);
+  std::vector<int16_t> b = Sine(1000.0f, 0.5f);
+  std::vector<float> out(kFrames * 2, 0.0f);
+  Mix(a, 1.0f, -1.0f, 1.0f, &out);
+  Mix(b, 1.0f, 1.0f, 2.0f, &out);
+  float sine_rms = 0.5f / sqrtf(2.0f);
+  SORA_CHECK(fabsf(Rms(out, 0) - sine_rms) < 1e-3f);
+  SORA_CHECK(fabsf(Rms(out, 1) - sine_rms * 0.5f) < 1e-3f);
+}
+
+// 中央に置いた音は、左右どちらも -3dB になって合計のパワーは変わらない
+static void TestCenterIsEqualPower() {
+  std::vector<int16_t> a = Sine(440.0f, 0.5f);
+  std::vector<float> out(kFrames * 2, 0.0f);
+  Mix(a, 1.0f, 0.0f, 1.0f, &out);
+  float sine_rms = 0.5f / sqrtf(2.0f);
+  float l = Rms(out, 0);
+  float r = Rms(out, 1);
+  SORA_CHECK(fabsf(l - r) < 1e-6f);
+  SORA_CHECK(fabsf(l * l + r * r - sine_rms * sine_rms) < 1e-3f);
+}
+
+// 同じ位置の音は足し合わされ、音量の設定がそのまま効く
+static void TestStreamsAreSummed() {
+  std::vector<int16_t> a = Sine(440.0f, 0.25f);
+  std::vector<float> out(kFrames * 2, 0.0f);
+  for (int i = 0; i < 4; i++) {
+    Mix(a, 0.5f, -1.0f, 1.0f, &out);
+  }
+  float sine_rms = 0.25f / sqrtf(2.0f);
+  SORA_CHECK(fabsf(Rms(out, 0) - sine_rms * 2.0f) < 1e-3f);
+  SORA_CHECK(Rms(out, 1) < 1e-6f);
+}
+
+int main() {
+  SORA_RUN_TEST(TestSpatialGains);
+  SORA_RUN_TEST(TestHardPannedStreams);
+  SORA_RUN_TEST(TestCenterIsEqualPower);
+  SORA_RUN_TEST(TestStreamsAreSummed);
+  return 0;
+}
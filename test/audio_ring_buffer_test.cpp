@@ -0,0 +1,119 @@
+#include "audio_ring_buffer.h"
+
+#include <thread>
+#include <vector>
+
+#include "test_util.h"
+
+using sora::AudioRingBuffer;
+
+static void TestWriteReadWrapAround() {
+  AudioRingBuffer ring;
+  ring.Reset(8);
+  int16_t in[6] = {1, 2, 3, 4, 5, 6};
+  int16_t out[8];
+  SORA_CHECK_EQ(ring.Write(in, 6), 6u);
+  SORA_CHECK_EQ(ring.Read(out, 4), 4u);
+  SORA_CHECK_EQ(out[0], 1);
+  SORA_CHECK_EQ(out[3], 4);
+  // 末尾をまたいで書いて、またいで読む
+  SORA_CHECK_EQ(ring.Write(in, 6), 6u);
+  SORA_CHECK_EQ(ring.Size(), 8u);
+  SORA_CHECK_EQ(ring.Read(out, 8), 8u);
+  const int16_t expected[] = {5, 6, 1, 2, 3, 4, 5, 6};
+  for (int i = 0; i < 8; i++) {
+    SORA_CHECK_EQ(out[i], expected[i]);
+  }
+  SORA_CHECK_EQ(ring.Size(), 0u);
+}
+
+static void TestFullAndEmpty() {
+  AudioRingBuffer ring;
+  ring.Reset(4);
+  int16_t in[6] = {1, 2, 3, 4, 5, 6};
+  int16_t out[6];
+  // 入り切らない分は書かない
+  SORA_CHECK_EQ(ring.Write(in, 6), 4u);
+  SORA_CHECK_EQ(ring.Write(in, 1), 0u);
+  // 足りない分は読まない
+  SORA_CHECK_EQ(ring.Read(out, 6), 4u);
+  SORA_CHECK_EQ(ring.Read(out, 1), 0u);
+  SORA_CHECK_EQ(out[3], 4);
+}
+
+// 容量を読み込み単位の倍数にしておけば、その単位の読み込みは常に連続した領域になる
+static void TestChunkRegionIsContiguous() {
+  const size_t kChunk = 480 * 2;
+  AudioRingBuffer ring;
+  ring.Reset(kChunk * 4);
+  std::vector<int16_t> in(kChunk);
+  for (int round = 0; round < 20; round++) {
+    for (size_t i = 0; i < kChunk; i++) {
+      in[i] = (int16_t)(round * 7 + i);
+    }
+    SORA_CHECK_EQ(ring.Write(in.data(), kChunk), kChunk);
+    size_t n;
+    const int16_t* p = ring.ReadRegion(&n);
+    SORA_CHECK(n >= kChunk);
+    SORA_CHECK_EQ(p[0], in[0]);
+    SORA_CHECK_EQ(p[kChunk - 1], in[kChunk - 1]);
+    ring.Consume(kChunk);
+  }
+}
+
+static void TestResetEmpties() {
+  AudioRingBuffer ring;
+  ring.Reset(16);
+  int16_t in[4] = {1, 2, 3, 4};
+  ring.Write(in, 4);
+  ring.Reset(16);
+  SORA_CHECK_EQ(ring.Size(), 0u);
+  ring.Reset(32);
+  SORA_CHECK_EQ(ring.Capacity(), 32u);
+  SORA_CHECK_EQ(ring.Size(), 0u);
+}
+
+// 書き込みと読み込みを別のスレッドから行っても、順序どおりに欠けずに届く
+static void TestSpscThreads() {
+  const int64_t kTotal = 5000000;
+  AudioRingBuffer ring;
+  ring.Reset(1000);
+  std::thread producer([&]() {
+    int16_t buf[97];
+    int64_t next = 0;
+    while (next < kTotal) {
+      size_t n = (size_t)std::min<int64_t>(97, kTotal - next);
+      for (size_t i = 0; i < n; i++) {
+        buf[i] = (int16_t)(next + i);
+      }
+      size_t written = ring.Write(buf, n);
+      next += written;
+      if (written == 0) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  int16_t buf[61];
+  int64_t next = 0;
+  while (next < kTotal) {
+    size_t n = ring.Read(buf, 61);
+    for (size_t i = 0; i < n; i++) {
+      SORA_CHECK_EQ(buf[i], (int16_t)(next + i));
+    }
+    next += n;
+    if (n == 0) {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  SORA_CHECK_EQ(ring.Size(), 0u);
+}
+
+int main() {
+  SORA_RUN_TEST(TestWriteReadWrapAround);
+  SORA_RUN_TEST(TestFullAndEmpty);
+  SORA_RUN_TEST(TestChunkRegionIsContiguous);
+  SORA_RUN_TEST(TestResetEmpties);
+  SORA_RUN_TEST(TestSpscThreads);
+  return 0;
+}
@@ -0,0 +1,146 @@
+#include "audio_util.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <limits>
+#include <vector>
+
+#include "test_util.h"
+
+// 仕様どおりの 1 サンプル分の変換（NaN は 0、飽和、最近接偶数丸め）
+static int16_t Reference(float v) {
+  if (v != v) {
+    return 0;
+  }
+  double d = (double)v * 32768.0;
+  if (d >= 32767.0) {
+    return 32767;
+  }
+  if (d <= -32768.0) {
+    return -32768;
+  }
+  return (int16_t)nearbyint(d);
+}
+
+static std::vector<float> MakeInput(size_t size) {
+  std::vector<float> v(size);
+  uint32_t seed = 1;
+  for (size_t i = 0; i < size; i++) {
+    seed = seed * 1664525 + 1013904223;
+    v[i] = ((int32_t)seed / 2147483648.0f) * 1.25f;
+  }
+  // 境界値と特殊な値
+  const float specials[] = {
+      0.0f,
+      -0.0f,
+      1.0f,
+      -1.0f,
+      2.0f,
+      -2.0f,
+      0.5f / 32768.0f,
+      1.5f / 32768.0f,
+      -0.5f / 32768.0f,
+      -2.5f / 32768.0f,
+      32767.5f / 32768.0f,
+      std::numeric_limits<float>::quiet_NaN(),
+      std::numeric_limits<float>::infinity(),
+      -std::numeric_limits<float>::infinity(),
+  };
+  for (size_t i = 0; i < sizeof(specials) / sizeof(specials[0]) && i < size;
+       i++) {
+    v[i * 7 % size] = specials[i];
+  }
+  return v;
+}
+
+// 長さや先頭の位置（SIMD の部分と端数の部分の分かれ方）によらず、結果が同じになる
+static void TestFloatToS16MatchesReference() {
+  std::vector<float> input = MakeInput(1024);
+  for (size_t offset = 0; offset < 8; offset++) {
+    for (size_t size = 0; size + offset <= 64; size++) {
+      std::vector<int16_t> out(size + 1, 0x5555);
+      sora::FloatToS16(input.data() + offset, size, out.data());
+      for (size_t i = 0; i < size; i++) {
+        SORA_CHECK_EQ(out[i], Reference(input[offset + i]));
+      }
+      // 範囲外には書かない
+      SORA_CHECK_EQ(out[size], 0x5555);
+    }
+  }
+  std::vector<int16_t> out(input.size());
+  sora::FloatToS16(input.data(), input.size(), out.data());
+  for (size_t i = 0; i < input.size(); i++) {
+    SORA_CHECK_EQ(out[i], Reference(input[i]));
+  }
+}
+
+static void TestFloatToS16SpecialValues() {
+  const float in[] = {
+      1.0f,
+      -1.0f,
+      std::numeric_limits<float>::quiet_NaN(),
+      0.5f / 32768.0f,
+      1.5f / 32768.0f,
+      -2.5f / 32768.0f,
+      100.0f,
+      -100.0f,
+  };
+  const int16_t expected[] = {32767, -32768, 0, 0, 2, -2, 32767, -32768};
+  // 8 サンプルまとめての場合と 1 サンプルずつの場合の両方
+  int16_t out[8];
+  sora::FloatToS16(in, 8, out);
+  for (int i = 0; i < 8; i++) {
+    SORA_CHECK_EQ(out[i], expected[i]);
+  }
+  for (int i = 0; i < 8; i++) {
+    int16_t one;
+    sora::FloatToS16(&in[i], 1, &one);
+    SORA_CHECK_EQ(one, expected[i]);
+  }
+}
+
+static void TestS16ToFloatChannels() {
+  const int16_t mono[] = {16384, -32768};
+  float stereo[4];
+  sora::S16ToFloat(mono, 2, 1, stereo, 2);
+  SORA_CHECK_EQ(stereo[0], 0.5f);
+  SORA_CHECK_EQ(stereo[1], 0.5f);
+  SORA_CHECK_EQ(stereo[2], -1.0f);
+  SORA_CHECK_EQ(stereo[3], -1.0f);
+
+  const int16_t st[] = {16384, -16384};
+  float quad[4];
+  sora::S16ToFloat(st, 1, 2, quad, 4);
+  SORA_CHECK_EQ(quad[0], 0.5f);
+  SORA_CHECK_EQ(quad[1], -0.5f);
+  SORA_CHECK_EQ(quad[2], 0.0f);
+  SORA_CHECK_EQ(quad[3], 0.0f);
+
+  float same[2];
+  sora::S16ToFloat(st, 1, 2, same, 2);
+  SORA_CHECK_EQ(same[0], 0.5f);
+  SORA_CHECK_EQ(same[1], -0.5f);
+}
+
+static void TestMixS16StereoRampsGain() {
+  const size_t frames = 4;
+  const int16_t src[] = {16384, 16384, 16384, 16384,
+                         16384, 16384, 16384, 16384};
+  float dst[8] = {0.25f, 0.25f, 0, 0, 0, 0, 0, 0};
+  sora::MixS16Stereo(src, frames, 1.0f, 0.0f, -0.25f, 0.25f, dst);
+  // 左は 1.0 から 0.25 ずつ下げ、右は 0 から 0.25 ずつ上げる
+  const float left[] = {0.75f, 0.375f, 0.25f, 0.125f};
+  const float right[] = {0.25f, 0.125f, 0.25f, 0.375f};
+  for (size_t i = 0; i < frames; i++) {
+    SORA_CHECK(fabsf(dst[i * 2] - left[i]) < 1e-6f);
+    SORA_CHECK(fabsf(dst[i * 2 + 1] - right[i]) < 1e-6f);
+  }
+}
+
+int main() {
+  SORA_RUN_TEST(TestFloatToS16MatchesReference);
+  SORA_RUN_TEST(TestFloatToS16SpecialValues);
+  SORA_RUN_TEST(TestS16ToFloatChannels);
+  SORA_RUN_TEST(TestMixS16StereoRampsGain);
+  return 0;
+}
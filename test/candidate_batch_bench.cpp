@@ -0,0 +1,181 @@
+// 会議室に参加した時に送るシグナリングのメッセージ数とバイト数を、
+// テスト用のサーバの代わり (signaling_stand_in.h) に送って測る。
+// ストリーム毎に SDP を作ってから候補が一定間隔で見つかり、最後に収集が終わる流れを
+// タイマーで再現して、CandidateBatcher の窓の長さ毎に比べる
+#include "candidate_batcher.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "signaling_stand_in.h"
+#include "signaling_transport.h"
+#include "signaling_writer.h"
+#include "test_util.h"
+
+using sora::CandidateBatcher;
+using sora::SignalingTransport;
+using sora::test::RunUntil;
+using sora::test::SignalingStandIn;
+
+namespace {
+
+// 20 人の部屋: 配信 1 つと視聴 19 つ
+const int kStreams = 20;
+// インターフェースの多いホストでは PeerConnection 毎に 30 を超える
+const int kCandidatesPerStream = 30;
+
+std::string MakeSdp() {
+  std::string sdp =
+      "v=0\r\no=- 4611731400430051336 2 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\n"
+      "a=group:BUNDLE 0 1\r\na=msid-semantic: WMS stream\r\n";
+  const char* kinds[] = {"audio 9 UDP/TLS/RTP/SAVPF 111",
+                         "video 9 UDP/TLS/RTP/SAVPF 96 97"};
+  for (int m = 0; m < 2; m++) {
+    sdp += std::string("m=") + kinds[m] +
+           "\r\nc=IN IP4 0.0.0.0\r\na=rtcp:9 IN IP4 0.0.0.0\r\n"
+           "a=ice-ufrag:AbCd\r\na=ice-pwd:0123456789abcdefghijklmn\r\n"
+           "a=ice-options:trickle\r\n"
+           "a=fingerprint:sha-256 12:34:56:78:9A:BC:DE:F0:12:34:56:78:9A:BC:"
+           "DE:F0:12:34:56:78:9A:BC:DE:F0:12:34:56:78:9A:BC:DE:F0\r\n"
+           "a=setup:actpass\r\na=mid:" +
+           std::to_string(m) +
+           "\r\na=sendrecv\r\na=rtcp-mux\r\na=rtpmap:111 opus/48000/2\r\n"
+           "a=rtpmap:96 VP8/90000\r\na=rtcp-fb:96 transport-cc\r\n"
+           "a=rtcp-fb:96 nack\r\na=rtcp-fb:96 nack pli\r\n"
+           "a=rtpmap:97 rtx/90000\r\na=fmtp:97 apt=96\r\n"
+           "a=ssrc:1001 cname:abcdefgh\r\n";
+  }
+  return sdp;
+}
+
+std::string MakeCandidate(int i) {
+  return "candidate:" + std::to_string(842163049 + i) + " 1 udp " +
+         std::to_string(2122260223 - i) + " 192.168." + std::to_string(i) +
+         ".2 " + std::to_string(50000 + i) +
+         " typ host generation 0 ufrag AbCd network-id " +
+         std::to_string(i + 1) + " network-cost 10";
+}
+
+struct Result {
+  int64_t messages;
+  int64_t bytes;
+  double offer_ms;
+  double done_ms;
+};
+
+// gathering_ms かけて候補を集め終わるストリームで参加する
+Result RunJoin(int window_ms, int gathering_ms) {
+  boost::asio::io_context ioc;
+  SignalingStandIn server(ioc);
+  auto strand = boost::asio::make_strand(ioc);
+
+  sora::SignalingTransportConfig config;
+  config.host = "127.0.0.1";
+  config.port = server.Port();
+  config.path = "/signaling";
+  auto transport =
+      SignalingTransport::Create(strand, config, SignalingTransport::Handler());
+  SORA_CHECK(transport != nullptr);
+  transport->Connect();
+  SORA_CHECK(RunUntil(ioc, [&]() { return transport->IsConnected(); }));
+
+  CandidateBatcher::Handler handler;
+  handler.send_description = [&](const std::string& stream_id,
+                                 const std::string& type,
+                                 const std::string& sdp) {
+    if (std::string* out = transport->BeginMessage()) {
+      sora::signaling_writer::TakeConfiguration(out, stream_id, type, sdp);
+      transport->EndMessage(out);
+    }
+  };
+  handler.send_candidate = [&](const std::string& stream_id,
+                               const CandidateBatcher::Candidate& c) {
+    if (std::string* out = transport->BeginMessage()) {
+      sora::signaling_writer::TakeCandidate(out, stream_id, c.sdp_mlineindex,
+                                            c.sdp_mid, c.sdp);
+      transport->EndMessage(out);
+    }
+  };
+  auto batcher = CandidateBatcher::Create(strand, window_ms, handler);
+
+  auto start = std::chrono::steady_clock::now();
+  auto elapsed_ms = [&]() {
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  };
+  double offer_ms_sum = 0;
+  double last_ms = 0;
+  server.on_message = [&](const std::string& text) {
+    last_ms = elapsed_ms();
+    if (text.find("\"takeConfiguration\"") != std::string::npos) {
+      offer_ms_sum += last_ms;
+    }
+  };
+
+  const std::string sdp = MakeSdp();
+  std::vector<std::unique_ptr<boost::asio::steady_timer>> timers;
+  int pending = 0;
+  auto at = [&](int ms, std::function<void()> f) {
+    timers.emplace_back(new boost::asio::steady_timer(strand));
+    timers.back()->expires_after(std::chrono::milliseconds(ms));
+    pending++;
+    timers.back()->async_wait([&, f](boost::system::error_code) {
+      f();
+      pending--;
+    });
+  };
+  for (int s = 0; s < kStreams; s++) {
+    std::string id = "stream" + std::to_string(s);
+    batcher->OnDescription(id, s == 0 ? "offer" : "answer", sdp);
+    std::string full = sdp;
+    for (int i = 0; i < kCandidatesPerStream; i++) {
+      std::string c = MakeCandidate(i);
+      full += "a=" + c + "\r\n";
+      at((i + 1) * gathering_ms / kCandidatesPerStream, [=, &batcher]() {
+        batcher->OnCandidate(id, {std::to_string(i % 2), i % 2, c});
+      });
+    }
+    full += "a=end-of-candidates\r\n";
+    at(gathering_ms + 1,
+       [=, &batcher]() { batcher->OnGatheringComplete(id, full); });
+  }
+
+  SORA_CHECK(RunUntil(ioc, [&]() {
+    return pending == 0 && batcher->HeldCount() == 0 &&
+           (int64_t)server.received.size() ==
+               transport->GetStats().messages_sent;
+  }));
+  transport->Close();
+
+  auto stats = transport->GetStats();
+  Result r;
+  r.messages = stats.messages_sent;
+  r.bytes = stats.bytes_sent;
+  r.offer_ms = offer_ms_sum / kStreams;
+  r.done_ms = last_ms;
+  return r;
+}
+
+}  // namespace
+
+int main() {
+  printf("join: %d streams, %d candidates per stream\n", kStreams,
+         kCandidatesPerStream);
+  printf("%-10s %-13s %10s %10s %10s %10s\n", "window_ms", "gathering_ms",
+         "messages", "KB", "sdp_ms", "done_ms");
+  const struct {
+    int window_ms;
+    int gathering_ms;
+  } cases[] = {
+      {0, 60}, {100, 60}, {0, 300}, {100, 300}, {500, 300},
+  };
+  for (const auto& c : cases) {
+    Result r = RunJoin(c.window_ms, c.gathering_ms);
+    printf("%-10d %-13d %10lld %10.1f %10.1f %10.1f\n", c.window_ms,
+           c.gathering_ms, (long long)r.messages, r.bytes / 1024.0,
+           r.offer_ms, r.done_ms);
+  }
+  return 0;
+}
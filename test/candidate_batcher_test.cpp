@@ -0,0 +1,153 @@
+#include "candidate_batcher.h"
+
+#include <string>
+#include <vector>
+
+#include "signaling_stand_in.h"
+#include "test_util.h"
+
+using sora::CandidateBatcher;
+using sora::test::RunUntil;
+
+namespace {
+
+// 送ったものを順に記録する
+struct Recorder {
+  std::vector<std::string> sent;
+
+  CandidateBatcher::Handler MakeHandler() {
+    CandidateBatcher::Handler handler;
+    handler.send_description = [this](const std::string& stream_id,
+                                      const std::string& type,
+                                      const std::string& sdp) {
+      sent.push_back(stream_id + " " + type + " " + sdp);
+    };
+    handler.send_candidate = [this](const std::string& stream_id,
+                                    const CandidateBatcher::Candidate& c) {
+      sent.push_back(stream_id + " candidate " + c.sdp);
+    };
+    return handler;
+  }
+};
+
+struct Fixture {
+  boost::asio::io_context ioc;
+  Recorder recorder;
+  std::shared_ptr<CandidateBatcher> batcher;
+
+  explicit Fixture(int window_ms) {
+    batcher = CandidateBatcher::Create(boost::asio::make_strand(ioc),
+                                       window_ms, recorder.MakeHandler());
+  }
+
+  CandidateBatcher::Candidate Candidate(const std::string& sdp) {
+    return CandidateBatcher::Candidate{"0", 0, sdp};
+  }
+};
+
+}  // namespace
+
+// 窓が 0 なら何も保留しない
+static void TestDisabled() {
+  Fixture f(0);
+  f.batcher->OnDescription("s", "offer", "sdp");
+  f.batcher->OnCandidate("s", f.Candidate("c1"));
+  f.batcher->OnGatheringComplete("s", "sdp+c1");
+  SORA_CHECK_EQ(f.batcher->HeldCount(), 0u);
+  SORA_CHECK_EQ(f.recorder.sent.size(), 2u);
+  SORA_CHECK_EQ(f.recorder.sent[0], "s offer sdp");
+  SORA_CHECK_EQ(f.recorder.sent[1], "s candidate c1");
+}
+
+// 窓の中で収集が終われば、候補を含む SDP だけを送る
+static void TestGatheringCompleteWithinWindow() {
+  Fixture f(1000);
+  f.batcher->OnDescription("s", "answer", "sdp");
+  f.batcher->OnCandidate("s", f.Candidate("c1"));
+  f.batcher->OnCandidate("s", f.Candidate("c2"));
+  SORA_CHECK(f.recorder.sent.empty());
+  f.batcher->OnGatheringComplete("s", "sdp+c1+c2");
+  SORA_CHECK_EQ(f.recorder.sent.size(), 1u);
+  SORA_CHECK_EQ(f.recorder.sent[0], "s answer sdp+c1+c2");
+  SORA_CHECK_EQ(f.batcher->HeldCount(), 0u);
+
+  // 取り消したタイマーで送り直したりしない
+  RunUntil(f.ioc, []() { return false; }, std::chrono::milliseconds(50));
+  SORA_CHECK_EQ(f.recorder.sent.size(), 1u);
+}
+
+// 窓が過ぎたら、作った時の SDP と溜めた候補を順に送り、以降は直ちに送る
+static void TestWindowExpires() {
+  Fixture f(20);
+  f.batcher->OnDescription("s", "offer", "sdp");
+  f.batcher->OnCandidate("s", f.Candidate("c1"));
+  f.batcher->OnCandidate("s", f.Candidate("c2"));
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return f.recorder.sent.size() == 3; }));
+  SORA_CHECK_EQ(f.recorder.sent[0], "s offer sdp");
+  SORA_CHECK_EQ(f.recorder.sent[1], "s candidate c1");
+  SORA_CHECK_EQ(f.recorder.sent[2], "s candidate c2");
+
+  f.batcher->OnCandidate("s", f.Candidate("c3"));
+  SORA_CHECK_EQ(f.recorder.sent.back(), "s candidate c3");
+  // 窓が過ぎた後の収集の終わりは無視する
+  f.batcher->OnGatheringComplete("s", "sdp+c1+c2+c3");
+  SORA_CHECK_EQ(f.recorder.sent.size(), 4u);
+}
+
+// ストリーム毎に別々に保留する
+static void TestPerStream() {
+  Fixture f(1000);
+  f.batcher->OnDescription("a", "offer", "sdp-a");
+  f.batcher->OnDescription("b", "answer", "sdp-b");
+  f.batcher->OnCandidate("a", f.Candidate("a1"));
+  f.batcher->OnCandidate("b", f.Candidate("b1"));
+  // 保留していないストリームの候補はそのまま送る
+  f.batcher->OnCandidate("c", f.Candidate("c1"));
+  SORA_CHECK_EQ(f.batcher->HeldCount(), 2u);
+  f.batcher->OnGatheringComplete("b", "sdp-b+b1");
+  SORA_CHECK_EQ(f.recorder.sent.size(), 2u);
+  SORA_CHECK_EQ(f.recorder.sent[0], "c candidate c1");
+  SORA_CHECK_EQ(f.recorder.sent[1], "b answer sdp-b+b1");
+  f.batcher->OnGatheringComplete("a", "sdp-a+a1");
+  SORA_CHECK_EQ(f.recorder.sent.back(), "a offer sdp-a+a1");
+}
+
+// SDP を作り直したら、前の SDP と候補は捨てて窓もやり直す
+static void TestDescriptionReplaced() {
+  Fixture f(30);
+  f.batcher->OnDescription("s", "offer", "old");
+  f.batcher->OnCandidate("s", f.Candidate("old1"));
+  RunUntil(f.ioc, []() { return false; }, std::chrono::milliseconds(15));
+  f.batcher->OnDescription("s", "offer", "new");
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return !f.recorder.sent.empty(); }));
+  RunUntil(f.ioc, []() { return false; }, std::chrono::milliseconds(50));
+  SORA_CHECK_EQ(f.recorder.sent.size(), 1u);
+  SORA_CHECK_EQ(f.recorder.sent[0], "s offer new");
+}
+
+// 破棄したストリームの SDP は送らない
+static void TestRemove() {
+  Fixture f(20);
+  f.batcher->OnDescription("a", "offer", "sdp-a");
+  f.batcher->OnDescription("b", "offer", "sdp-b");
+  f.batcher->Remove("a");
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return !f.recorder.sent.empty(); }));
+  RunUntil(f.ioc, []() { return false; }, std::chrono::milliseconds(50));
+  SORA_CHECK_EQ(f.recorder.sent.size(), 1u);
+  SORA_CHECK_EQ(f.recorder.sent[0], "b offer sdp-b");
+
+  f.batcher->OnDescription("c", "offer", "sdp-c");
+  f.batcher->Clear();
+  RunUntil(f.ioc, []() { return false; }, std::chrono::milliseconds(50));
+  SORA_CHECK_EQ(f.recorder.sent.size(), 1u);
+}
+
+int main() {
+  SORA_RUN_TEST(TestDisabled);
+  SORA_RUN_TEST(TestGatheringCompleteWithinWindow);
+  SORA_RUN_TEST(TestWindowExpires);
+  SORA_RUN_TEST(TestPerStream);
+  SORA_RUN_TEST(TestDescriptionReplaced);
+  SORA_RUN_TEST(TestRemove);
+  return 0;
+}
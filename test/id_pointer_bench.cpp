@@ -0,0 +1,52 @@
+// IdPointer::Lookup のベンチマーク。
+// 描画スレッドからトラック毎・フレーム毎に呼ばれるので、複数スレッドから同時に引いた場合も測る
+#include "id_pointer.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "test_util.h"
+
+using sora::IdPointer;
+
+int main() {
+  const int kObjects = 64;
+  const int kIterations = 10000000;
+  std::vector<int> objects(kObjects);
+  std::vector<ptrid_t> ids;
+  for (int i = 0; i < kObjects; i++) {
+    ids.push_back(IdPointer::Instance().Register(&objects[i]));
+  }
+
+  printf("%-8s %14s\n", "threads", "ns/lookup");
+  for (int threads = 1; threads <= 8; threads *= 2) {
+    std::atomic<int64_t> sink(0);
+    std::vector<std::thread> ts;
+    auto start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+      ts.emplace_back([&, t]() {
+        int64_t sum = 0;
+        for (int i = 0; i < kIterations; i++) {
+          auto pinned = IdPointer::Instance().Lookup(ids[(i + t) % kObjects]);
+          sum += *(int*)pinned.get();
+        }
+        sink += sum;
+      });
+    }
+    for (auto& t : ts) {
+      t.join();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    double ns =
+        std::chrono::duration<double, std::nano>(elapsed).count() /
+        kIterations;
+    printf("%-8d %14.2f\n", threads, ns);
+  }
+
+  for (ptrid_t id : ids) {
+    IdPointer::Instance().Unregister(id);
+  }
+  return 0;
+}
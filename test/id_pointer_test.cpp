@@ -0,0 +1,165 @@
+#include "id_pointer.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "test_util.h"
+
+using sora::IdPointer;
+
+static void TestRegisterLookupUnregister() {
+  int a = 1;
+  ptrid_t id = IdPointer::Instance().Register(&a);
+  SORA_CHECK(id != 0);
+  {
+    auto pinned = IdPointer::Instance().Lookup(id);
+    SORA_CHECK(pinned.get() == &a);
+  }
+  IdPointer::Instance().Unregister(id);
+  SORA_CHECK(!IdPointer::Instance().Lookup(id));
+  SORA_CHECK(!IdPointer::Instance().Lookup(0));
+}
+
+// 古い ID は、スロットが再利用されても新しいポインタを返さない
+static void TestStaleIdIsRejected() {
+  int a = 1, b = 2;
+  std::vector<ptrid_t> old_ids;
+  for (int i = 0; i < 10000; i++) {
+    ptrid_t id = IdPointer::Instance().Register(&a);
+    SORA_CHECK(id != 0);
+    old_ids.push_back(id);
+    IdPointer::Instance().Unregister(id);
+  }
+  ptrid_t id = IdPointer::Instance().Register(&b);
+  for (ptrid_t old : old_ids) {
+    SORA_CHECK(old != id);
+    SORA_CHECK(!IdPointer::Instance().Lookup(old));
+  }
+  SORA_CHECK(IdPointer::Instance().Lookup(id).get() == &b);
+  IdPointer::Instance().Unregister(id);
+}
+
+// Unregister はピン留めが外れるまで戻らない
+static void TestUnregisterWaitsForPin() {
+  int a = 1;
+  ptrid_t id = IdPointer::Instance().Register(&a);
+  auto pinned = IdPointer::Instance().Lookup(id);
+  SORA_CHECK(pinned);
+
+  std::atomic<bool> unregistered(false);
+  std::thread t([&]() {
+    IdPointer::Instance().Unregister(id);
+    unregistered = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  SORA_CHECK(!unregistered);
+  // Unregister が始まった後の Lookup は失敗する
+  SORA_CHECK(!IdPointer::Instance().Lookup(id));
+
+  pinned = IdPointer::Pinned();
+  t.join();
+  SORA_CHECK(unregistered);
+}
+
+// 登録と削除を繰り返すスレッドと、Lookup し続けるスレッドを同時に動かして、
+// ピン留めしている間にオブジェクトが破棄されないことを確かめる
+static void TestConcurrentRegisterLookup() {
+  struct Object {
+    std::atomic<uint32_t> magic;
+    ptrid_t id = 0;
+  };
+  const uint32_t kAlive = 0x600dcafe;
+  const uint32_t kDead = 0xdeadbeef;
+  const int kWriters = 4;
+  const int kReaders = 4;
+  const int kSlotsPerWriter = 32;
+
+  std::atomic<bool> stop(false);
+  // 各ライターが今登録している ID。リーダーはここから ID を拾う
+  std::vector<std::atomic<ptrid_t>> ids(kWriters * kSlotsPerWriter);
+  for (auto& id : ids) {
+    id = 0;
+  }
+  std::atomic<int64_t> registrations(0);
+  std::atomic<int64_t> hits(0);
+  std::atomic<int64_t> misses(0);
+  std::atomic<bool> failed(false);
+
+  std::vector<std::thread> threads;
+  for (int w = 0; w < kWriters; w++) {
+    threads.emplace_back([&, w]() {
+      std::vector<Object*> objects(kSlotsPerWriter, nullptr);
+      int n = 0;
+      while (!stop) {
+        int i = n++ % kSlotsPerWriter;
+        if (objects[i] != nullptr) {
+          Object* o = objects[i];
+          ids[w * kSlotsPerWriter + i] = 0;
+          IdPointer::Instance().Unregister(o->id);
+          // Unregister から戻った後は誰も触っていないはず
+          o->magic = kDead;
+          delete o;
+          objects[i] = nullptr;
+        }
+        Object* o = new Object();
+        o->magic = kAlive;
+        o->id = IdPointer::Instance().Register(o);
+        if (o->id == 0) {
+          failed = true;
+          return;
+        }
+        objects[i] = o;
+        ids[w * kSlotsPerWriter + i] = o->id;
+        registrations++;
+      }
+      for (Object* o : objects) {
+        if (o != nullptr) {
+          IdPointer::Instance().Unregister(o->id);
+          delete o;
+        }
+      }
+    });
+  }
+  for (int r = 0; r < kReaders; r++) {
+    threads.emplace_back([&, r]() {
+      uint32_t seed = 12345 + r;
+      while (!stop) {
+        seed = seed * 1103515245 + 12345;
+        ptrid_t id = ids[(seed >> 8) % ids.size()];
+        auto pinned = IdPointer::Instance().Lookup(id);
+        auto o = (Object*)pinned.get();
+        if (o == nullptr) {
+          misses++;
+          continue;
+        }
+        // ピン留めしている間は破棄されないし、別の ID のオブジェクトでもない
+        if (o->magic != kAlive || o->id != id) {
+          failed = true;
+        }
+        hits++;
+      }
+    });
+  }
+
+  std::this_thread::sleep_for(std::chrono::seconds(2));
+  stop = true;
+  for (auto& t : threads) {
+    t.join();
+  }
+  printf("  registrations=%lld hits=%lld misses=%lld\n",
+         (long long)registrations.load(), (long long)hits.load(),
+         (long long)misses.load());
+  SORA_CHECK(!failed);
+  SORA_CHECK(registrations > 0);
+  SORA_CHECK(hits > 0);
+}
+
+int main() {
+  SORA_RUN_TEST(TestRegisterLookupUnregister);
+  SORA_RUN_TEST(TestStaleIdIsRejected);
+  SORA_RUN_TEST(TestUnregisterWaitsForPin);
+  SORA_RUN_TEST(TestConcurrentRegisterLookup);
+  return 0;
+}
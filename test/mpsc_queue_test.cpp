@@ -0,0 +1,104 @@
+#include "mpsc_queue.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "test_util.h"
+
+using sora::MpscQueue;
+
+static void TestFifo() {
+  MpscQueue<int> q(4);
+  SORA_CHECK_EQ(q.Capacity(), 4u);
+  for (int i = 0; i < 4; i++) {
+    int v = i;
+    SORA_CHECK(q.Push(std::move(v)));
+  }
+  SORA_CHECK_EQ(q.Size(), 4u);
+  for (int i = 0; i < 4; i++) {
+    int v = -1;
+    SORA_CHECK(q.Pop(v));
+    SORA_CHECK_EQ(v, i);
+  }
+  int v;
+  SORA_CHECK(!q.Pop(v));
+  SORA_CHECK_EQ(q.Size(), 0u);
+}
+
+static void TestCapacityRoundsUp() {
+  MpscQueue<int> q(5);
+  SORA_CHECK_EQ(q.Capacity(), 8u);
+  MpscQueue<int> q1(1);
+  SORA_CHECK_EQ(q1.Capacity(), 2u);
+}
+
+static void TestFullKeepsValue() {
+  MpscQueue<std::string> q(2);
+  std::string a = "a", b = "b", c = "c";
+  SORA_CHECK(q.Push(std::move(a)));
+  SORA_CHECK(q.Push(std::move(b)));
+  // 一杯なら失敗して、値はそのまま残る
+  SORA_CHECK(!q.Push(std::move(c)));
+  SORA_CHECK_EQ(c, "c");
+
+  std::string v;
+  SORA_CHECK(q.Pop(v));
+  SORA_CHECK_EQ(v, "a");
+  SORA_CHECK(q.Push(std::move(c)));
+  SORA_CHECK(q.Pop(v));
+  SORA_CHECK_EQ(v, "b");
+  SORA_CHECK(q.Pop(v));
+  SORA_CHECK_EQ(v, "c");
+}
+
+// 複数の producer から積んでも、producer 毎の順序が保たれて、取りこぼしが無いこと
+static void TestMultiProducer() {
+  const int kProducers = 4;
+  const int kPerProducer = 200000;
+  MpscQueue<uint64_t> q(256);
+
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; p++) {
+    producers.emplace_back([&q, p]() {
+      for (int i = 0; i < kPerProducer; i++) {
+        uint64_t v = ((uint64_t)p << 32) | (uint64_t)i;
+        while (!q.Push(std::move(v))) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+
+  std::vector<int64_t> next(kProducers, 0);
+  int64_t received = 0;
+  while (received < (int64_t)kProducers * kPerProducer) {
+    uint64_t v;
+    if (!q.Pop(v)) {
+      std::this_thread::yield();
+      continue;
+    }
+    int p = (int)(v >> 32);
+    int64_t i = (int64_t)(v & 0xffffffff);
+    SORA_CHECK(p >= 0 && p < kProducers);
+    SORA_CHECK_EQ(i, next[p]);
+    next[p]++;
+    received++;
+  }
+  for (auto& t : producers) {
+    t.join();
+  }
+  uint64_t v;
+  SORA_CHECK(!q.Pop(v));
+  for (int p = 0; p < kProducers; p++) {
+    SORA_CHECK_EQ(next[p], kPerProducer);
+  }
+}
+
+int main() {
+  SORA_RUN_TEST(TestFifo);
+  SORA_RUN_TEST(TestCapacityRoundsUp);
+  SORA_RUN_TEST(TestFullKeepsValue);
+  SORA_RUN_TEST(TestMultiProducer);
+  return 0;
+}
@@ -0,0 +1,158 @@
+#include "plane_extractor.h"
+
+#include <vector>
+
+#include "test_util.h"
+
+using sora::PlaneExtractor;
+using sora::PlaneScaler;
+using sora::PlaneView;
+using sora::TexturePlane;
+
+namespace {
+
+// stride に隙間を持たせられる I420 のフレーム
+struct Frame {
+  int width;
+  int height;
+  int chroma_width;
+  int chroma_height;
+  int y_stride;
+  int chroma_stride;
+  std::vector<uint8_t> y, u, v;
+
+  Frame(int w, int h, int padding)
+      : width(w),
+        height(h),
+        chroma_width((w + 1) / 2),
+        chroma_height((h + 1) / 2),
+        y_stride(w + padding),
+        chroma_stride((w + 1) / 2 + padding),
+        y((size_t)y_stride * h),
+        u((size_t)chroma_stride * chroma_height),
+        v((size_t)chroma_stride * chroma_height) {
+    for (size_t i = 0; i < y.size(); i++) {
+      y[i] = (uint8_t)(i * 3);
+    }
+    for (size_t i = 0; i < u.size(); i++) {
+      u[i] = (uint8_t)(i * 5 + 1);
+      v[i] = (uint8_t)(i * 7 + 2);
+    }
+  }
+  PlaneView Y() const { return {y.data(), y_stride, width, height}; }
+  PlaneView U() const {
+    return {u.data(), chroma_stride, chroma_width, chroma_height};
+  }
+  PlaneView V() const {
+    return {v.data(), chroma_stride, chroma_width, chroma_height};
+  }
+};
+
+}  // namespace
+
+// 詰まっているプレーンは、コピーせずにそのまま返す
+static void TestPackedPlaneIsPassedThrough() {
+  Frame f(64, 32, 0);
+  PlaneExtractor ex;
+  size_t copied = 123;
+  const uint8_t* p =
+      ex.Extract(f.Y(), f.U(), f.V(), TexturePlane::Y, 64, 32, &copied);
+  SORA_CHECK(p == f.y.data());
+  SORA_CHECK_EQ(copied, 0u);
+  p = ex.Extract(f.Y(), f.U(), f.V(), TexturePlane::V, 32, 16, &copied);
+  SORA_CHECK(p == f.v.data());
+  SORA_CHECK_EQ(copied, 0u);
+}
+
+// stride に隙間があれば、詰めてコピーする
+static void TestPaddedPlaneIsPacked() {
+  Frame f(30, 20, 18);
+  PlaneExtractor ex;
+  size_t copied;
+  const uint8_t* p =
+      ex.Extract(f.Y(), f.U(), f.V(), TexturePlane::Y, 30, 20, &copied);
+  SORA_CHECK(p != f.y.data());
+  SORA_CHECK_EQ(copied, 30u * 20u);
+  for (int y = 0; y < 20; y++) {
+    for (int x = 0; x < 30; x++) {
+      SORA_CHECK_EQ(p[y * 30 + x], f.y[(size_t)y * f.y_stride + x]);
+    }
+  }
+  p = ex.Extract(f.Y(), f.U(), f.V(), TexturePlane::U, 15, 10, &copied);
+  SORA_CHECK_EQ(copied, 15u * 10u);
+  for (int y = 0; y < 10; y++) {
+    for (int x = 0; x < 15; x++) {
+      SORA_CHECK_EQ(p[y * 15 + x], f.u[(size_t)y * f.chroma_stride + x]);
+    }
+  }
+}
+
+// UV は U, V を交互に並べて、1 行は幅の 2 倍になる
+static void TestUVIsInterleaved() {
+  Frame f(40, 24, 8);
+  PlaneExtractor ex;
+  size_t copied;
+  const uint8_t* p =
+      ex.Extract(f.Y(), f.U(), f.V(), TexturePlane::UV, 20, 12, &copied);
+  SORA_CHECK_EQ(copied, 20u * 12u * 2u);
+  for (int y = 0; y < 12; y++) {
+    for (int x = 0; x < 20; x++) {
+      SORA_CHECK_EQ(p[y * 40 + x * 2], f.u[(size_t)y * f.chroma_stride + x]);
+      SORA_CHECK_EQ(p[y * 40 + x * 2 + 1],
+                    f.v[(size_t)y * f.chroma_stride + x]);
+    }
+  }
+}
+
+// スケーリングする場合は PlaneScaler と同じ結果になる
+static void TestScaledPlanesMatchScaler() {
+  Frame f(128, 72, 16);
+  const int dw = 48, dh = 27;
+  PlaneExtractor ex;
+  size_t copied;
+
+  std::vector<uint8_t> expected((size_t)dw * dh);
+  PlaneScaler scaler;
+  scaler.Configure(f.width, f.height, dw, dh);
+  scaler.Scale(f.y.data(), f.y_stride, expected.data(), dw);
+  const uint8_t* p =
+      ex.Extract(f.Y(), f.U(), f.V(), TexturePlane::Y, dw, dh, &copied);
+  SORA_CHECK_EQ(copied, (size_t)dw * dh);
+  for (size_t i = 0; i < expected.size(); i++) {
+    SORA_CHECK_EQ(p[i], expected[i]);
+  }
+
+  std::vector<uint8_t> eu((size_t)dw * dh), ev((size_t)dw * dh);
+  scaler.Configure(f.chroma_width, f.chroma_height, dw, dh);
+  scaler.Scale(f.u.data(), f.chroma_stride, eu.data(), dw);
+  scaler.Scale(f.v.data(), f.chroma_stride, ev.data(), dw);
+  p = ex.Extract(f.Y(), f.U(), f.V(), TexturePlane::UV, dw, dh, &copied);
+  SORA_CHECK_EQ(copied, (size_t)dw * dh * 2);
+  for (size_t i = 0; i < eu.size(); i++) {
+    SORA_CHECK_EQ(p[i * 2], eu[i]);
+    SORA_CHECK_EQ(p[i * 2 + 1], ev[i]);
+  }
+}
+
+// 同じサイズが続く限り、同じバッファを使い回す
+static void TestBuffersAreReused() {
+  Frame f(64, 36, 4);
+  PlaneExtractor ex;
+  size_t copied;
+  const uint8_t* first =
+      ex.Extract(f.Y(), f.U(), f.V(), TexturePlane::UV, 32, 18, &copied);
+  for (int i = 0; i < 10; i++) {
+    const uint8_t* p =
+        ex.Extract(f.Y(), f.U(), f.V(), TexturePlane::UV, 32, 18, &copied);
+    SORA_CHECK(p == first);
+  }
+}
+
+int main() {
+  SORA_RUN_TEST(TestPackedPlaneIsPassedThrough);
+  SORA_RUN_TEST(TestPaddedPlaneIsPacked);
+  SORA_RUN_TEST(TestUVIsInterleaved);
+  SORA_RUN_TEST(TestScaledPlanesMatchScaler);
+  SORA_RUN_TEST(TestBuffersAreReused);
+  return 0;
+}
@@ -0,0 +1,120 @@
+// TextureConverter::ConvertToABGR でスケーリングが必要な場合の、
+// Y, U, V の行を作る部分のベンチマーク。
+// ABGR への行変換は libyuv なので、ここには含まない。
+#include "plane_scaler.h"
+
+#include <stdio.h>
+#include <memory>
+#include <vector>
+
+#include "alloc_counter.h"
+#include "test_util.h"
+
+using sora::PlaneScaler;
+
+namespace {
+
+struct Frame {
+  int width;
+  int height;
+  std::vector<uint8_t> y, u, v;
+  Frame(int w, int h)
+      : width(w),
+        height(h),
+        y((size_t)w * h, 16),
+        u((size_t)((w + 1) / 2) * ((h + 1) / 2), 128),
+        v((size_t)((w + 1) / 2) * ((h + 1) / 2), 128) {
+    for (size_t i = 0; i < y.size(); i++) {
+      y[i] = (uint8_t)(i * 31);
+    }
+  }
+  int chroma_width() const { return (width + 1) / 2; }
+  int chroma_height() const { return (height + 1) / 2; }
+};
+
+// TextureConverter と同じ順序で、出力の行毎に Y と（2 行毎に）U, V の行を作る
+struct Track {
+  PlaneScaler y_scaler;
+  PlaneScaler chroma_scaler;
+  std::vector<uint8_t> row;
+  uint32_t checksum = 0;
+
+  void Convert(const Frame& src, int dst_width, int dst_height) {
+    const int cw = (dst_width + 1) / 2;
+    const int ch = (dst_height + 1) / 2;
+    y_scaler.Configure(src.width, src.height, dst_width, dst_height);
+    chroma_scaler.Configure(src.chroma_width(), src.chroma_height(), cw, ch);
+    if (row.size() < (size_t)dst_width + cw * 2) {
+      row.resize((size_t)dst_width + cw * 2);
+    }
+    uint8_t* y_row = row.data();
+    uint8_t* u_row = y_row + dst_width;
+    uint8_t* v_row = u_row + cw;
+    for (int y = 0; y < dst_height; y++) {
+      y_scaler.ScaleRow(src.y.data(), src.width, y, y_row);
+      if (y % 2 == 0) {
+        chroma_scaler.ScaleRow(src.u.data(), src.chroma_width(), y / 2, u_row);
+        chroma_scaler.ScaleRow(src.v.data(), src.chroma_width(), y / 2, v_row);
+      }
+      checksum += y_row[y % dst_width] + u_row[0] + v_row[cw - 1];
+    }
+  }
+};
+
+struct Size {
+  const char* name;
+  int width;
+  int height;
+};
+
+}  // namespace
+
+int main() {
+  const Size sizes[] = {
+      {"360p", 640, 360},
+      {"720p", 1280, 720},
+      {"1080p", 1920, 1080},
+  };
+  const int kFrames = 100;
+
+  printf("%-6s -> %-6s %12s %14s\n", "src", "dst", "us/frame", "allocs/frame");
+  for (const auto& s : sizes) {
+    Frame src(s.width, s.height);
+    for (const auto& d : sizes) {
+      if (s.width == d.width) {
+        // 同じサイズは TextureConverter がスケーリングせずに直接変換する
+        continue;
+      }
+      Track track;
+      track.Convert(src, d.width, d.height);
+      int64_t allocs = sora::test::AllocationCount().load();
+      double ns = sora::test::MeasureNanos(
+          kFrames, [&]() { track.Convert(src, d.width, d.height); });
+      allocs = sora::test::AllocationCount().load() - allocs;
+      printf("%-6s -> %-6s %12.1f %14.2f   (checksum %u)\n", s.name, d.name,
+             ns / 1000.0, (double)allocs / kFrames, track.checksum);
+    }
+  }
+
+  // トラック数を増やしても、定常状態ではメモリ確保が発生しないこと
+  printf("\n%-7s %16s %14s\n", "tracks", "us/frame(all)", "allocs/frame");
+  Frame src(1280, 720);
+  for (int tracks = 1; tracks <= 16; tracks *= 2) {
+    std::vector<std::unique_ptr<Track>> ts;
+    for (int i = 0; i < tracks; i++) {
+      ts.emplace_back(new Track());
+      ts.back()->Convert(src, 320, 180);
+    }
+    int64_t allocs = sora::test::AllocationCount().load();
+    double ns = sora::test::MeasureNanos(kFrames, [&]() {
+      for (auto& t : ts) {
+        t->Convert(src, 320, 180);
+      }
+    });
+    allocs = sora::test::AllocationCount().load() - allocs;
+    printf("%-7d %16.1f %14.2f\n", tracks, ns / 1000.0,
+           (double)allocs / kFrames);
+    SORA_CHECK_EQ(allocs, 0);
+  }
+  return 0;
+}
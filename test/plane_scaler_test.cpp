@@ -0,0 +1,136 @@
+#include "plane_scaler.h"
+
+#include <stdlib.h>
+#include <vector>
+
+#include "test_util.h"
+
+using sora::PlaneScaler;
+
+static std::vector<uint8_t> MakePlane(int width, int height, int stride) {
+  std::vector<uint8_t> plane((size_t)stride * height, 0xcd);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < width; x++) {
+      plane[(size_t)y * stride + x] = (uint8_t)((x * 7 + y * 13) & 0xff);
+    }
+  }
+  return plane;
+}
+
+// 同じサイズなら、stride が違っても中身はそのまま
+static void TestIdentity() {
+  const int w = 37, h = 11, stride = 48;
+  auto src = MakePlane(w, h, stride);
+  std::vector<uint8_t> dst((size_t)w * h);
+  PlaneScaler scaler;
+  scaler.Configure(w, h, w, h);
+  scaler.Scale(src.data(), stride, dst.data(), w);
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      SORA_CHECK_EQ(dst[(size_t)y * w + x], src[(size_t)y * stride + x]);
+    }
+  }
+}
+
+// 一様なプレーンは、どう拡大・縮小しても一様なまま
+static void TestConstantPlane() {
+  const int sizes[][4] = {
+      {1920, 1080, 640, 360}, {1920, 1080, 160, 90}, {640, 360, 1920, 1080},
+      {641, 361, 320, 181},   {1, 1, 16, 9},         {17, 3, 5, 2},
+      {1920, 1080, 1920, 90}, {160, 90, 160, 1080},
+  };
+  for (const auto& s : sizes) {
+    std::vector<uint8_t> src((size_t)s[0] * s[1], 200);
+    std::vector<uint8_t> dst((size_t)s[2] * s[3], 0);
+    PlaneScaler scaler;
+    scaler.Configure(s[0], s[1], s[2], s[3]);
+    scaler.Scale(src.data(), s[0], dst.data(), s[2]);
+    for (uint8_t v : dst) {
+      SORA_CHECK_EQ(v, 200);
+    }
+  }
+}
+
+// 半分に縮小すると 2x2 の平均になる（box フィルタ）
+static void TestHalfIsBoxAverage() {
+  const int w = 64, h = 32;
+  auto src = MakePlane(w, h, w);
+  std::vector<uint8_t> dst((size_t)(w / 2) * (h / 2));
+  PlaneScaler scaler;
+  scaler.Configure(w, h, w / 2, h / 2);
+  scaler.Scale(src.data(), w, dst.data(), w / 2);
+  for (int y = 0; y < h / 2; y++) {
+    for (int x = 0; x < w / 2; x++) {
+      int sum = src[(size_t)(2 * y) * w + 2 * x] +
+                src[(size_t)(2 * y) * w + 2 * x + 1] +
+                src[(size_t)(2 * y + 1) * w + 2 * x] +
+                src[(size_t)(2 * y + 1) * w + 2 * x + 1];
+      int expected = (sum + 2) / 4;
+      int actual = dst[(size_t)y * (w / 2) + x];
+      SORA_CHECK(abs(actual - expected) <= 1);
+    }
+  }
+}
+
+// 1 ピクセル毎の白黒の縞は、大きく縮小すると灰色になる（折り返さない）
+static void TestDownscaleDoesNotAlias() {
+  const int w = 1920, h = 8;
+  std::vector<uint8_t> src((size_t)w * h);
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      src[(size_t)y * w + x] = (x & 1) ? 255 : 0;
+    }
+  }
+  const int dw = 160;
+  std::vector<uint8_t> dst((size_t)dw * h);
+  PlaneScaler scaler;
+  scaler.Configure(w, h, dw, h);
+  scaler.Scale(src.data(), w, dst.data(), dw);
+  for (uint8_t v : dst) {
+    SORA_CHECK(abs((int)v - 128) <= 1);
+  }
+}
+
+// 拡大は隣り合う画素の間を線形に補間する
+static void TestUpscaleIsMonotonic() {
+  const int w = 4, h = 1;
+  uint8_t src[] = {0, 80, 160, 240};
+  const int dw = 16;
+  std::vector<uint8_t> dst(dw);
+  PlaneScaler scaler;
+  scaler.Configure(w, h, dw, 1);
+  scaler.Scale(src, w, dst.data(), dw);
+  SORA_CHECK_EQ(dst[0], 0);
+  SORA_CHECK_EQ(dst[dw - 1], 240);
+  for (int i = 1; i < dw; i++) {
+    SORA_CHECK(dst[i] >= dst[i - 1]);
+    SORA_CHECK(dst[i] - dst[i - 1] <= 20);
+  }
+}
+
+// 行単位で作っても、まとめて作っても同じ結果になる
+static void TestScaleRowMatchesScale() {
+  const int w = 333, h = 177, dw = 120, dh = 67;
+  auto src = MakePlane(w, h, w);
+  std::vector<uint8_t> whole((size_t)dw * dh);
+  PlaneScaler scaler;
+  scaler.Configure(w, h, dw, dh);
+  scaler.Scale(src.data(), w, whole.data(), dw);
+  std::vector<uint8_t> row(dw);
+  for (int y = dh - 1; y >= 0; y--) {
+    scaler.ScaleRow(src.data(), w, y, row.data());
+    for (int x = 0; x < dw; x++) {
+      SORA_CHECK_EQ(row[x], whole[(size_t)y * dw + x]);
+    }
+  }
+}
+
+int main() {
+  SORA_RUN_TEST(TestIdentity);
+  SORA_RUN_TEST(TestConstantPlane);
+  SORA_RUN_TEST(TestHalfIsBoxAverage);
+  SORA_RUN_TEST(TestDownscaleDoesNotAlias);
+  SORA_RUN_TEST(TestUpscaleIsMonotonic);
+  SORA_RUN_TEST(TestScaleRowMatchesScale);
+  return 0;
+}
@@ -0,0 +1,94 @@
+#include "room_state.h"
+
+#include <string>
+#include <vector>
+
+#include "test_util.h"
+
+using sora::RoomState;
+
+static std::vector<std::string> V(std::initializer_list<const char*> l) {
+  return std::vector<std::string>(l.begin(), l.end());
+}
+
+static void TestUpdateDiff() {
+  RoomState room;
+  RoomState::Diff diff;
+  room.Update(V({"c", "a", "b"}), &diff);
+  SORA_CHECK(diff.added == V({"a", "b", "c"}));
+  SORA_CHECK(diff.removed.empty());
+
+  room.Update(V({"d", "b", "a"}), &diff);
+  SORA_CHECK(diff.added == V({"d"}));
+  SORA_CHECK(diff.removed == V({"c"}));
+  SORA_CHECK(room.Members() == V({"a", "b", "d"}));
+
+  // 同じ一覧なら差分は無い
+  room.Update(V({"a", "b", "d"}), &diff);
+  SORA_CHECK(diff.empty());
+}
+
+static void TestDuplicatesAreIgnored() {
+  RoomState room;
+  RoomState::Diff diff;
+  room.Update(V({"a", "a", "b", "a"}), &diff);
+  SORA_CHECK(diff.added == V({"a", "b"}));
+  SORA_CHECK(room.Members() == V({"a", "b"}));
+}
+
+static void TestAddRemove() {
+  RoomState room;
+  SORA_CHECK(room.Add("b"));
+  SORA_CHECK(room.Add("a"));
+  SORA_CHECK(!room.Add("a"));
+  SORA_CHECK(room.Contains("a"));
+  SORA_CHECK(room.Members() == V({"a", "b"}));
+  SORA_CHECK(room.Remove("a"));
+  SORA_CHECK(!room.Remove("a"));
+  SORA_CHECK(!room.Contains("a"));
+
+  // Add/Remove の後の Update も、その時点の一覧との差分になる
+  RoomState::Diff diff;
+  room.Update(V({"b", "c"}), &diff);
+  SORA_CHECK(diff.added == V({"c"}));
+  SORA_CHECK(diff.removed.empty());
+}
+
+// 再接続の間に抜けたストリームだけが removed になり、残っているストリームは
+// added にならない（再接続の前に閉じたストリームは Remove しておく）
+static void TestRejoinKeepsSurvivors() {
+  RoomState room;
+  RoomState::Diff diff;
+  room.Update(V({"a", "b", "c", "d"}), &diff);
+  // 再接続の時に閉じたストリーム
+  SORA_CHECK(room.Remove("d"));
+  // 再接続後の一覧では c が抜けて e が増えている
+  room.Update(V({"a", "b", "e"}), &diff);
+  SORA_CHECK(diff.added == V({"e"}));
+  SORA_CHECK(diff.removed == V({"c"}));
+}
+
+static void TestLargeRoom() {
+  RoomState room;
+  RoomState::Diff diff;
+  std::vector<std::string> streams;
+  for (int i = 0; i < 1000; i++) {
+    streams.push_back("stream-" + std::to_string(i));
+  }
+  room.Update(streams, &diff);
+  SORA_CHECK_EQ(diff.added.size(), 1000u);
+  streams.erase(streams.begin() + 500);
+  streams.push_back("stream-new");
+  room.Update(streams, &diff);
+  SORA_CHECK(diff.added == V({"stream-new"}));
+  SORA_CHECK(diff.removed == V({"stream-500"}));
+}
+
+int main() {
+  SORA_RUN_TEST(TestUpdateDiff);
+  SORA_RUN_TEST(TestDuplicatesAreIgnored);
+  SORA_RUN_TEST(TestAddRemove);
+  SORA_RUN_TEST(TestRejoinKeepsSurvivors);
+  SORA_RUN_TEST(TestLargeRoom);
+  return 0;
+}
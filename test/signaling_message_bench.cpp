@@ -0,0 +1,181 @@
+// 受信したシグナリングメッセージのパースのベンチマーク。
+// 会議室に入ってから配信・視聴が始まるまでに Ant Media Server から届くメッセージの
+// 並びを再現したコーパスを、以前の方法（文字列にコピーして DOM を作り、
+// フィールドを引く）と ParseSignalingMessage で処理して比べる
+#include "signaling_message.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "alloc_counter.h"
+#include "signaling_writer.h"
+#include "test_util.h"
+
+namespace {
+
+std::string MakeSdp(int media_sections) {
+  std::string sdp =
+      "v=0\r\no=- 4611731400430051336 2 IN IP4 127.0.0.1\r\ns=-\r\nt=0 0\r\n"
+      "a=group:BUNDLE 0 1\r\na=msid-semantic: WMS stream\r\n";
+  for (int m = 0; m < media_sections; m++) {
+    sdp +=
+        "m=video 9 UDP/TLS/RTP/SAVPF 96 97 98 99 100 101 102\r\n"
+        "c=IN IP4 0.0.0.0\r\na=rtcp:9 IN IP4 0.0.0.0\r\n"
+        "a=ice-ufrag:AbCd\r\na=ice-pwd:0123456789abcdefghijklmn\r\n"
+        "a=ice-options:trickle\r\n"
+        "a=fingerprint:sha-256 12:34:56:78:9A:BC:DE:F0:12:34:56:78:9A:BC:DE:F0:"
+        "12:34:56:78:9A:BC:DE:F0:12:34:56:78:9A:BC:DE:F0\r\n"
+        "a=setup:actpass\r\na=mid:0\r\na=sendrecv\r\na=rtcp-mux\r\n"
+        "a=rtpmap:96 VP8/90000\r\na=rtcp-fb:96 goog-remb\r\n"
+        "a=rtcp-fb:96 transport-cc\r\na=rtcp-fb:96 ccm fir\r\n"
+        "a=rtcp-fb:96 nack\r\na=rtcp-fb:96 nack pli\r\n"
+        "a=rtpmap:97 rtx/90000\r\na=fmtp:97 apt=96\r\n"
+        "a=rtpmap:98 VP9/90000\r\na=fmtp:98 profile-id=0\r\n"
+        "a=rtpmap:100 H264/90000\r\na=fmtp:100 level-asymmetry-allowed=1;"
+        "packetization-mode=1;profile-level-id=42e01f\r\n"
+        "a=ssrc:1001 cname:abcdefgh\r\na=ssrc:1001 msid:stream video\r\n";
+  }
+  return sdp;
+}
+
+std::vector<std::string> MakeCorpus() {
+  const int kStreams = 8;
+  std::vector<std::string> corpus;
+  std::string out;
+  std::vector<std::string> ids;
+  for (int i = 0; i < kStreams; i++) {
+    ids.push_back("stream" + std::to_string(i));
+  }
+
+  out = "{\"command\":\"notification\",\"definition\":\"joinedTheRoom\","
+        "\"streamId\":\"me\",\"ATTR_ROOM_NAME\":\"room1\",\"streams\":[";
+  for (int i = 0; i < kStreams; i++) {
+    out += (i ? ",\"" : "\"") + ids[i] + "\"";
+  }
+  out += "]}";
+  corpus.push_back(out);
+  corpus.push_back("{\"command\":\"start\",\"streamId\":\"me\"}");
+
+  // 配信の answer と、視聴するストリーム毎の offer
+  const std::string sdp = MakeSdp(2);
+  auto add_candidates = [&](const std::string& id) {
+    for (int c = 0; c < 6; c++) {
+      out.clear();
+      sora::signaling_writer::TakeCandidate(
+          &out, id, c % 2, c % 2 ? "1" : "0",
+          "candidate:" + std::to_string(842163049 + c) +
+              " 1 udp 1677729535 203.0.113." + std::to_string(10 + c) +
+              " 5" + std::to_string(1000 + c) +
+              " typ srflx raddr 0.0.0.0 rport 0 generation 0 ufrag AbCd "
+              "network-cost 999");
+      corpus.push_back(out);
+    }
+  };
+  out.clear();
+  sora::signaling_writer::TakeConfiguration(&out, "me", "answer", sdp);
+  corpus.push_back(out);
+  add_candidates("me");
+  for (const auto& id : ids) {
+    out.clear();
+    sora::signaling_writer::TakeConfiguration(&out, id, "offer", sdp);
+    corpus.push_back(out);
+    add_candidates(id);
+  }
+
+  for (int i = 0; i < 4; i++) {
+    corpus.push_back("{\"command\":\"pong\"}");
+    out = "{\"command\":\"roomInformation\",\"room\":\"room1\",\"streams\":[";
+    for (int s = 0; s < kStreams; s++) {
+      out += (s ? ",\"" : "\"") + ids[s] + "\"";
+    }
+    out += "]}";
+    corpus.push_back(out);
+  }
+  corpus.push_back(
+      "{\"command\":\"notification\",\"definition\":\"bitrateMeasurement\","
+      "\"streamId\":\"me\",\"targetBitrate\":2000000,\"videoBitrate\":1500000,"
+      "\"audioBitrate\":64000}");
+  return corpus;
+}
+
+// 以前の SoraSignaling::onRead と同じ処理
+int64_t HandleWithDom(const std::string& received) {
+  const std::string text = received;
+  auto json_message = nlohmann::json::parse(text);
+  const std::string command = json_message["command"];
+  int64_t n = command.size();
+  if (command == "takeConfiguration") {
+    std::string type = json_message["type"];
+    std::string sdp = json_message["sdp"];
+    std::string stream_id = json_message["streamId"];
+    n += type.size() + sdp.size() + stream_id.size();
+  } else if (command == "takeCandidate") {
+    std::string id = json_message["id"];
+    int label = json_message["label"];
+    std::string candidate = json_message["candidate"];
+    std::string stream_id = json_message["streamId"];
+    n += id.size() + label + candidate.size() + stream_id.size();
+  } else if (command == "notification" || command == "roomInformation") {
+    n += json_message.value("streams", std::vector<std::string>()).size();
+  }
+  return n;
+}
+
+int64_t HandleInPlace(const std::string& received,
+                      sora::SignalingMessage* message) {
+  if (!sora::ParseSignalingMessage(received.data(), received.size(),
+                                   message)) {
+    return -1;
+  }
+  return (int64_t)message->command + message->stream_id.size() +
+         message->sdp.size() + message->candidate.size() +
+         message->streams.size();
+}
+
+}  // namespace
+
+int main() {
+  const auto corpus = MakeCorpus();
+  const int kIterations = 500;
+  size_t bytes = 0;
+  for (const auto& m : corpus) {
+    bytes += m.size();
+  }
+  printf("corpus: %zu messages, %zu bytes\n", corpus.size(), bytes);
+  printf("%-16s %12s %14s %12s\n", "method", "ns/message", "allocs/message",
+         "MB/s");
+
+  int64_t sink = 0;
+  auto report = [&](const char* name, double ns_per_pass, int64_t allocs) {
+    printf("%-16s %12.1f %14.2f %12.1f\n", name, ns_per_pass / corpus.size(),
+           (double)allocs / kIterations / corpus.size(),
+           bytes / ns_per_pass * 1000.0);
+  };
+
+  int64_t before = sora::test::AllocationCount();
+  double ns = sora::test::MeasureNanos(kIterations, [&]() {
+    for (const auto& m : corpus) {
+      sink += HandleWithDom(m);
+    }
+  });
+  report("dom", ns, sora::test::AllocationCount() - before);
+
+  sora::SignalingMessage message;
+  // 1 周目でバッファが育つので、測る前に回しておく
+  for (const auto& m : corpus) {
+    sink += HandleInPlace(m, &message);
+  }
+  before = sora::test::AllocationCount();
+  ns = sora::test::MeasureNanos(kIterations, [&]() {
+    for (const auto& m : corpus) {
+      sink += HandleInPlace(m, &message);
+    }
+  });
+  report("in-place", ns, sora::test::AllocationCount() - before);
+
+  printf("(checksum %lld)\n", (long long)sink);
+  return 0;
+}
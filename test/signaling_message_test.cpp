@@ -0,0 +1,173 @@
+#include "signaling_message.h"
+
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#include "signaling_writer.h"
+#include "test_util.h"
+
+using sora::ParseSignalingMessage;
+using sora::SignalingMessage;
+namespace signaling_writer = sora::signaling_writer;
+
+namespace {
+
+SignalingMessage Parse(const std::string& text) {
+  SignalingMessage message;
+  SORA_CHECK(ParseSignalingMessage(text.data(), text.size(), &message));
+  return message;
+}
+
+}  // namespace
+
+static void TestCommands() {
+  struct {
+    const char* name;
+    SignalingMessage::Command command;
+  } cases[] = {
+      {"start", SignalingMessage::Command::Start},
+      {"takeConfiguration", SignalingMessage::Command::TakeConfiguration},
+      {"takeCandidate", SignalingMessage::Command::TakeCandidate},
+      {"pong", SignalingMessage::Command::Pong},
+      {"notification", SignalingMessage::Command::Notification},
+      {"roomInformation", SignalingMessage::Command::RoomInformation},
+      {"error", SignalingMessage::Command::Error},
+      {"somethingNew", SignalingMessage::Command::Unknown},
+  };
+  for (const auto& c : cases) {
+    auto m = Parse(std::string("{\"command\":\"") + c.name + "\"}");
+    SORA_CHECK(m.command == c.command);
+  }
+}
+
+static void TestDefinitions() {
+  struct {
+    const char* name;
+    SignalingMessage::Definition definition;
+  } cases[] = {
+      {"joinedTheRoom", SignalingMessage::Definition::JoinedTheRoom},
+      {"play_finished", SignalingMessage::Definition::PlayFinished},
+      {"bitrateMeasurement", SignalingMessage::Definition::BitrateMeasurement},
+      {"publishTimeoutError", SignalingMessage::Definition::PublishTimeoutError},
+      {"no_stream_exist", SignalingMessage::Definition::NoStreamExist},
+      {"publish_started", SignalingMessage::Definition::Unknown},
+  };
+  for (const auto& c : cases) {
+    auto m = Parse(std::string("{\"command\":\"notification\",\"definition\":\"") +
+                   c.name + "\"}");
+    SORA_CHECK(m.command == SignalingMessage::Command::Notification);
+    SORA_CHECK(m.definition == c.definition);
+  }
+}
+
+static void TestTakeCandidate() {
+  auto m = Parse(
+      "{\"command\":\"takeCandidate\",\"streamId\":\"s1\",\"label\":1,"
+      "\"id\":\"video\",\"candidate\":\"candidate:1 1 udp 2122260223 "
+      "192.168.0.2 50000 typ host\"}");
+  SORA_CHECK(m.command == SignalingMessage::Command::TakeCandidate);
+  SORA_CHECK_EQ(m.stream_id, "s1");
+  SORA_CHECK_EQ(m.label, 1);
+  SORA_CHECK_EQ(m.id, "video");
+  SORA_CHECK_EQ(m.candidate,
+                "candidate:1 1 udp 2122260223 192.168.0.2 50000 typ host");
+}
+
+static void TestTakeConfiguration() {
+  auto m = Parse(
+      "{\"command\":\"takeConfiguration\",\"streamId\":\"s1\","
+      "\"type\":\"offer\",\"sdp\":\"v=0\\r\\no=- 1 2 IN IP4 127.0.0.1\\r\\n\"}");
+  SORA_CHECK(m.command == SignalingMessage::Command::TakeConfiguration);
+  SORA_CHECK_EQ(m.type, "offer");
+  SORA_CHECK_EQ(m.sdp, "v=0\r\no=- 1 2 IN IP4 127.0.0.1\r\n");
+}
+
+// streams 以外のネストしたフィールドや、ネストしたオブジェクト内の同じ名前の
+// キーは無視する
+static void TestNestedFieldsIgnored() {
+  auto m = Parse(
+      "{\"command\":\"roomInformation\",\"room\":\"r\","
+      "\"info\":{\"streamId\":\"inner\",\"streams\":[\"x\"],\"label\":9},"
+      "\"streams\":[\"a\",\"b\",\"c\"],\"streamId\":\"outer\"}");
+  SORA_CHECK(m.command == SignalingMessage::Command::RoomInformation);
+  SORA_CHECK_EQ(m.stream_id, "outer");
+  SORA_CHECK_EQ(m.label, 0);
+  SORA_CHECK_EQ(m.streams.size(), 3u);
+  SORA_CHECK_EQ(m.streams[0], "a");
+  SORA_CHECK_EQ(m.streams[2], "c");
+}
+
+static void TestInvalidJson() {
+  SignalingMessage m;
+  const std::string cases[] = {"", "{", "{\"command\":}", "not json",
+                               "{\"command\":\"pong\"} trailing"};
+  for (const auto& text : cases) {
+    SORA_CHECK(!ParseSignalingMessage(text.data(), text.size(), &m));
+  }
+}
+
+// 使い回しても前のメッセージのフィールドは残らない
+static void TestReuse() {
+  SignalingMessage m;
+  std::string text =
+      "{\"command\":\"notification\",\"definition\":\"joinedTheRoom\","
+      "\"streamId\":\"me\",\"streams\":[\"a\",\"b\"]}";
+  SORA_CHECK(ParseSignalingMessage(text.data(), text.size(), &m));
+  SORA_CHECK_EQ(m.streams.size(), 2u);
+
+  text = "{\"command\":\"pong\"}";
+  SORA_CHECK(ParseSignalingMessage(text.data(), text.size(), &m));
+  SORA_CHECK(m.command == SignalingMessage::Command::Pong);
+  SORA_CHECK(m.definition == SignalingMessage::Definition::Unknown);
+  SORA_CHECK(m.stream_id.empty());
+  SORA_CHECK(m.streams.empty());
+}
+
+// 組み立てたメッセージは JSON としてパースでき、同じ値に戻る
+static void TestWriterRoundTrip() {
+  const std::string tricky = "a\"b\\c\nd\re\tf\bg\fh\x01i\x1fj/\xe3\x81\x82";
+  std::string out;
+  signaling_writer::TakeCandidate(&out, tricky, 2, "audio", "candidate:x");
+  auto j = nlohmann::json::parse(out);
+  SORA_CHECK_EQ(j["command"].get<std::string>(), "takeCandidate");
+  SORA_CHECK_EQ(j["streamId"].get<std::string>(), tricky);
+  SORA_CHECK_EQ(j["label"].get<int>(), 2);
+  SORA_CHECK_EQ(j["id"].get<std::string>(), "audio");
+  SORA_CHECK_EQ(j["candidate"].get<std::string>(), "candidate:x");
+
+  out.clear();
+  signaling_writer::TakeConfiguration(&out, "s", "answer", tricky);
+  j = nlohmann::json::parse(out);
+  SORA_CHECK_EQ(j["type"].get<std::string>(), "answer");
+  SORA_CHECK_EQ(j["sdp"].get<std::string>(), tricky);
+
+  out.clear();
+  signaling_writer::Publish(&out, "p", false);
+  j = nlohmann::json::parse(out);
+  SORA_CHECK_EQ(j["command"].get<std::string>(), "publish");
+  SORA_CHECK_EQ(j["video"].get<bool>(), false);
+
+  out.clear();
+  signaling_writer::GetRoomInfo(&out, "room", "p");
+  j = nlohmann::json::parse(out);
+  SORA_CHECK_EQ(j["room"].get<std::string>(), "room");
+  SORA_CHECK_EQ(j["streamId"].get<std::string>(), "p");
+
+  // 既存の内容の後ろに追加する
+  out = "prefix";
+  signaling_writer::Ping(&out);
+  SORA_CHECK_EQ(out, "prefix{\"command\":\"ping\"}");
+}
+
+int main() {
+  SORA_RUN_TEST(TestCommands);
+  SORA_RUN_TEST(TestDefinitions);
+  SORA_RUN_TEST(TestTakeCandidate);
+  SORA_RUN_TEST(TestTakeConfiguration);
+  SORA_RUN_TEST(TestNestedFieldsIgnored);
+  SORA_RUN_TEST(TestInvalidJson);
+  SORA_RUN_TEST(TestReuse);
+  SORA_RUN_TEST(TestWriterRoundTrip);
+  return 0;
+}
@@ -0,0 +1,200 @@
+#include "signaling_transport.h"
+
+#include <string>
+#include <vector>
+
+#include "signaling_stand_in.h"
+#include "test_util.h"
+
+using sora::SignalingTransport;
+using sora::test::RunUntil;
+using sora::test::SignalingStandIn;
+
+namespace {
+
+// Handler に渡されたものを記録する
+struct Recorder {
+  int connected = 0;
+  std::vector<bool> resumed;
+  std::vector<int> connected_attempts;
+  std::vector<std::string> messages;
+  std::vector<int> reconnect_attempts;
+  std::vector<int> reconnect_delays_ms;
+  int closed = 0;
+  int closed_attempts = 0;
+
+  SignalingTransport::Handler MakeHandler() {
+    SignalingTransport::Handler handler;
+    handler.on_connected = [this](bool r, int attempts) {
+      connected++;
+      resumed.push_back(r);
+      connected_attempts.push_back(attempts);
+    };
+    handler.on_message = [this](const char* data, size_t size) {
+      messages.emplace_back(data, size);
+    };
+    handler.on_reconnecting = [this](int attempt, int delay_ms) {
+      reconnect_attempts.push_back(attempt);
+      reconnect_delays_ms.push_back(delay_ms);
+    };
+    handler.on_closed = [this](int attempts) {
+      closed++;
+      closed_attempts = attempts;
+    };
+    return handler;
+  }
+};
+
+struct Fixture {
+  boost::asio::io_context ioc;
+  SignalingStandIn server;
+  Recorder recorder;
+  std::shared_ptr<SignalingTransport> transport;
+
+  explicit Fixture(int max_attempts = 5) : server(ioc) {
+    sora::SignalingTransportConfig config;
+    config.host = "127.0.0.1";
+    config.port = server.Port();
+    config.path = "/signaling";
+    config.reconnect_max_attempts = max_attempts;
+    config.reconnect_base_delay_ms = 10;
+    config.reconnect_max_delay_ms = 40;
+    transport = SignalingTransport::Create(
+        boost::asio::make_strand(ioc), config, recorder.MakeHandler());
+    SORA_CHECK(transport != nullptr);
+  }
+
+  void Send(const std::string& text) {
+    std::string* out = transport->BeginMessage();
+    SORA_CHECK(out != nullptr);
+    *out = text;
+    transport->EndMessage(out);
+  }
+};
+
+}  // namespace
+
+static void TestConnectSendReceive() {
+  Fixture f;
+  SORA_CHECK(f.transport->Connect());
+  SORA_CHECK(!f.transport->Connect());
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return f.recorder.connected == 1; }));
+  SORA_CHECK(!f.recorder.resumed[0]);
+
+  // 送信中に積んだメッセージも、1 つずつ順に届く
+  for (int i = 0; i < 20; i++) {
+    f.Send("message " + std::to_string(i));
+  }
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return f.server.received.size() == 20; }));
+  for (int i = 0; i < 20; i++) {
+    SORA_CHECK_EQ(f.server.received[i], "message " + std::to_string(i));
+  }
+
+  f.server.Send("{\"type\":\"pong\"}");
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return f.recorder.messages.size() == 1; }));
+  SORA_CHECK_EQ(f.recorder.messages[0], "{\"type\":\"pong\"}");
+
+  auto stats = f.transport->GetStats();
+  SORA_CHECK_EQ(stats.messages_sent, 20);
+  SORA_CHECK_EQ(stats.messages_received, 1);
+  SORA_CHECK_EQ(stats.bytes_sent, f.server.bytes_received);
+}
+
+// ロードバランサに切られた場合と同じく、TCP がいきなり切れたら再接続して、
+// 再接続した後は送受信できる
+static void TestReconnectAfterDrop() {
+  Fixture f;
+  f.transport->Connect();
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return f.recorder.connected == 1; }));
+
+  for (int round = 1; round <= 3; round++) {
+    f.server.DropAll();
+    SORA_CHECK(
+        RunUntil(f.ioc, [&]() { return f.recorder.connected == round + 1; }));
+    SORA_CHECK(f.recorder.resumed[round]);
+    // すぐに繋がったので 1 回目の試行で、待ち時間は最初の値
+    SORA_CHECK_EQ(f.recorder.connected_attempts[round], 1);
+    SORA_CHECK_EQ(f.recorder.reconnect_delays_ms.back(), 10);
+
+    std::string text = "after drop " + std::to_string(round);
+    f.Send(text);
+    SORA_CHECK(
+        RunUntil(f.ioc, [&]() { return f.server.received.size() == (size_t)round; }));
+    SORA_CHECK_EQ(f.server.received.back(), text);
+  }
+  SORA_CHECK_EQ(f.server.sessions_accepted, 4);
+  SORA_CHECK_EQ(f.recorder.closed, 0);
+}
+
+// 繋がらない間は待ち時間を倍にしながら試行し、繋がったら回数を戻す
+static void TestBackoffUntilServerReturns() {
+  Fixture f;
+  f.transport->Connect();
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return f.recorder.connected == 1; }));
+
+  f.server.StopListening();
+  f.server.DropAll();
+  SORA_CHECK(RunUntil(
+      f.ioc, [&]() { return f.recorder.reconnect_attempts.size() == 4; }));
+  f.server.StartListening();
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return f.recorder.connected == 2; }));
+
+  const int expected[] = {10, 20, 40, 40};
+  for (int i = 0; i < 4; i++) {
+    SORA_CHECK_EQ(f.recorder.reconnect_attempts[i], i + 1);
+    SORA_CHECK_EQ(f.recorder.reconnect_delays_ms[i], expected[i]);
+  }
+  SORA_CHECK(f.recorder.connected_attempts[1] >= 4);
+
+  // 繋がった後に切れたら、また最初の待ち時間から
+  f.server.DropAll();
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return f.recorder.connected == 3; }));
+  SORA_CHECK_EQ(f.recorder.connected_attempts[2], 1);
+}
+
+static void TestGiveUp() {
+  Fixture f(3);
+  f.transport->Connect();
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return f.recorder.connected == 1; }));
+  f.server.StopListening();
+  f.server.DropAll();
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return f.recorder.closed == 1; }));
+  SORA_CHECK_EQ(f.recorder.closed_attempts, 3);
+  SORA_CHECK_EQ(f.recorder.reconnect_attempts.size(), 3u);
+  // 諦めた後は送らない
+  SORA_CHECK(f.transport->BeginMessage() == nullptr);
+}
+
+// pong が返ってこない場合と同じく、繋がったままの接続を捨てて接続し直す
+static void TestReconnectHalfOpen() {
+  Fixture f;
+  f.transport->Connect();
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return f.recorder.connected == 1; }));
+  f.transport->Reconnect("Keepalive timeout", boost::asio::error::timed_out);
+  SORA_CHECK(f.transport->BeginMessage() == nullptr);
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return f.recorder.connected == 2; }));
+  f.Send("hello");
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return f.server.received.size() == 1; }));
+}
+
+// 閉じた後はサーバが切っても再接続しない
+static void TestClose() {
+  Fixture f;
+  f.transport->Connect();
+  SORA_CHECK(RunUntil(f.ioc, [&]() { return f.recorder.connected == 1; }));
+  f.transport->Close();
+  f.server.DropAll();
+  RunUntil(f.ioc, []() { return false; }, std::chrono::milliseconds(100));
+  SORA_CHECK(f.recorder.reconnect_attempts.empty());
+  SORA_CHECK_EQ(f.server.sessions_accepted, 1);
+}
+
+int main() {
+  SORA_RUN_TEST(TestConnectSendReceive);
+  SORA_RUN_TEST(TestReconnectAfterDrop);
+  SORA_RUN_TEST(TestBackoffUntilServerReturns);
+  SORA_RUN_TEST(TestGiveUp);
+  SORA_RUN_TEST(TestReconnectHalfOpen);
+  SORA_RUN_TEST(TestClose);
+  return 0;
+}
@@ -0,0 +1,9 @@
+#ifndef SORA_TEST_STUB_RTC_BASE_LOGGING_H_INCLUDED
+#define SORA_TEST_STUB_RTC_BASE_LOGGING_H_INCLUDED
+
+// テストでは WebRTC をリンクしないので、RTC_LOG は標準エラー出力に書く
+#include <iostream>
+
+#define RTC_LOG(sev) std::cerr << #sev << ": "
+
+#endif  // SORA_TEST_STUB_RTC_BASE_LOGGING_H_INCLUDED
@@ -0,0 +1,45 @@
+#ifndef SORA_TEST_UTIL_H_INCLUDED
+#define SORA_TEST_UTIL_H_INCLUDED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+// 失敗したらその場で終了する。テストの終了コードは ctest が見る
+#define SORA_CHECK(cond)                                                  \
+  do {                                                                    \
+    if (!(cond)) {                                                        \
+      fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__,    \
+              #cond);                                                     \
+      exit(1);                                                            \
+    }                                                                     \
+  } while (0)
+
+#define SORA_CHECK_EQ(a, b) SORA_CHECK((a) == (b))
+
+#define SORA_RUN_TEST(f)               \
+  do {                                 \
+    printf("[ RUN  ] %s\n", #f);       \
+    f();                               \
+    printf("[  OK  ] %s\n", #f);       \
+  } while (0)
+
+namespace sora {
+namespace test {
+
+// f を iterations 回実行して、1 回あたりの時間をナノ秒で返す
+template <class F>
+double MeasureNanos(int iterations, F f) {
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    f();
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         iterations;
+}
+
+}  // namespace test
+}  // namespace sora
+
+#endif  // SORA_TEST_UTIL_H_INCLUDED